@@ -1,2523 +1,8188 @@
-﻿// ChessEngine.cpp : This file contains the 'main' function. Program execution begins and ends there.
-
-#include <iostream>
-#include <sstream>
-#include <array>
-#include <cstdlib>
-#include <vector>
-#include <iomanip>
-#include <cassert>
-#include <random>
-
-
-
-// Define bitboard
-typedef unsigned long long  U64;
-// Define Move
-typedef uint16_t Move;
-
-struct SearchResult {
-	Move move;
-	int score;
-};
-
-// get/set/pop macros
-#define get_bit(bitboard, square) ((bitboard >> square) & 1ULL)
-#define set_bit(bitboard, square) (bitboard |= (1ULL << square))
-#define pop_bit(bitboard, square) (get_bit(bitboard, square) ? bitboard ^= (1ULL << square) : 0) // turns bit from 1 to 0, only if it's 1
-
-constexpr auto MAX_MOVES = 256;
-constexpr auto oneRank = 8;
-
-const auto minScore = -999999;
-const auto maxScore = 999999;
-const auto checkmateScore = -10000;
-const auto depth = 6; // CURRENT DEPTH
-const auto MAX_DEPTH = 64;
-
-int plyCounter = 0;
-
-// Enumerate sides / colors
-enum Color { white, black };
-
-Color currentSideToMove = white; // This is for UCI
-
-
-std::array<std::array<Move, MAX_MOVES>, MAX_DEPTH> moveStack; // Max depth 64, one array that stores moves for all depth levels
-std::array<int, MAX_DEPTH> moveCountStack; // Number of moves for each depth level
-
-
-// Forward declarations 
-void getPseudoLegalMoves(Color c, std::array<Move, MAX_MOVES>& moveStack, int& moveCount);
-
-void makeMove(Move m, Color c, int ply);
-void unmakeMove(Move m, Color c, int ply);
-
-SearchResult negaMax(Color c, int alpha, int beta, int depthLeft, int ply);
-
-enum EFlag {
-	quiet_move,
-	double_pawn_push,
-	king_side_castle,
-	queen_side_castle,
-	capture,
-	en_passant_capture,
-	knight_promotion,
-	bishop_promotion,
-	rook_promotion,
-	queen_promotion,
-	knight_promo_capture,
-	bishop_promo_capture,
-	rook_promo_capture,
-	queen_promo_capture
-};
-
-bool whiteKingSideCastlingRights{ true };
-bool whiteQueenSideCastlingRights{ true };
-
-bool blackKingSideCastlingRights{ true };
-bool blackQueenSideCastlingRights{ true };
-
-// Enumerate board squares
-enum EnumSquare {
-	a8, b8, c8, d8, e8, f8, g8, h8,
-	a7, b7, c7, d7, e7, f7, g7, h7,
-	a6, b6, c6, d6, e6, f6, g6, h6,
-	a5, b5, c5, d5, e5, f5, g5, h5,
-	a4, b4, c4, d4, e4, f4, g4, h4,
-	a3, b3, c3, d3, e3, f3, g3, h3,
-	a2, b2, c2, d2, e2, f2, g2, h2,
-	a1, b1, c1, d1, e1, f1, g1, h1
-};
-
-
-int getFile(int sq)
-{
-	return sq % 8 + 1;
-}
-
-int getRank(int sq)
-{
-	return 8 - (sq / 8);
-}
-
-int stringToSquare(const std::string& str)
-{
-	if (str.length() != 2) return -1; // Invalid input
-
-	char file = str[0];
-	char rank = str[1];
-
-	if (file < 'a' || file > 'h') return -1;
-	if (rank < '1' || rank > '8') return -1;
-
-	int fileNum = file - 'a'; // 0-7
-	int rankNum = '8' - rank; // 0-7 
-
-	return rankNum * 8 + fileNum; // Convert to 0-63
-}
-
-std::string squareToString(int square)
-{
-	char file = 'a' + (square % 8);
-	char rank = '8' - (square / 8);
-	return std::string(1, file) + std::string(1, rank);
-}
-
-// Enumerate piece type
-enum EPieceType {
-	ept_pnil = 0, // empty
-	ept_wpawn = 1,
-	ept_bpawn = 2,
-	ept_knight = 3,
-	ept_bishop = 4,
-	ept_rook = 5,
-	ept_queen = 6,
-	ept_king = 7,
-};
-
-// Enumerate piece code
-enum EPieceCode {
-	epc_empty = ept_pnil,
-	epc_wpawn = ept_wpawn,
-	epc_woff = ept_bpawn, // may be used as off the board blocker in mailbox
-	epc_wknight = ept_knight,
-	epc_wbishop = ept_bishop,
-	epc_wrook = ept_rook,
-	epc_wqueen = ept_queen,
-	epc_wking = ept_king,
-
-	epc_blacky = 8, // color code, may used as off the board blocker in mailbox
-	epc_boff = ept_wpawn + epc_blacky, // may be used as off the board blocker in mailbox
-	epc_bpawn = ept_bpawn + epc_blacky,
-	epc_bknight = ept_knight + epc_blacky,
-	epc_bbishop = ept_bishop + epc_blacky,
-	epc_brook = ept_rook + epc_blacky,
-	epc_bqueen = ept_queen + epc_blacky,
-	epc_bking = ept_king + epc_blacky,
-};
-
-std::string pieceToUnicode(int piece)
-{ // Best solution
-	switch (piece)
-	{
-	case epc_wpawn:   return "♙";
-	case epc_wrook:   return "♖";
-	case epc_wknight: return "♘";
-	case epc_wbishop: return "♗";
-	case epc_wqueen:  return "♕";
-	case epc_wking:   return "♔";
-
-	case epc_bpawn:   return "♟";
-	case epc_brook:   return "♜";
-	case epc_bknight: return "♞";
-	case epc_bbishop: return "♝";
-	case epc_bqueen:  return "♛";
-	case epc_bking:   return "♚";
-
-	case epc_empty:   return ".";
-	}
-	return "?"; // fallback
-}
-
-char pieceToChar(int piece)
-{ // Temporary
-	switch (piece)
-	{
-	case epc_wpawn:   return 'P';
-	case epc_wrook:   return 'R';
-	case epc_wknight: return 'N';
-	case epc_wbishop: return 'B';
-	case epc_wqueen:  return 'Q';
-	case epc_wking:   return 'K';
-	case epc_bpawn:   return 'p';
-	case epc_brook:   return 'r';
-	case epc_bknight: return 'n';
-	case epc_bbishop: return 'b';
-	case epc_bqueen:  return 'q';
-	case epc_bking:   return 'k';
-	default:          return '.';
-	}
-}
-
-
-// Create Board Array / Main Board of type EPieceCode
-EPieceCode mainBoard[64];
-
-// Create the 12 bitboards for every piece
-std::array<U64, 12> bitboardPieces;
-
-enum Bitboard_index {
-	bb_wpawn = 0,
-	bb_bpawn,
-	bb_wknight,
-	bb_bknight,
-	bb_wbishop,
-	bb_bbishop,
-	bb_wrook,
-	bb_brook,
-	bb_wqueen,
-	bb_bqueen,
-	bb_wking,
-	bb_bking
-};
-
-std::array<int, MAX_DEPTH> whichWhitePieceIndexWasThere;
-std::array<int, MAX_DEPTH> whichBlackPieceIndexWasThere;
-
-EPieceCode convertPieceIndexToEPC(Color c, int num)
-{
-	if (c == white)
-	{
-		if (num == 0) return epc_wpawn;
-		if (num == 2) return epc_wknight;
-		if (num == 4) return epc_wbishop;
-		if (num == 6) return epc_wrook;
-		if (num == 8) return epc_wqueen;
-		if (num == 10) return epc_wking;
-	}
-	else if (c == black)
-	{
-		if (num == 1) return epc_bpawn;
-		if (num == 3) return epc_bknight;
-		if (num == 5) return epc_bbishop;
-		if (num == 7) return epc_brook;
-		if (num == 9) return epc_bqueen;
-		if (num == 11) return epc_bking;
-	}
-
-	return epc_empty;
-}
-
-// Occupancy bitboards (white, black and all pieces)
-U64 whitePiecesOccupancy;
-U64 blackPiecesOccupancy;
-U64 allPiecesOccupancy;
-
-// Based on bitboard_index
-std::array<int, 12> pieceValue = { 100, -100, 300, -300, 300, -300, 500, -500, 900, -900 };
-
-int getPieceIndex(int sq)
-{
-	for (int i = bb_wpawn; i <= bb_bking; i++)
-	{
-		if (get_bit(bitboardPieces[i], sq) == 1) return i;
-	}
-
-	return -1;
-}
-
-
-// Initialization of the piece bitboards
-void initializeAllBoards()
-{
-	for (int i = bb_wpawn; i <= bb_bking; i++)
-	{
-		bitboardPieces[i] = 0ULL;
-	}
-	whitePiecesOccupancy = 0ULL;
-	blackPiecesOccupancy = 0ULL;
-	allPiecesOccupancy = 0ULL;
-
-	for (int square = a8; square <= h1; square++)
-	{
-
-		if (square == a8 || square == h8)
-		{
-			set_bit(bitboardPieces[bb_brook], square);
-			mainBoard[square] = epc_brook;
-		}
-		else if (square == b8 || square == g8)
-		{
-			set_bit(bitboardPieces[bb_bknight], square);
-			mainBoard[square] = epc_bknight;
-		}
-		else if (square == c8 || square == f8)
-		{
-			set_bit(bitboardPieces[bb_bbishop], square);
-			mainBoard[square] = epc_bbishop;
-		}
-		else if (square == d8)
-		{
-			set_bit(bitboardPieces[bb_bqueen], square);
-			mainBoard[square] = epc_bqueen;
-		}
-		else if (square == e8)
-		{
-			set_bit(bitboardPieces[bb_bking], square);
-			mainBoard[square] = epc_bking;
-		}
-		else if (square == a7 || square == b7 || square == c7 || square == d7 || square == e7
-			|| square == f7 || square == g7 || square == h7)
-		{
-			set_bit(bitboardPieces[bb_bpawn], square);
-			mainBoard[square] = epc_bpawn;
-		}
-		else if (square == a1 || square == h1)
-		{
-			set_bit(bitboardPieces[bb_wrook], square);
-			mainBoard[square] = epc_wrook;
-		}
-		else if (square == b1 || square == g1)
-		{
-			set_bit(bitboardPieces[bb_wknight], square);
-			mainBoard[square] = epc_wknight;
-		}
-		else if (square == c1 || square == f1)
-		{
-			set_bit(bitboardPieces[bb_wbishop], square);
-			mainBoard[square] = epc_wbishop;
-		}
-		else if (square == d1)
-		{
-			set_bit(bitboardPieces[bb_wqueen], square);
-			mainBoard[square] = epc_wqueen;
-		}
-		else if (square == e1)
-		{
-			set_bit(bitboardPieces[bb_wking], square);
-			mainBoard[square] = epc_wking;
-		}
-		else if (square == a2 || square == b2 || square == c2 || square == d2 || square == e2
-			|| square == f2 || square == g2 || square == h2)
-		{
-			set_bit(bitboardPieces[bb_wpawn], square);
-			mainBoard[square] = epc_wpawn;
-		}
-		else
-		{
-			mainBoard[square] = epc_empty;
-		}
-	}
-
-	// Occupancy bitboards initialization
-	whitePiecesOccupancy = bitboardPieces[bb_wrook] | bitboardPieces[bb_wpawn] | bitboardPieces[bb_wknight] | bitboardPieces[bb_wbishop] | bitboardPieces[bb_wqueen] | bitboardPieces[bb_wking];
-	blackPiecesOccupancy = bitboardPieces[bb_brook] | bitboardPieces[bb_bpawn] | bitboardPieces[bb_bknight] | bitboardPieces[bb_bbishop] | bitboardPieces[bb_bqueen] | bitboardPieces[bb_bking];
-	allPiecesOccupancy = whitePiecesOccupancy | blackPiecesOccupancy;
-}
-
-/*
---------------------
-
-TRANSPOSITION TABLES
-		  
---------------------
-*/
-
-U64 zobristPieces[12][64]; // every piece piece and square combo
-U64 zobristSideToMove;
-U64 positionKey; // current position hash, updated on make/unmake move
-
-struct TTEntry {
-	U64 key; // position hash 
-	int score; // evaluation score
-	int depth; // depth reached
-	Move bestMove; // best move found
-	uint8_t flag; // type of score (exact, upper, lower)
-};
-
-constexpr int TT_SIZE = 1048576; // 2^20
-std::vector<TTEntry> transpositionTable(TT_SIZE);
-
-enum TTFlag {
-	TT_EXACT,
-	TT_ALPHA,
-	TT_BETA
-};
-
-
-void initializeZobrist()
-{
-	std::mt19937_64 rng(123456789);  // fixed seed = same numbers every run
-
-	for (int piece = bb_wpawn; piece <= bb_bking; piece++)
-	{
-		for (int square = 0; square < 64; square++)
-		{
-			zobristPieces[piece][square] = rng();
-		}
-	}
-
-	zobristSideToMove = rng();
-}
-
-U64 computePositionKey()
-{
-	// Called in every board initialization
-	U64 key = 0ULL;
-
-	for (int index = bb_wpawn; index <= bb_bking; index++)
-	{
-		for (int square = 0; square < 64; square++)
-		{
-			if (get_bit(bitboardPieces[index], square))
-			{
-				key ^= zobristPieces[index][square];
-			}
-		}
-	}
-
-	if (currentSideToMove == black)
-	{
-		key ^= zobristSideToMove;
-	}
-
-	return key;
-}
-
-bool isSquareAttacked(int square, Color byColor)
-{
-	// Pawn attacks
-	int pawnDir = (byColor == white) ? oneRank : -oneRank;
-	if (square + pawnDir + 1 >= 0 && square + pawnDir + 1 < 64 && getFile(square) < 8 && get_bit(bitboardPieces[(byColor == white) ? bb_wpawn : bb_bpawn], square + pawnDir + 1)) return true;
-	if (square + pawnDir - 1 >= 0 && square + pawnDir - 1 < 64 && getFile(square) > 1 && get_bit(bitboardPieces[(byColor == white) ? bb_wpawn : bb_bpawn], square + pawnDir - 1)) return true;
-
-	// Knight attacks
-	int knightOffsets[8] = { -17, -15, -10, -6, 6, 10, 15, 17 };
-	for (int offset : knightOffsets)
-	{
-		if (square + offset < 0 || square + offset > 63) continue;
-
-		int fromFile = square % 8;
-		int toFile = (square + offset) % 8;
-		int fileDiff = abs(toFile - fromFile);
-
-		int fromRank = square / 8;
-		int toRank = (square + offset) / 8;
-		int rankDiff = abs(toRank - fromRank);
-
-		if (!((fileDiff == 1 && rankDiff == 2) || (fileDiff == 2 && rankDiff == 1))) continue;
-
-		if (get_bit(bitboardPieces[(byColor == white) ? bb_wknight : bb_bknight], square + offset)) return true;
-	}
-
-	// Bishop/Queen
-	for (int i = 0; i <= 3; i++)
-	{
-		for (int j = 1; j <= 7; j++)
-		{
-			int squareToCheck = 0;
-			if (i == 0) squareToCheck = square - j * (oneRank - 1);
-			else if (i == 1) squareToCheck = square - j * (oneRank + 1);
-			else if (i == 2) squareToCheck = square + j * (oneRank - 1);
-			else if (i == 3) squareToCheck = square + j * (oneRank + 1);
-
-			if (squareToCheck > 63 || squareToCheck < 0) break;
-
-			int fromFile = getFile(square);
-			int toFile = getFile(squareToCheck);
-			if (abs(toFile - fromFile) != j) break;
-
-			int fromRank = getRank(square);
-			int toRank = getRank(squareToCheck);
-			if (abs(toRank - fromRank) != j) break;
-
-			if (get_bit(bitboardPieces[(byColor == white) ? bb_wbishop : bb_bbishop], squareToCheck)) return true;
-			if (get_bit(bitboardPieces[(byColor == white) ? bb_wqueen : bb_bqueen], squareToCheck)) return true;
-			if (get_bit(allPiecesOccupancy, squareToCheck) == 1) break;
-		}
-	}
-
-	// Rook/Queen
-	for (int i = 0; i <= 3; i++)
-	{
-		for (int j = 1; j <= 7; j++)
-		{
-			int squareToCheck = 0;
-			if (i == 0)
-			{
-				squareToCheck = square - j;
-				if (squareToCheck < 0 || getRank(square) != getRank(squareToCheck)) break;
-			}
-			else if (i == 1)
-			{
-				squareToCheck = square + j;
-				if (squareToCheck > 63 || getRank(square) != getRank(squareToCheck)) break;
-			}
-			else if (i == 2) squareToCheck = square - j * oneRank;
-			else if (i == 3) squareToCheck = square + j * oneRank;
-
-			if (squareToCheck > 63 || squareToCheck < 0) break;
-
-			if (get_bit(bitboardPieces[(byColor == white) ? bb_wrook : bb_brook], squareToCheck)) return true;
-			if (get_bit(bitboardPieces[(byColor == white) ? bb_wqueen : bb_bqueen], squareToCheck)) return true;
-			if (get_bit(allPiecesOccupancy, squareToCheck) == 1) break;
-		}
-	}
-
-	// King attacks (for checking if kings are adjacent)
-	int kingOffsets[8] = { -9, -8, -7, -1, 1, 7, 8, 9 };
-	for (int offset : kingOffsets)
-	{
-		if (square + offset < 0 || square + offset > 63) continue;
-		if (abs(getFile(square) - getFile(square + offset)) > 1) continue;
-		if (abs(getRank(square) - getRank(square + offset)) > 1) continue;
-
-		if (get_bit(bitboardPieces[(byColor == white) ? bb_wking : bb_bking], square + offset))
-			return true;
-	}
-
-	return false;
-}
-
-int findKing(Color c)
-{
-	int kingIndex = (c == white) ? bb_wking : bb_bking;
-
-	for (int square = 0; square < 64; square++)
-	{
-		if (get_bit(bitboardPieces[kingIndex], square))
-		{
-			return square;
-		}
-	}
-	return -1;
-}
-
-bool isKingInCheck(Color c)
-{
-	int kingSquare = findKing(c);
-	if (kingSquare == -1) return false;
-	return isSquareAttacked(kingSquare, (c == white) ? black : white);
-}
-
-// Bonus for pawns in center
-int pawnSquareTable[64] = {
-	 0,  0,  0,  0,  0,  0,  0,  0,
-	100, 100, 100, 100, 100, 100, 100, 100,
-	10, 10, 20, 80, 80, 20, 10, 10,
-	 5,  5, 10, 60, 60, 10,  5,  5,
-	 0,  0,  20, 50, 50,  20,  0,  0,
-	 5, -5,-10,  10,  10,-10, -5,  5,
-	 5, 10, 10,-20,-20, 10, 10,  5,
-	 0,  0,  0,  0,  0,  0,  0,  0
-};
-
-// Bonus for knights in center
-int knightSquareTable[64] = {
-   -50,-30,-30,-30,-30,-30,-30,-50,
-   -40,-20,  0,  0,  0,  0,-20,-40,
-   -40,  0, 10, 15, 15, 10,  0,-40,
-   -30,  5, 15, 20, 20, 15,  5,-30,
-   -30,  0, 15, 20, 20, 15,  0,-30,
-   -40,  5, 10, 15, 15, 10,  5,-40,
-   -40,-20,  0,  5,  5,  0,-20,-40,
-   -50,-30,-30,-30,-30,-30,-30,-50
-};
-
-// Bonus for king in corners
-int kingSquareTable[64] = {
-	-80,-70,-70,-70,-70,-70,-70,-80,
-	-60,-60,-60,-60,-60,-60,-60,-60,
-	-40,-40,-40,-40,-40,-40,-40,-40,
-	-20,-20,-20,-20,-20,-20,-20,-20,
-	  0,  0,  0,  0,  0,  0,  0,  0,
-	 20, 20, 20, 20, 20, 20, 20, 20,
-	 40, 40, 40, 40, 40, 40, 40, 40,
-	 60, 100, 40, 20, 20, 40, 100, 60
-};
-
-
-
-int pieceEvaluation()
-{
-	// Adds when white benefits/black loses, subtracts when white loses/black benefits
-	int evaluation{ 0 };
-
-	int heavyPieces{ 0 };
-
-
-	for (int square = a8; square <= h1; square++)
-	{
-		// From positioning & piece value
-
-		// White pawn
-		if (get_bit(bitboardPieces[bb_wpawn], square) == 1)
-		{
-			evaluation += pieceValue[bb_wpawn];
-			evaluation += pawnSquareTable[square];
-
-			if (get_bit(bitboardPieces[bb_wpawn], square - oneRank) == 1) evaluation -= 25; // Doubled
-		}
-		// Black pawn
-		else if (get_bit(bitboardPieces[bb_bpawn], square) == 1)
-		{
-			evaluation += pieceValue[bb_bpawn];
-			evaluation -= pawnSquareTable[h1 - square]; // Flip board
-
-			if (get_bit(bitboardPieces[bb_bpawn], square - oneRank) == 1) evaluation += 25; // Doubled
-		}
-		// White knight
-		else if (get_bit(bitboardPieces[bb_wknight], square) == 1)
-		{
-			heavyPieces += 1;
-			evaluation += pieceValue[bb_wknight];
-			evaluation += knightSquareTable[square];
-		}
-		// Black knight
-		else if (get_bit(bitboardPieces[bb_bknight], square) == 1)
-		{
-			heavyPieces += 1;
-			evaluation += pieceValue[bb_bknight];
-			evaluation -= knightSquareTable[square];
-		}
-		// White bishop/queen
-		else if (get_bit(bitboardPieces[bb_wbishop], square) == 1 || get_bit(bitboardPieces[bb_wqueen], square) == 1)
-		{
-			if (get_bit(bitboardPieces[bb_wbishop], square) == 1)
-			{
-				evaluation += pieceValue[bb_wbishop];
-				heavyPieces += 1;
-			}
-			if (get_bit(bitboardPieces[bb_wqueen], square) == 1)
-			{
-				evaluation += pieceValue[bb_wqueen];
-				heavyPieces += 1;
-			}
-
-			std::array<int, 4> bishopOffsets = { 7, 9, -7 , -9 };
-			for (int offset : bishopOffsets)
-			{
-
-				int squareToMove = square + offset;
-
-				if (squareToMove < 0 || squareToMove > 63) continue;
-
-				// Wrap around check
-				int fromFile = getFile(square);
-				int toFile = getFile(squareToMove);
-				if (abs(toFile - fromFile) != 1) continue;
-
-				int fromRank = getRank(square);
-				int toRank = getRank(squareToMove);
-				if (abs(toRank - fromRank) != 1) continue;
-
-				if (get_bit(whitePiecesOccupancy, squareToMove) == 0) evaluation += 20;
-				else if (get_bit(blackPiecesOccupancy, squareToMove) == 1)
-				{
-					evaluation += 5;
-					continue;
-				}
-			}
-		}
-		// Black bishop/queen
-		else if (get_bit(bitboardPieces[bb_bbishop], square) == 1 || get_bit(bitboardPieces[bb_bqueen], square) == 1)
-		{
-			if (get_bit(bitboardPieces[bb_bbishop], square) == 1)
-			{
-				evaluation += pieceValue[bb_bbishop];
-				heavyPieces += 1;
-			}
-			if (get_bit(bitboardPieces[bb_bqueen], square) == 1)
-			{
-				evaluation += pieceValue[bb_bqueen];
-				heavyPieces += 1;
-			}
-
-			std::array<int, 4> bishopOffsets = { 7, 9, -7 , -9 };
-			for (int offset : bishopOffsets)
-			{
-				int squareToMove = square + offset;
-
-				if (squareToMove < 0 || squareToMove > 63) continue;
-
-				// Wrap around check
-				int fromFile = getFile(square);
-				int toFile = getFile(squareToMove);
-				if (abs(toFile - fromFile) != 1) continue;
-
-				int fromRank = getRank(square);
-				int toRank = getRank(squareToMove);
-				if (abs(toRank - fromRank) != 1) continue;
-
-				if (get_bit(blackPiecesOccupancy, squareToMove) == 0) evaluation -= 20;
-				else if (get_bit(whitePiecesOccupancy, squareToMove) == 1)
-				{
-					evaluation -= 5;
-					continue;
-				}
-			}
-		}
-		// White rook/queen
-		else if (get_bit(bitboardPieces[bb_wrook], square) == 1 || get_bit(bitboardPieces[bb_wqueen], square) == 1)
-		{
-			if (get_bit(bitboardPieces[bb_wrook], square) == 1)
-			{
-				evaluation += pieceValue[bb_wrook];
-				heavyPieces += 1;
-			}
-			if (get_bit(bitboardPieces[bb_wqueen], square) == 1) evaluation += pieceValue[bb_wqueen];
-
-			if (square == a1)
-			{
-				if (get_bit(whitePiecesOccupancy, b1) == 1) evaluation -= 5;
-				if (get_bit(whitePiecesOccupancy, a2) == 1) evaluation -= 5;
-			}
-			else if (square == h1)
-			{
-				if (get_bit(whitePiecesOccupancy, g1) == 1) evaluation -= 5;
-				if (get_bit(whitePiecesOccupancy, h2) == 1) evaluation -= 5;
-			}
-
-			for (int i = 0; i <= 3; i++)
-			{
-				int squareToCheck = 0;
-				if (i == 0)
-				{
-					squareToCheck = square - 1;
-					if (squareToCheck < 0 || getRank(square) != getRank(squareToCheck)) continue;
-				}
-				else if (i == 1)
-				{
-					squareToCheck = square + 1;
-					if (squareToCheck > 63 || getRank(square) != getRank(squareToCheck)) continue;
-				}
-				else if (i == 2) squareToCheck = square - oneRank;
-				else if (i == 3) squareToCheck = square + oneRank;
-
-				if (squareToCheck > 63 || squareToCheck < 0) continue;
-
-				if (get_bit(whitePiecesOccupancy, squareToCheck) == 0) evaluation += 20;
-				else if (get_bit(blackPiecesOccupancy, squareToCheck) == 1)
-				{
-					evaluation += 5;
-					continue;
-				}
-			}
-		}
-		// Black rook/queen
-		else if (get_bit(bitboardPieces[bb_brook], square) == 1 || get_bit(bitboardPieces[bb_bqueen], square) == 1)
-		{
-			if (get_bit(bitboardPieces[bb_brook], square) == 1)
-			{
-				evaluation += pieceValue[bb_brook];
-				heavyPieces += 1;
-			}
-			if (get_bit(bitboardPieces[bb_bqueen], square) == 1) evaluation += pieceValue[bb_bqueen];
-
-			if (square == a8)
-			{
-				if (get_bit(whitePiecesOccupancy, b8) == 1) evaluation += 5;
-				if (get_bit(whitePiecesOccupancy, a7) == 1) evaluation += 5;
-			}
-			else if (square == h8)
-			{
-				if (get_bit(whitePiecesOccupancy, g8) == 1) evaluation += 5;
-				if (get_bit(whitePiecesOccupancy, h7) == 1) evaluation += 5;
-			}
-
-			for (int i = 0; i <= 3; i++)
-			{
-				int squareToCheck = 0;
-				if (i == 0)
-				{
-					squareToCheck = square - 1;
-					if (squareToCheck < 0 || getRank(square) != getRank(squareToCheck)) continue;
-				}
-				else if (i == 1)
-				{
-					squareToCheck = square + 1;
-					if (squareToCheck > 63 || getRank(square) != getRank(squareToCheck)) continue;
-				}
-				else if (i == 2) squareToCheck = square - oneRank;
-				else if (i == 3) squareToCheck = square + oneRank;
-
-				if (squareToCheck > 63 || squareToCheck < 0) continue;
-
-				if (get_bit(blackPiecesOccupancy, squareToCheck) == 0) evaluation -= 20;
-				else if (get_bit(whitePiecesOccupancy, squareToCheck) == 1)
-				{
-					evaluation -= 5;
-					continue;
-				}
-			}
-		}
-		// White king
-		else if (get_bit(bitboardPieces[bb_wking], square) == 1)
-		{
-			if (heavyPieces > 4) evaluation += kingSquareTable[square];
-			if (get_bit(bitboardPieces[bb_wpawn], square - oneRank) == 1) evaluation += 50;
-			if (get_bit(bitboardPieces[bb_wpawn], square - oneRank - 1) == 1) evaluation += 20;
-			if (get_bit(bitboardPieces[bb_wpawn], square - oneRank + 1) == 1) evaluation += 20;
-		}
-		// Black king
-		else if (get_bit(bitboardPieces[bb_bking], square) == 1)
-		{
-			if (heavyPieces > 4) evaluation -= kingSquareTable[63 - square]; // Flip
-			if (get_bit(bitboardPieces[bb_bpawn], square + oneRank) == 1) evaluation -= 50;
-			if (get_bit(bitboardPieces[bb_bpawn], square + oneRank - 1) == 1) evaluation -= 20;
-			if (get_bit(bitboardPieces[bb_bpawn], square + oneRank + 1) == 1) evaluation -= 20;
-		}
-	}
-
-	// Discourage early queen moves
-	if (get_bit(bitboardPieces[bb_wqueen], d1) == 0)
-	{
-		if (get_bit(bitboardPieces[bb_wknight], b1) == 1) evaluation -= 25;
-		if (get_bit(bitboardPieces[bb_wknight], g1) == 1) evaluation -= 25;
-
-		if (get_bit(bitboardPieces[bb_wbishop], c1) == 1) evaluation -= 25;
-		if (get_bit(bitboardPieces[bb_wbishop], f1) == 1) evaluation -= 25;
-	}
-	if (get_bit(bitboardPieces[bb_bqueen], d8) == 0)
-	{
-		if (get_bit(bitboardPieces[bb_bknight], b8) == 1) evaluation += 25;
-		if (get_bit(bitboardPieces[bb_bknight], g8) == 1) evaluation += 25;
-
-		if (get_bit(bitboardPieces[bb_bbishop], c8) == 1) evaluation += 25;
-		if (get_bit(bitboardPieces[bb_bbishop], f8) == 1) evaluation += 25;
-	}
-
-	// Castling
-	if (get_bit(bitboardPieces[bb_wking], g1)) evaluation += 60;
-	else if (get_bit(bitboardPieces[bb_wking], c1)) evaluation += 40;
-
-	if (get_bit(bitboardPieces[bb_bking], g8)) evaluation -= 60;
-	else if (get_bit(bitboardPieces[bb_bking], c8)) evaluation -= 40;
-
-	return evaluation;
-}
-
-int calculateEvaluation()
-{
-	int evaluation{ 0 };
-
-	evaluation += pieceEvaluation();
-
-	return evaluation;
-}
-
-
-void printBitboard(U64 bitboard)
-{
-	std::cout << '\n';
-
-	// Loop over ranks
-	for (int rank = 0; rank < 8; rank++)
-	{
-
-		// Loop over files
-		for (int file = 0; file < 8; file++)
-		{
-
-			// Create square index
-			int square = rank * 8 + file;
-
-			// Print rank info
-			if (file == 0)
-			{
-				std::cout << 8 - rank << "   ";
-			}
-
-			// Print bit state (either 1 or 0)
-			std::cout << (get_bit(bitboard, square)) << " ";
-		}
-
-		// New line every rank
-		std::cout << '\n';
-	}
-
-	// Print file info
-	std::cout << '\n' << "    A B C D E F G H" << '\n';
-}
-
-void printMainboard()
-{
-	std::cout << "\n";
-
-	for (int index = a8; index <= h1; index++)
-	{
-
-		// Print rank info
-		if (index % 8 == 0)
-		{
-			int rank = 8 - (index / 8);
-			std::cout << rank << "  ";
-		}
-
-		// Print square
-		std::cout << pieceToChar(mainBoard[index]) << " ";
-
-		// New line every rank
-		if (index % 8 == 7)
-		{
-			std::cout << "\n";
-		}
-	}
-
-	// Print file letters
-	std::cout << "\n   A B C D E F G H\n";
-	std::cout << '\n';
-}
-
-// Encode a move (Flag | From | To)
-inline Move encodeMove(int from, int to, int flag)
-{
-	return (flag << 12) | (from << 6) | to;
-}
-
-inline int getFrom(Move m) { return (m >> 6) & 0x3F; }
-inline int getTo(Move m) { return m & 0x3F; }
-inline int getFlag(Move m) { return (m >> 12) & 0xF; }
-
-std::vector<Move> whiteMoveLog;
-std::vector<Move> blackMoveLog;
-
-// GENERATE ALL PSEUDO LEGAL MOVES (checks legality after)
-void getPseudoLegalMoves(Color c, std::array<Move, MAX_MOVES>& moveStack, int& moveCount)
-{
-	moveCount = 0;
-
-	U64 currBitboard; // temporary bitboard for checking
-
-	// Return opposite color to check for captures
-	U64 currOccupancy = (c == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
-	U64 oppOccupancy = (c == white) ? blackPiecesOccupancy : whitePiecesOccupancy;
-
-	bool kingSideCastlingRights = (c == white) ? whiteKingSideCastlingRights : blackKingSideCastlingRights;
-	bool queenSideCastlingRights = (c == white) ? whiteQueenSideCastlingRights : blackQueenSideCastlingRights;
-
-	// Iterate through every square
-	for (int square = a8; square <= h1; square++)
-	{
-		// Pawn Moves
-		if (c == white && moveCount < 256 && moveCount >= 0)
-		{
-			// White pawn moves
-			if (get_bit(bitboardPieces[bb_wpawn], square) == 1)
-			{
-
-				// Push
-				if (getRank(square) <= 6 && get_bit(allPiecesOccupancy, square - oneRank) == 0)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank, quiet_move);
-						moveCount++;
-					}
-				}
-
-				// Double push
-				if (getRank(square) == 2 && get_bit(allPiecesOccupancy, square - oneRank) == 0
-					&& get_bit(allPiecesOccupancy, square - oneRank * 2) == 0)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank * 2, double_pawn_push);
-						moveCount++;
-					}
-				}
-
-				// Pawn capture left
-				if (getRank(square) <= 6 && getFile(square) > 1 && get_bit(oppOccupancy, square - oneRank - 1) == 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank - 1, capture);
-						moveCount++;
-					}
-				}
-				// Pawn capture right
-				if (getFile(square) < 8 && getRank(square) <= 6 && get_bit(oppOccupancy, square - oneRank + 1) == 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank + 1, capture);
-						moveCount++;
-					}
-				}
-
-				// En passant capture
-				int lastBlackMove = (blackMoveLog.size() != 0) ? blackMoveLog.back() : 0;
-				int lastBlackFlag = getFlag(lastBlackMove);
-				// Left
-				if (lastBlackFlag == double_pawn_push && getFile(square) > 1 && getRank(square) == 5 && getTo(lastBlackMove) == square - 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank - 1, en_passant_capture);
-						moveCount++;
-					}
-				}
-				// Right
-				if (lastBlackFlag == double_pawn_push && getFile(square) < 8 && getRank(square) == 5 && getTo(lastBlackMove) == square + 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank + 1, en_passant_capture);
-						moveCount++;
-					}
-				}
-
-				// Promotions (no capture)
-				if (getRank(square) == 7 && get_bit(allPiecesOccupancy, square - oneRank) == 0)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank, knight_promotion);
-						moveCount++;
-					}
-
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank, bishop_promotion);
-						moveCount++;
-					}
-
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank, rook_promotion);
-						moveCount++;
-					}
-
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank, queen_promotion);
-						moveCount++;
-					}
-				}
-
-				// Promotion capture left
-				if (getFile(square) > 1 && getRank(square) == 7 && get_bit(oppOccupancy, square - oneRank - 1) == 1)
-				{
-
-					// Knight
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank - 1, knight_promo_capture);
-						moveCount++;
-					}
-
-					// Bishop
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank - 1, bishop_promo_capture);
-						moveCount++;
-					}
-
-					// Rook
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank - 1, rook_promo_capture);
-						moveCount++;
-					}
-
-					// Queen
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank - 1, queen_promo_capture);
-						moveCount++;
-					}
-				}
-				// Promotion capture right
-				if (getFile(square) < 8 && getRank(square) == 7 && get_bit(oppOccupancy, square - oneRank + 1) == 1)
-				{
-
-					// Knight
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank + 1, knight_promo_capture);
-						moveCount++;
-					}
-
-					// Bishop
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank + 1, bishop_promo_capture);
-						moveCount++;
-					}
-
-					// Rook
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank + 1, rook_promo_capture);
-						moveCount++;
-					}
-
-					// Queen
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square - oneRank + 1, queen_promo_capture);
-						moveCount++;
-					}
-				}
-			}
-		}
-		else if (c == black && moveCount < 256 && moveCount >= 0)
-		{
-			// Black pawn moves
-			if (get_bit(bitboardPieces[bb_bpawn], square) == 1)
-			{
-				// Push
-				if (getRank(square) >= 3 && get_bit(allPiecesOccupancy, square + oneRank) == 0)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank, quiet_move);
-						moveCount++;
-					}
-				}
-
-				// Double push
-				if (getRank(square) == 7 && get_bit(allPiecesOccupancy, square + oneRank) == 0
-					&& get_bit(allPiecesOccupancy, square + oneRank * 2) == 0)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank * 2, double_pawn_push);
-						moveCount++;
-					}
-				}
-
-				// Pawn capture left
-				if (getRank(square) >= 3 && getFile(square) > 1 && get_bit(oppOccupancy, square + oneRank - 1) == 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank - 1, capture);
-						moveCount++;
-					}
-				}
-				// Pawn capture right
-				if (getRank(square) >= 3 && getFile(square) < 8 && get_bit(oppOccupancy, square + oneRank + 1) == 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank + 1, capture);
-						moveCount++;
-					}
-				}
-
-				// En passant capture
-				int lastWhiteMove = (whiteMoveLog.size() != 0) ? whiteMoveLog.back() : 0;
-				int lastWhiteFlag = getFlag(lastWhiteMove);
-				// Left
-				if (lastWhiteFlag == double_pawn_push && getFile(square) > 1 && getRank(square) == 4 && getTo(lastWhiteMove) == square - 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank - 1, en_passant_capture);
-						moveCount++;
-					}
-				}
-				// Right
-				if (lastWhiteFlag == double_pawn_push && getFile(square) < 8 && getRank(square) == 4 && getTo(lastWhiteMove) == square + 1)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank + 1, en_passant_capture);
-						moveCount++;
-					}
-				}
-
-				// Promotions (no capture)
-				if (getRank(square) == 2 && get_bit(allPiecesOccupancy, square + oneRank) == 0)
-				{
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank, knight_promotion);
-						moveCount++;
-					}
-
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank, bishop_promotion);
-						moveCount++;
-					}
-
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank, rook_promotion);
-						moveCount++;
-					}
-
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank, queen_promotion);
-						moveCount++;
-					}
-				}
-
-				// Promotion capture left
-				if (getFile(square) > 1 && getRank(square) == 2 && get_bit(oppOccupancy, square + oneRank - 1) == 1)
-				{
-
-					// Knight
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank - 1, knight_promo_capture);
-						moveCount++;
-					}
-					// Bishop
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank - 1, bishop_promo_capture);
-						moveCount++;
-					}
-					// Rook
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank - 1, rook_promo_capture);
-						moveCount++;
-					}
-					// Queen
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank - 1, queen_promo_capture);
-						moveCount++;
-					}
-				}
-				// Promotion capture right
-				if (getFile(square) < 8 && getRank(square) == 2 && get_bit(oppOccupancy, square + oneRank + 1) == 1)
-				{
-
-					// Knight
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank + 1, knight_promo_capture);
-						moveCount++;
-					}
-					// Bishop
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank + 1, bishop_promo_capture);
-						moveCount++;
-					}
-					// Rook
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank + 1, rook_promo_capture);
-						moveCount++;
-					}
-					// Queen
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + oneRank + 1, queen_promo_capture);
-						moveCount++;
-					}
-				}
-			}
-		}
-
-
-		// Knight
-
-		currBitboard = (c == white) ? bitboardPieces[bb_wknight] : bitboardPieces[bb_bknight];
-
-		if (get_bit(currBitboard, square) == 1)
-		{
-			int knightOffsets[8] = { -17, -15, -10, -6, 6, 10, 15, 17 };
-
-			for (int offset : knightOffsets)
-			{
-				if (square + offset > 63 || square + offset < 0) continue;
-
-				int fromFile = square % 8;
-				int toFile = (square + offset) % 8;
-				int fileDiff = abs(toFile - fromFile);
-
-				int fromRank = square / 8;
-				int toRank = (square + offset) / 8;
-				int rankDiff = abs(toRank - fromRank);
-
-				if (!((fileDiff == 1 && rankDiff == 2) || (fileDiff == 2 && rankDiff == 1))) continue;
-				if (abs((square + offset) - square) > 17) continue;
-
-				if (get_bit(allPiecesOccupancy, square + offset) == 0)
-				{
-					// Quiet move
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + offset, quiet_move);
-						moveCount++;
-					}
-				}
-				else if (get_bit(oppOccupancy, square + offset) == 1)
-				{
-					// Capture
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + offset, capture);
-						moveCount++;
-					}
-				}
-
-			}
-		}
-
-		// Bishop
-
-		currBitboard = (c == white) ? bitboardPieces[bb_wbishop] : bitboardPieces[bb_bbishop];
-
-		if (get_bit(currBitboard, square) == 1)
-		{
-			int squareToMove{ 0 };
-
-			// Quiet moves & Captures
-			for (int i = 0; i <= 3; i++)
-			{
-				for (int j = 1; j <= 7; j++)
-				{
-					if (i == 0) { squareToMove = square - j * (oneRank - 1); } // Top left
-					else if (i == 1) { squareToMove = square - j * (oneRank + 1); } // Top right
-					else if (i == 2) { squareToMove = square + j * (oneRank - 1); } // Bottom left
-					else if (i == 3) { squareToMove = square + j * (oneRank + 1); } // Bottom right
-
-					if (squareToMove > 63 || squareToMove < 0) break;
-
-					// Prevent file wrap around
-					int fromFile = square % 8;
-					int toFile = squareToMove % 8;
-					if (abs(toFile - fromFile) != j) break;
-
-					// Prevent other bugs
-					int fromRank = getRank(square);
-					int toRank = getRank(squareToMove);
-					if (abs(toRank - fromRank) != j) break;
-
-					if (get_bit(allPiecesOccupancy, squareToMove) == 0)
-					{
-						// Quiet move
-						if (moveCount < MAX_MOVES)
-						{
-							moveStack[moveCount] = encodeMove(square, squareToMove, quiet_move);
-							moveCount++;
-						}
-					}
-					else if (get_bit(oppOccupancy, squareToMove) == 1)
-					{
-						// Capture
-						if (moveCount < MAX_MOVES)
-						{
-							moveStack[moveCount] = encodeMove(square, squareToMove, capture);
-							moveCount++;
-						}
-						break;
-					}
-					else if (get_bit(currOccupancy, squareToMove) == 1)
-					{
-						// Same color piece blocks the way, break.
-						break;
-					}
-				}
-			}
-		}
-
-		// Rook
-
-		currBitboard = (c == white) ? bitboardPieces[bb_wrook] : bitboardPieces[bb_brook];
-
-		if (get_bit(currBitboard, square) == 1)
-		{
-			int squareToMove{ 0 };
-
-			// Quiet moves & Captures
-			for (int i = 0; i <= 3; i++)
-			{
-				for (int j = 1; j <= 7; j++)
-				{
-					if (i == 0)
-					{
-						// Left
-						squareToMove = square - j;
-						if (getRank(square) != getRank(squareToMove)) { break; }
-					}
-					else if (i == 1)
-					{
-						// Right
-						squareToMove = square + j;
-						if (getRank(square) != getRank(squareToMove)) { break; }
-					}
-					else if (i == 2) { squareToMove = square - j * (oneRank); } // Up
-					else if (i == 3) { squareToMove = square + j * (oneRank); } // Down
-
-					if (squareToMove > 63 || squareToMove < 0 || moveCount >= 256) break;
-
-					if (get_bit(allPiecesOccupancy, squareToMove) == 0)
-					{
-						// Quiet move
-						if (moveCount < MAX_MOVES)
-						{
-							moveStack[moveCount] = encodeMove(square, squareToMove, quiet_move);
-							moveCount++;
-						}
-					}
-					else if (get_bit(oppOccupancy, squareToMove) == 1)
-					{
-						// Capture
-						if (moveCount < MAX_MOVES)
-						{
-							moveStack[moveCount] = encodeMove(square, squareToMove, capture);
-							moveCount++;
-						}
-						break;
-					}
-					else if (get_bit(currOccupancy, squareToMove) == 1)
-					{
-						// Same color piece blocks the way, break.
-						break;
-					}
-				}
-			}
-		}
-
-		// Queen
-
-		currBitboard = (c == white) ? bitboardPieces[bb_wqueen] : bitboardPieces[bb_bqueen];
-
-		if (get_bit(currBitboard, square) == 1)
-		{
-			int squareToMove{ 0 };
-
-			// Quiet moves & Captures
-			for (int i = 0; i <= 7; i++)
-			{
-				for (int j = 1; j <= 7; j++)
-				{
-					if (i == 0)
-					{
-						// Left
-						squareToMove = square - j;
-						if (getRank(square) != getRank(squareToMove)) { break; }
-					}
-					else if (i == 1)
-					{
-						// Right
-						squareToMove = square + j;
-						if (getRank(square) != getRank(squareToMove)) { break; }
-					}
-					else if (i == 2) { squareToMove = square - j * (oneRank); } // Up
-					else if (i == 3) { squareToMove = square + j * (oneRank); } // Down
-					else if (i == 4) { squareToMove = square - j * (oneRank - 1); } // Top left
-					else if (i == 5) { squareToMove = square - j * (oneRank + 1); } // Top right
-					else if (i == 6) { squareToMove = square + j * (oneRank - 1); } // Bottom left
-					else if (i == 7) { squareToMove = square + j * (oneRank + 1); } // Bottom right
-
-					if (squareToMove > 63 || squareToMove < 0 || moveCount >= 256) break;
-
-					if (i >= 4)
-					{
-						// Prevent file wrap around
-						int fromFile = square % 8;
-						int toFile = squareToMove % 8;
-						if (abs(toFile - fromFile) != j) break;
-
-						// Prevent other bugs
-						int fromRank = getRank(square);
-						int toRank = getRank(squareToMove);
-						if (abs(toRank - fromRank) != j) break;
-					}
-
-
-					if (get_bit(allPiecesOccupancy, squareToMove) == 0)
-					{
-						// Quiet move
-						if (moveCount < MAX_MOVES)
-						{
-							moveStack[moveCount] = encodeMove(square, squareToMove, quiet_move);
-							moveCount++;
-						}
-					}
-					else if (get_bit(oppOccupancy, squareToMove) == 1)
-					{
-						// Capture
-						if (moveCount < MAX_MOVES)
-						{
-							moveStack[moveCount] = encodeMove(square, squareToMove, capture);
-							moveCount++;
-						}
-						break;
-					}
-					else if (get_bit(currOccupancy, squareToMove) == 1)
-					{
-						// Same piece blocks the way, break.
-						break;
-					}
-				}
-			}
-		}
-
-		// King
-
-		currBitboard = (c == white) ? bitboardPieces[bb_wking] : bitboardPieces[bb_bking];
-
-		if (get_bit(currBitboard, square) == 1 && moveCount < 256)
-		{
-			int kingOffsets[8] = { -9, -8, -7, -1, 1, 8 - 1, 8, 9 };
-			for (int offset : kingOffsets)
-			{
-				if (square + offset < 0 || square + offset > 63) continue;
-
-				if (abs(getFile(square) - getFile(square + offset)) > 1 || abs(getRank(square) - getRank(square + offset)) > 1) continue;
-
-				if (isSquareAttacked(square + offset, (c == white) ? black : white)) continue;
-
-				if (get_bit(allPiecesOccupancy, square + offset) == 0)
-				{
-					/// Quiet move
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + offset, quiet_move);
-						moveCount++;
-					}
-				}
-				else if (get_bit(oppOccupancy, square + offset) == 1)
-				{
-					// Capture
-					if (moveCount < MAX_MOVES)
-					{
-						moveStack[moveCount] = encodeMove(square, square + offset, capture);
-						moveCount++;
-					}
-				}
-			}
-
-			int kingSquare = (c == white) ? e1 : e8;
-
-			if (kingSideCastlingRights && get_bit(currBitboard, kingSquare) == 1 && get_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], (c == white) ? h1 : h8) == 1
-				&& get_bit(allPiecesOccupancy, square + 1) == 0 && get_bit(allPiecesOccupancy, square + 2) == 0)
-			{
-				// King side castling
-				if (moveCount < MAX_MOVES)
-				{
-					// Ensure no castling through checks
-					Color opponent = (c == white) ? black : white;
-					if (!isSquareAttacked(square, opponent) && !isSquareAttacked(square + 1, opponent) && !isSquareAttacked(square + 2, opponent))
-					{
-						moveStack[moveCount] = encodeMove(square, square + 2, king_side_castle);
-						moveCount++;
-					}
-				}
-			}
-
-			if (queenSideCastlingRights && get_bit(currBitboard, kingSquare) == 1 && get_bit(bitboardPieces[((c == white) ? bb_wrook : bb_brook)], ((c == white) ? a1 : a8)) == 1
-				&& get_bit(allPiecesOccupancy, square - 1) == 0 && get_bit(allPiecesOccupancy, square - 2) == 0 && get_bit(allPiecesOccupancy, square - 3) == 0)
-			{
-				// Queen side castling
-				if (moveCount < MAX_MOVES)
-				{
-					// Ensure no castling through checks
-					Color opponent = (c == white) ? black : white;
-					if (!isSquareAttacked(square, opponent) && !isSquareAttacked(square - 1, opponent) && !isSquareAttacked(square - 2, opponent))
-					{
-						moveStack[moveCount] = encodeMove(square, square - 2, queen_side_castle);
-						moveCount++;
-					}
-				}
-			}
-		}
-	}
-
-	if (moveCount > MAX_MOVES)
-	{
-		moveCount = MAX_MOVES;  // Clamp it
-	}
-}
-
-std::array<bool, MAX_DEPTH> savedWKS, savedWQS, savedBKS, savedBQS;
-
-void makeMove(Move m, Color c, int ply)
-{
-	savedWKS[ply] = whiteKingSideCastlingRights;
-	savedWQS[ply] = whiteQueenSideCastlingRights;
-	savedBKS[ply] = blackKingSideCastlingRights;
-	savedBQS[ply] = blackQueenSideCastlingRights;
-
-	int from = getFrom(m);
-	int to = getTo(m);
-	int flag = getFlag(m);
-
-	int currPieceIndex = getPieceIndex(from);
-
-	int pawnbbIndex = (c == white) ? bb_wpawn : bb_bpawn;
-
-	int& whichOppPieceIndex = (c == white) ? whichBlackPieceIndexWasThere[ply] : whichWhitePieceIndexWasThere[ply];
-
-	Color cOpp = (c == white) ? black : white;
-
-	U64& currOccupancy = (c == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
-	U64& oppOccupancy = (c == white) ? blackPiecesOccupancy : whitePiecesOccupancy;
-
-	bool& kingSideCastlingRights = (c == white) ? whiteKingSideCastlingRights : blackKingSideCastlingRights;
-	bool& queenSideCastlingRights = (c == white) ? whiteQueenSideCastlingRights : blackQueenSideCastlingRights;
-
-	if (flag == capture || flag >= knight_promo_capture)
-	{
-		whichOppPieceIndex = getPieceIndex(to); // No need to check for ep, a pawn was always there
-	}
-
-	// Quiet move / pawn double push
-	if (flag == quiet_move || flag == double_pawn_push)
-	{
-		pop_bit(bitboardPieces[currPieceIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		set_bit(bitboardPieces[currPieceIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, currPieceIndex);
-
-		positionKey ^= zobristPieces[currPieceIndex][from];
-		positionKey ^= zobristPieces[currPieceIndex][to];
-
-	}
-
-	// Capture
-	else if (flag == capture)
-	{
-		pop_bit(bitboardPieces[currPieceIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		pop_bit(bitboardPieces[getPieceIndex(to)], to);
-		pop_bit(oppOccupancy, to);
-
-		set_bit(bitboardPieces[currPieceIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, currPieceIndex);
-
-		positionKey ^= zobristPieces[currPieceIndex][from];
-		positionKey ^= zobristPieces[getPieceIndex(to)][to];
-		positionKey ^= zobristPieces[currPieceIndex][to];
-	}
-
-	// Promotion (no capture)
-	else if (flag >= knight_promotion && flag <= queen_promotion)
-	{
-		int promoIndex{ 0 };
-		if (flag == knight_promotion)
-		{
-			promoIndex = (c == white) ? bb_wknight : bb_bknight;
-		}
-		else if (flag == bishop_promotion)
-		{
-			promoIndex = (c == white) ? bb_wbishop : bb_bbishop;
-		}
-		else if (flag == rook_promotion)
-		{
-			promoIndex = (c == white) ? bb_wrook : bb_brook;
-		}
-		else if (flag == queen_promotion)
-		{
-			promoIndex = (c == white) ? bb_wqueen : bb_bqueen;
-		}
-
-		pop_bit(bitboardPieces[pawnbbIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		set_bit(bitboardPieces[promoIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, promoIndex);
-
-		positionKey ^= zobristPieces[pawnbbIndex][from];
-		positionKey ^= zobristPieces[promoIndex][to];
-	}
-
-	// Promotion with capture
-	else if (flag >= knight_promo_capture)
-	{
-		int promoIndex{ 0 };
-		if (flag == knight_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wknight : bb_bknight;
-		}
-		else if (flag == bishop_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wbishop : bb_bbishop;
-		}
-		else if (flag == rook_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wrook : bb_brook;
-		}
-		else if (flag == queen_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wqueen : bb_bqueen;
-		}
-
-		pop_bit(bitboardPieces[pawnbbIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		pop_bit(bitboardPieces[getPieceIndex(to)], to);
-		pop_bit(oppOccupancy, to);
-
-		set_bit(bitboardPieces[promoIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, promoIndex);
-
-		positionKey ^= zobristPieces[pawnbbIndex][from];
-		positionKey ^= zobristPieces[getPieceIndex(to)][to];
-		positionKey ^= zobristPieces[promoIndex][to];
-	}
-
-	// En passant
-	else if (flag == en_passant_capture)
-	{
-		//printMainboard();
-		whichOppPieceIndex = (c == white) ? bb_bpawn : bb_wpawn; // Store captured pawn
-		pop_bit(bitboardPieces[pawnbbIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		pop_bit(bitboardPieces[(c == white) ? bb_bpawn : bb_wpawn], to + ((c == white) ? oneRank : -oneRank));
-		pop_bit(oppOccupancy, to + ((c == white) ? oneRank : -oneRank));
-		pop_bit(allPiecesOccupancy, to + ((c == white) ? oneRank : -oneRank));
-		mainBoard[to + ((c == white) ? oneRank : -oneRank)] = epc_empty;
-
-		set_bit(bitboardPieces[pawnbbIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, pawnbbIndex);
-		//printMainboard();
-
-		positionKey ^= zobristPieces[pawnbbIndex][from];
-		positionKey ^= zobristPieces[(c == white) ? bb_bpawn : bb_wpawn][to + ((c == white) ? oneRank : -oneRank)];
-		positionKey ^= zobristPieces[pawnbbIndex][to];
-	}
-
-	// King side castling
-	else if (flag == king_side_castle && kingSideCastlingRights)
-	{
-		int kingIndex = (c == white) ? bb_wking : bb_bking;
-
-		pop_bit(bitboardPieces[kingIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		pop_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], from + 3);
-		pop_bit(currOccupancy, from + 3);
-		pop_bit(allPiecesOccupancy, from + 3);
-		mainBoard[from] = epc_empty;
-		mainBoard[from + 3] = epc_empty;
-
-		set_bit(bitboardPieces[kingIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		set_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], to - 1);
-		set_bit(currOccupancy, to - 1);
-		set_bit(allPiecesOccupancy, to - 1);
-		mainBoard[to] = convertPieceIndexToEPC(c, kingIndex);
-		mainBoard[to - 1] = convertPieceIndexToEPC(c, (c == white) ? bb_wrook : bb_brook);
-
-		positionKey ^= zobristPieces[kingIndex][from];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][from + 3];
-
-		positionKey ^= zobristPieces[kingIndex][to];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][to - 1];
-	}
-
-	// Queen side castling
-	else if (flag == queen_side_castle && queenSideCastlingRights)
-	{
-		int kingIndex = (c == white) ? bb_wking : bb_bking;
-
-		pop_bit(bitboardPieces[kingIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		pop_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], from - 4);
-		pop_bit(currOccupancy, from - 4);
-		pop_bit(allPiecesOccupancy, from - 4);
-		mainBoard[from] = epc_empty;
-		mainBoard[from - 4] = epc_empty;
-
-		set_bit(bitboardPieces[kingIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		set_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], to + 1);
-		set_bit(currOccupancy, to + 1);
-		set_bit(allPiecesOccupancy, to + 1);
-		mainBoard[to] = convertPieceIndexToEPC(c, kingIndex);
-		mainBoard[to + 1] = convertPieceIndexToEPC(c, (c == white) ? bb_wrook : bb_brook);
-
-		positionKey ^= zobristPieces[kingIndex][from];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][from - 4];
-
-		positionKey ^= zobristPieces[kingIndex][to];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][to + 1];
-	}
-
-	((c == white) ? whiteMoveLog : blackMoveLog).push_back(m);
-
-	if (from == e1 || to == e1) { whiteKingSideCastlingRights = false; whiteQueenSideCastlingRights = false; }
-	if (from == e8 || to == e8) { blackKingSideCastlingRights = false; blackQueenSideCastlingRights = false; }
-	if (from == a1 || to == a1) whiteQueenSideCastlingRights = false;
-	if (from == h1 || to == h1) whiteKingSideCastlingRights = false;
-	if (from == a8 || to == a8) blackQueenSideCastlingRights = false;
-	if (from == h8 || to == h8) blackKingSideCastlingRights = false;
-
-	positionKey ^= zobristSideToMove;
-}
-
-void unmakeMove(Move m, Color c, int ply)
-{
-	int from = getTo(m);
-	int to = getFrom(m);
-	int flag = getFlag(m);
-
-	int currPieceIndex = getPieceIndex(from);
-
-	int pawnbbIndex = (c == white) ? bb_wpawn : bb_bpawn;
-
-	int whichOppPieceIndex = (c == white) ? whichBlackPieceIndexWasThere[ply] : whichWhitePieceIndexWasThere[ply];
-
-	Color cOpp = (c == white) ? black : white;
-
-	U64& currOccupancy = (c == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
-	U64& oppOccupancy = (c == white) ? blackPiecesOccupancy : whitePiecesOccupancy;
-
-	bool& kingSideCastlingRights = (c == white) ? whiteKingSideCastlingRights : blackKingSideCastlingRights;
-	bool& queenSideCastlingRights = (c == white) ? whiteQueenSideCastlingRights : blackQueenSideCastlingRights;
-
-	// Quiet move / double pawn push
-	if (flag == quiet_move || flag == double_pawn_push)
-	{
-		pop_bit(bitboardPieces[currPieceIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		set_bit(bitboardPieces[currPieceIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, currPieceIndex);
-
-		positionKey ^= zobristPieces[currPieceIndex][from];
-		positionKey ^= zobristPieces[currPieceIndex][to];
-	}
-
-	// Capture
-	else if (flag == capture)
-	{
-		pop_bit(bitboardPieces[currPieceIndex], from);
-		pop_bit(currOccupancy, from);
-		mainBoard[from] = convertPieceIndexToEPC(cOpp, whichOppPieceIndex);
-
-		set_bit(bitboardPieces[whichOppPieceIndex], from);
-		set_bit(oppOccupancy, from);
-
-		set_bit(bitboardPieces[currPieceIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, currPieceIndex);
-
-		positionKey ^= zobristPieces[currPieceIndex][from];
-		positionKey ^= zobristPieces[whichOppPieceIndex][from];
-		positionKey ^= zobristPieces[currPieceIndex][to];
-	}
-
-	// Promotion without capture
-	else if (flag >= knight_promotion && flag <= queen_promotion)
-	{
-		int promoIndex{ 0 };
-		if (flag == knight_promotion)
-		{
-			promoIndex = (c == white) ? bb_wknight : bb_bknight;
-		}
-		else if (flag == bishop_promotion)
-		{
-			promoIndex = (c == white) ? bb_wbishop : bb_bbishop;
-		}
-		else if (flag == rook_promotion)
-		{
-			promoIndex = (c == white) ? bb_wrook : bb_brook;
-		}
-		else if (flag == queen_promotion)
-		{
-			promoIndex = (c == white) ? bb_wqueen : bb_bqueen;
-		}
-
-		pop_bit(bitboardPieces[promoIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		set_bit(bitboardPieces[pawnbbIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, pawnbbIndex);
-
-		positionKey ^= zobristPieces[pawnbbIndex][from];
-		positionKey ^= zobristPieces[pawnbbIndex][to];
-	}
-
-	// Promotion with capture
-	else if (flag >= knight_promo_capture && flag <= queen_promo_capture)
-	{
-		int promoIndex{ 0 };
-		if (flag == knight_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wknight : bb_bknight;
-		}
-		else if (flag == bishop_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wbishop : bb_bbishop;
-		}
-		else if (flag == rook_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wrook : bb_brook;
-		}
-		else if (flag == queen_promo_capture)
-		{
-			promoIndex = (c == white) ? bb_wqueen : bb_bqueen;
-		}
-
-		pop_bit(bitboardPieces[promoIndex], from);
-		pop_bit(currOccupancy, from);
-		mainBoard[from] = convertPieceIndexToEPC(cOpp, whichOppPieceIndex);
-
-		set_bit(bitboardPieces[whichOppPieceIndex], from);
-		set_bit(oppOccupancy, from);
-
-		set_bit(bitboardPieces[pawnbbIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, pawnbbIndex);
-
-		positionKey ^= zobristPieces[promoIndex][from];
-		positionKey ^= zobristPieces[whichOppPieceIndex][from];
-		positionKey ^= zobristPieces[pawnbbIndex][to];
-	}
-
-	// En passant
-	else if (flag == en_passant_capture)
-	{
-		//printMainboard();
-		pop_bit(bitboardPieces[pawnbbIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		mainBoard[from] = epc_empty;
-
-		int capturedPawnSquare = getTo(m) + ((c == white) ? oneRank : -oneRank);
-
-		set_bit(bitboardPieces[(c == white) ? bb_bpawn : bb_wpawn], capturedPawnSquare);
-		set_bit(oppOccupancy, capturedPawnSquare);
-		set_bit(allPiecesOccupancy, capturedPawnSquare);
-		mainBoard[capturedPawnSquare] = convertPieceIndexToEPC(cOpp, (c == white) ? bb_bpawn : bb_wpawn);
-
-		set_bit(bitboardPieces[pawnbbIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		mainBoard[to] = convertPieceIndexToEPC(c, pawnbbIndex);
-		//printMainboard();
-
-		positionKey ^= zobristPieces[pawnbbIndex][from];
-		positionKey ^= zobristPieces[(c == white) ? bb_bpawn : bb_wpawn][capturedPawnSquare];
-		positionKey ^= zobristPieces[pawnbbIndex][to];
-	}
-
-	// King side castling
-	else if (flag == king_side_castle)
-	{
-		int kingIndex = (c == white) ? bb_wking : bb_bking;
-
-		pop_bit(bitboardPieces[kingIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		pop_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], from - 1);
-		pop_bit(currOccupancy, from - 1);
-		pop_bit(allPiecesOccupancy, from - 1);
-		mainBoard[from] = epc_empty;
-		mainBoard[from - 1] = epc_empty;
-
-		set_bit(bitboardPieces[kingIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		set_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], to + 3);
-		set_bit(currOccupancy, to + 3);
-		set_bit(allPiecesOccupancy, to + 3);
-		mainBoard[to] = convertPieceIndexToEPC(c, kingIndex);
-		mainBoard[to + 3] = convertPieceIndexToEPC(c, (c == white) ? bb_wrook : bb_brook);
-
-		positionKey ^= zobristPieces[kingIndex][from];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][from - 1];
-
-		positionKey ^= zobristPieces[kingIndex][to];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][to + 3];
-	}
-
-	// Queen side castling
-	else if (flag == queen_side_castle)
-	{
-		int kingIndex = (c == white) ? bb_wking : bb_bking;
-
-		pop_bit(bitboardPieces[kingIndex], from);
-		pop_bit(currOccupancy, from);
-		pop_bit(allPiecesOccupancy, from);
-		pop_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], from + 1);
-		pop_bit(currOccupancy, from + 1);
-		pop_bit(allPiecesOccupancy, from + 1);
-		mainBoard[from] = epc_empty;
-		mainBoard[from + 1] = epc_empty;
-
-		set_bit(bitboardPieces[kingIndex], to);
-		set_bit(currOccupancy, to);
-		set_bit(allPiecesOccupancy, to);
-		set_bit(bitboardPieces[(c == white) ? bb_wrook : bb_brook], to - 4);
-		set_bit(currOccupancy, to - 4);
-		set_bit(allPiecesOccupancy, to - 4);
-		mainBoard[to] = convertPieceIndexToEPC(c, kingIndex);
-		mainBoard[to - 4] = convertPieceIndexToEPC(c, (c == white) ? bb_wrook : bb_brook);
-
-		positionKey ^= zobristPieces[kingIndex][from];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][from + 1];
-
-		positionKey ^= zobristPieces[kingIndex][to];
-		positionKey ^= zobristPieces[(c == white) ? bb_wrook : bb_brook][to - 4];
-	}
-
-	((c == white) ? whiteMoveLog : blackMoveLog).pop_back();
-
-	whiteKingSideCastlingRights = savedWKS[ply];
-	whiteQueenSideCastlingRights = savedWQS[ply];
-	blackKingSideCastlingRights = savedBKS[ply];
-	blackQueenSideCastlingRights = savedBQS[ply];
-
-	positionKey ^= zobristSideToMove;
-}
-
-std::array<int, 12> pieceValueMVV = { 100, 100, 300, 300, 300, 300, 500, 500, 900, 900, 10000, 10000 };
-
-int scoreMove(Color c, Move m)
-{
-	int from = getFrom(m);
-	int to = getTo(m);
-	int flag = getFlag(m);
-
-	if (flag == capture || flag >= knight_promo_capture)
-	{
-		int attackerValue = pieceValueMVV[getPieceIndex(from)];
-		int victimValue = pieceValueMVV[getPieceIndex(to)];
-
-		return victimValue * 10 - attackerValue;
-	}
-	else if (flag == knight_promotion)
-	{
-		return 3000;
-	}
-	else if (flag == bishop_promotion)
-	{
-		return 3000;
-	}
-	else if (flag == rook_promotion)
-	{
-		return 5000;
-	}
-	else if (flag == queen_promotion)
-	{
-		return 9000;
-	}
-	else if (flag == king_side_castle)
-	{
-		return 2000;
-	}
-	else if (flag == queen_side_castle)
-	{
-		return 1500;
-	}
-
-	return 0;
-}
-
-void sortMoves(Color c, std::array<Move, MAX_MOVES>& moves, int moveCount)
-{
-	for (int i = 1; i < moveCount; i++)
-	{
-		Move key = moves[i];
-		int keyScore = scoreMove(c, key);
-		int j = i - 1;
-
-		while (j >= 0 && scoreMove(c, moves[j]) < keyScore)
-		{
-			moves[j + 1] = moves[j];
-			j--;
-		}
-		if (j < MAX_MOVES) // silence a warning
-		{
-			moves[j + 1] = key;
-		}
-	}
-}
-
-// Search Algorithms
-
-int quiescence(Color c, int alpha, int beta, int ply)
-{
-	if (ply >= MAX_DEPTH - 1)
-	{
-		int eval = calculateEvaluation();
-		return (c == white) ? eval : -eval;
-	}
-
-	int static_eval = calculateEvaluation();
-	if (c == black) static_eval = -static_eval;
-
-	// Stand Pat
-	int best_value = static_eval;
-	if (best_value >= beta) return best_value;
-	if (best_value + 1000 < alpha) return alpha; // Skip hopeless captures
-	if (best_value > alpha) alpha = best_value;
-
-	std::array<Move, MAX_MOVES> moves;
-	int moveCount = 0;
-	getPseudoLegalMoves(c, moves, moveCount);
-
-	for (int i = 0; i < moveCount; i++)
-	{
-		int flag = getFlag(moves[i]);
-		if (flag != capture && flag != en_passant_capture && flag < knight_promo_capture) continue;
-		// ignore non captures
-
-		makeMove(moves[i], c, ply);
-
-		if (!isKingInCheck(c))
-		{
-			int score = -quiescence((c == white) ? black : white, -beta, -alpha, ply + 1);
-
-			unmakeMove(moves[i], c, ply);
-
-			if (score >= beta) return score;
-			if (score > best_value) best_value = score;
-			if (score > alpha) alpha = score;
-		}
-		else unmakeMove(moves[i], c, ply);
-	}
-
-	return best_value;
-}
-
-SearchResult negaMax(Color c, int alpha, int beta, int depthLeft, int ply)
-{
-	std::vector<Move> moveLog = (c == white) ? whiteMoveLog : blackMoveLog;
-	int originalAlpha = alpha;
-	int index = positionKey % TT_SIZE;
-	TTEntry* entry = &transpositionTable[index];
-
-	if (entry->key == positionKey && entry->depth >= depthLeft)
-	{
-		if (entry->flag == TT_EXACT)
-		{
-			return { entry->bestMove, entry->score };
-		}
-		else if (entry->flag == TT_ALPHA && entry->score <= alpha)
-		{
-			//position is bad
-			return { entry->bestMove, alpha };
-		}
-		else if (entry->flag == TT_BETA && entry->score >= beta)
-		{
-			//position is good (cutoff)
-			return { entry->bestMove, beta };
-		}
-	}
-
-	if (depthLeft == 0)
-	{
-		//int evaluation = calculateEvaluation();
-		//return { 0, (c == white) ? evaluation : -evaluation; }
-		return { 0, quiescence(c, alpha, beta, ply) };
-	}
-
-	int bestValue = minScore;
-	Move bestMove = 0;
-	bool hasLegalMoves{ false };
-
-	getPseudoLegalMoves(c, moveStack[ply], moveCountStack[ply]); // get pseudo legal moves
-	sortMoves(c, moveStack[ply], moveCountStack[ply]);
-
-	// Search stored tt table move from invalid score
-	Move ttMove = 0;
-	if (entry->key == positionKey) ttMove = entry->bestMove;
-
-	if (ttMove != 0)
-	{
-		makeMove(ttMove, c, ply);
-
-		if (!isKingInCheck(c))
-		{
-			hasLegalMoves = true;
-			SearchResult result = negaMax((c == white) ? black : white, -beta, -alpha, depthLeft - 1, ply + 1);
-			int score = -result.score;
-
-			if (score > bestValue)
-			{
-				bestValue = score;
-				bestMove = ttMove;
-				if (score > alpha)
-				{
-					alpha = score;
-				}
-			}
-			if (score >= beta)
-			{
-				unmakeMove(ttMove, c, ply);
-				transpositionTable[positionKey % TT_SIZE] = { positionKey, bestValue, depthLeft, bestMove, TT_BETA };
-				return { bestMove, bestValue };
-			}
-		}
-
-		unmakeMove(ttMove, c, ply);
-	}
-
-	// Search rest of moves
-	for (int i = 0; i < moveCountStack[ply]; i++)
-	{
-		if (moveLog.size() > 4 && (moveStack[ply][i] == moveLog[moveLog.size() - 2] || moveStack[ply][i] == moveLog[moveLog.size() - 4])) continue; // Avoid 3 fold;
-		if (moveStack[ply][i] == ttMove) continue;
-
-		makeMove(moveStack[ply][i], c, ply);
-		//printMainboard();
-		if (!isKingInCheck(c))
-		{
-			hasLegalMoves = true; // Found legal move
-
-			SearchResult result = negaMax((c == white) ? black : white, -beta, -alpha, depthLeft - 1, ply + 1);
-			int score = -result.score;
-			if (score > bestValue)
-			{
-				bestValue = score;
-				bestMove = moveStack[ply][i];
-				if (score > alpha)
-				{
-					alpha = score;
-				}
-			}
-			if (score >= beta)
-			{
-				unmakeMove(moveStack[ply][i], c, ply);
-				//printMainboard(); 
-				return { bestMove, score };
-			}
-		}
-		unmakeMove(moveStack[ply][i], c, ply);
-		//printMainboard();
-	}
-
-	uint8_t ttFlag;
-	if (bestValue <= originalAlpha)
-	{
-		ttFlag = TT_ALPHA;
-	}
-	else if (bestValue >= beta)
-	{
-		ttFlag = TT_BETA;
-	}
-	else
-	{
-		ttFlag = TT_EXACT;
-	}
-	transpositionTable[positionKey % TT_SIZE] = { positionKey, bestValue, depthLeft, bestMove, ttFlag };
-
-	if (!hasLegalMoves)
-	{
-		if (isKingInCheck(c)) return { 0, checkmateScore + ply }; // Checkmate
-		else return { 0, 0 }; // Stalemate
-	}
-	return { bestMove, bestValue };
-}
-
-bool isGameOver(Color sideToMove)
-{
-	std::array<Move, MAX_MOVES> moveList;
-	int moveCount;
-	getPseudoLegalMoves(sideToMove, moveList, moveCount);
-
-	bool hasLegalMove = false;
-
-	for (int i = 0; i < moveCount; i++)
-	{
-		makeMove(moveList[i], sideToMove, 0);
-
-		if (!isKingInCheck(sideToMove))
-		{
-			// Found a legal move
-			hasLegalMove = true;
-			unmakeMove(moveList[i], sideToMove, 0);
-			break;  // no need to check more
-		}
-
-		unmakeMove(moveList[i], sideToMove, 0);
-	}
-
-
-	if (!hasLegalMove)
-	{
-		if (isKingInCheck(sideToMove))
-		{
-			std::cout << "Checkmate. " << ((sideToMove == white) ? "Black" : "White") << " wins." << '\n';
-		}
-		else
-		{
-			std::cout << "Stalemate. Game is a draw." << '\n';
-		}
-		return true;  // Game over
-	}
-
-	return false;  // Game continues
-}
-
-void gameLoop()
-{
-	// THIS LOOP DOESNT WORK
-
-	initializeAllBoards();
-	positionKey = computePositionKey();
-	printMainboard();
-
-	while (true)
-	{
-		if (isGameOver(white)) break;
-		if (isGameOver(black)) break;
-
-		/*int from{ 0 };
-		int to{ 0 };
-		int flag{ 0 };
-
-		std::string fromString{ "" };
-		std::string toString{ "" };
-		std::string flagString{ "" };*/
-
-		std::cout << "White's turn" << '\n';
-		SearchResult resultWhite = negaMax(white, minScore, maxScore, depth, 0);
-		makeMove(resultWhite.move, white, 0);
-		printMainboard();
-		std::cout << "Evaluation: " << std::fixed << std::setprecision(1) << (resultWhite.score / 100.0) << '\n';
-
-
-		/*std::cout << "Enter the square of the piece you want to move (lowercase)" << '\n';
-		std::cin >> fromString;
-		from = stringToSquare(fromString);
-
-		std::cout << "Enter the desired destination (lowercase, must be legal move)" << '\n';
-		std::cin >> toString;
-		to = stringToSquare(toString);
-
-		std::cout << "Enter the INDEX (1-14) of the move type" << '\n';
-		std::cout << "Flag list: " << "quiet_move, double_pawn_push, king_side_castle, queen_side_castle, capture, en_passant_capture, " << '\n' << "knight_promotion, bishop_promotion, rook_promotion, queen_promotion, knight_promo_capture, bishop_promo_capture, rook_promo_capture, queen_promo_capture";
-		std::cout << '\n';
-		std::cin >> flag;
-		flag--;*/
-
-		/*makeMove(encodeMove(from, to, flag), black, 0);
-		printMainboard();*/
-
-		std::cout << "Black's turn" << '\n';
-		SearchResult resultBlack = negaMax(black, minScore, maxScore, depth, 0);
-		makeMove(resultBlack.move, black, 0);
-		printMainboard();
-		std::cout << "Evaluation: " << std::fixed << std::setprecision(1) << (-resultBlack.score / 100.0) << '\n'; // negate score
-	}
-}
-
-void uciLoop()
-{
-	std::string line;
-
-	while (std::getline(std::cin, line))
-	{
-		std::istringstream iss(line);
-		std::string token;
-		iss >> token;
-
-		// UCI initialization
-		if (token == "uci")
-		{
-			std::cout << "id name ChessEngineTP" << "\n";
-			std::cout << "id author ThanasisPantelakis" << "\n";
-			std::cout << "uciok" << "\n";
-		}
-
-		// Ready check
-		else if (token == "isready")
-		{
-			std::cout << "readyok" << "\n";
-		}
-
-		// New game
-		else if (token == "ucinewgame")
-		{
-			initializeAllBoards();
-			positionKey = computePositionKey();
-			currentSideToMove = white;
-			whiteMoveLog.clear();
-			blackMoveLog.clear();
-			whiteKingSideCastlingRights = true;
-			whiteQueenSideCastlingRights = true;
-			blackKingSideCastlingRights = true;
-			blackQueenSideCastlingRights = true;
-			plyCounter = 0;
-		}
-
-		// Set position
-		else if (token == "position")
-		{
-			std::string posType;
-			iss >> posType;
-
-			if (posType == "startpos")
-			{
-				initializeAllBoards();
-				positionKey = computePositionKey();
-				currentSideToMove = white;
-				whiteMoveLog.clear();
-				blackMoveLog.clear();
-				whiteKingSideCastlingRights = true;
-				whiteQueenSideCastlingRights = true;
-				blackKingSideCastlingRights = true;
-				blackQueenSideCastlingRights = true;
-				plyCounter = 0;
-
-				// Check for moves
-				std::string movesToken;
-				if (iss >> movesToken && movesToken == "moves")
-				{
-					std::string moveStr;
-					while (iss >> moveStr)
-					{
-						// Parse move
-						int from = stringToSquare(moveStr.substr(0, 2));
-						int to = stringToSquare(moveStr.substr(2, 2));
-
-						// Generate moves and find the matching one
-						std::array<Move, MAX_MOVES> moveList;
-						int moveCount;
-						getPseudoLegalMoves(currentSideToMove, moveList, moveCount);
-
-						for (int i = 0; i < moveCount; i++)
-						{
-							if (getFrom(moveList[i]) == from && getTo(moveList[i]) == to)
-							{
-								// Check for promotion
-								if (moveStr.length() == 5)
-								{
-									char promoChar = moveStr[4];
-									int flag = getFlag(moveList[i]);
-
-									// Match promotion type
-									if (promoChar == 'q' && (flag != queen_promotion && flag != queen_promo_capture)) continue;
-									if (promoChar == 'r' && (flag != rook_promotion && flag != rook_promo_capture)) continue;
-									if (promoChar == 'b' && (flag != bishop_promotion && flag != bishop_promo_capture)) continue;
-									if (promoChar == 'n' && (flag != knight_promotion && flag != knight_promo_capture)) continue;
-								}
-
-								makeMove(moveList[i], currentSideToMove, plyCounter);
-								currentSideToMove = (currentSideToMove == white) ? black : white;
-								break;
-							}
-						}
-					}
-				}
-			}
-		}
-
-		// Search for best move
-		else if (token == "go")
-		{
-			SearchResult result = negaMax(currentSideToMove, minScore, maxScore, depth, 0);
-			if (result.move == 0)
-			{
-				std::cout << "bestmove (none)" << "\n";
-				continue;
-			}
-
-			// Format move
-			std::string moveStr = squareToString(getFrom(result.move)) + squareToString(getTo(result.move));
-
-			// Add promotion piece if needed
-			int flag = getFlag(result.move);
-			if (flag >= knight_promotion && flag <= queen_promo_capture)
-			{
-				if (flag == queen_promotion || flag == queen_promo_capture) moveStr += "q";
-				else if (flag == rook_promotion || flag == rook_promo_capture) moveStr += "r";
-				else if (flag == bishop_promotion || flag == bishop_promo_capture) moveStr += "b";
-				else if (flag == knight_promotion || flag == knight_promo_capture) moveStr += "n";
-			}
-
-			std::cout << "bestmove " << moveStr << "\n";
-		}
-
-		// Quit
-		else if (token == "quit")
-		{
-			break;
-		}
-	}
-}
-
-int main()
-{
-	initializeZobrist();
-
-	uciLoop();
-	//gameLoop();
-
-	return 0;
+﻿// ChessEngine.cpp : This file contains the 'main' function. Program execution begins and ends there.
+
+#include <iostream>
+#include <sstream>
+#include <array>
+#include <cstdlib>
+#include <vector>
+#include <iomanip>
+#include <cassert>
+#include <random>
+#include <thread>
+#include <fstream>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <new>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+
+
+// Define bitboard
+typedef unsigned long long  U64;
+// Define Move
+typedef uint16_t Move;
+
+struct SearchResult {
+	Move move;
+	int score;
+};
+
+// get/set/pop macros
+#define get_bit(bitboard, square) (((bitboard) >> (square)) & 1ULL)
+#define set_bit(bitboard, square) ((bitboard) |= (1ULL << (square)))
+#define pop_bit(bitboard, square) (get_bit(bitboard, square) ? (bitboard) ^= (1ULL << (square)) : 0) // turns bit from 1 to 0, only if it's 1
+
+// Cache line hint, used before probing tables that are likely cold
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <xmmintrin.h>
+#define prefetch(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+#define prefetch(address) __builtin_prefetch(address)
+#endif
+
+// AVX2 kernels are compiled on x86-64 and picked at run time (see Kogge-Stone fills)
+#if defined(__x86_64__) || defined(_M_X64)
+#define SLIDER_FILL_AVX2
+#include <immintrin.h>
+#endif
+
+// Number of set bits
+inline int countBits(U64 bitboard)
+{
+	int count{ 0 };
+	for (; bitboard != 0; count++) bitboard &= bitboard - 1;
+	return count;
+}
+
+// Index of the lowest set bit, bitboard must not be 0
+inline int lowestBit(U64 bitboard)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bitboard);
+	return (int)index;
+#else
+	return __builtin_ctzll(bitboard);
+#endif
+}
+
+// Index of the highest set bit, bitboard must not be 0
+inline int highestBit(U64 bitboard)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, bitboard);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(bitboard);
+#endif
+}
+
+constexpr auto MAX_MOVES = 256;
+constexpr auto oneRank = 8;
+
+const auto minScore = -999999;
+const auto maxScore = 999999;
+const auto checkmateScore = -10000;
+const auto depth = 6; // CURRENT DEPTH
+const auto MAX_DEPTH = 64;
+
+bool debugMode{ false }; // UCI "debug on", prints extra info strings
+
+// Runs function(threadIndex) on threadCount threads, index 0 on the calling thread
+template <typename Function>
+void runOnThreads(int threadCount, Function function)
+{
+	std::vector<std::thread> workers;
+	for (int t = 1; t < threadCount; t++)
+	{
+		workers.emplace_back(function, t);
+	}
+	function(0);
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+/*
+--------------------
+
+SEARCH STATISTICS
+
+--------------------
+*/
+
+// Counters and timers of the search hot paths, compiled in with SEARCH_STATS (cmake -DCHESSENGINE_STATS=ON).
+// Without it STAT_INC and STAT_TIMER expand to nothing so release builds pay nothing.
+#ifdef SEARCH_STATS
+struct SearchStats {
+	U64 interiorNodes{ 0 }; // negaMax calls
+	U64 qsearchNodes{ 0 }; // quiescence calls
+	U64 ttProbes{ 0 };
+	U64 ttHits{ 0 }; // key matched
+	U64 ttExactCutoffs{ 0 };
+	U64 ttAlphaCutoffs{ 0 };
+	U64 ttBetaCutoffs{ 0 };
+	U64 qsearchTTCutoffs{ 0 }; // quiescence returns on a table score
+	U64 betaCutoffs{ 0 };
+	U64 firstMoveCutoffs{ 0 }; // cutoffs on the first legal move searched
+	U64 illegalMoves{ 0 }; // pseudo legal moves that left the king in check
+	U64 singularExtensions{ 0 };
+	U64 multiCuts{ 0 };
+	U64 iidNodes{ 0 }; // nodes without a table move that were reduced or searched shallower first
+	U64 razorCuts{ 0 };
+	U64 probCuts{ 0 };
+	U64 movegenTime{ 0 }; // nanoseconds
+	U64 evalTime{ 0 };
+	U64 makeUnmakeTime{ 0 };
+
+	void add(const SearchStats& other)
+	{
+		interiorNodes += other.interiorNodes;
+		qsearchNodes += other.qsearchNodes;
+		ttProbes += other.ttProbes;
+		ttHits += other.ttHits;
+		ttExactCutoffs += other.ttExactCutoffs;
+		ttAlphaCutoffs += other.ttAlphaCutoffs;
+		ttBetaCutoffs += other.ttBetaCutoffs;
+		qsearchTTCutoffs += other.qsearchTTCutoffs;
+		betaCutoffs += other.betaCutoffs;
+		firstMoveCutoffs += other.firstMoveCutoffs;
+		illegalMoves += other.illegalMoves;
+		singularExtensions += other.singularExtensions;
+		multiCuts += other.multiCuts;
+		iidNodes += other.iidNodes;
+		razorCuts += other.razorCuts;
+		probCuts += other.probCuts;
+		movegenTime += other.movegenTime;
+		evalTime += other.evalTime;
+		makeUnmakeTime += other.makeUnmakeTime;
+	}
+};
+
+thread_local SearchStats searchStats; // current search of this thread
+SearchStats lastSearchStats; // last go or bench, summed over threads
+long long lastSearchTime{ 0 }; // ms
+
+// Adds the lifetime of the timer to a SearchStats time field
+struct StatTimer {
+	U64& total;
+	std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+
+	explicit StatTimer(U64& total) : total(total) {}
+	~StatTimer() { total += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(); }
+};
+
+#define STAT_INC(counter) (searchStats.counter++)
+#define STAT_TIMER(field) StatTimer statTimer(searchStats.field)
+
+static double statPercent(U64 part, U64 total)
+{
+	return (total != 0) ? 100.0 * part / total : 0.0;
+}
+
+// Prints stats as info strings, searchTime in ms is used for the time split
+void printSearchStats(const SearchStats& stats, long long searchTime)
+{
+	U64 nodes = stats.interiorNodes + stats.qsearchNodes;
+	U64 ttCutoffs = stats.ttExactCutoffs + stats.ttAlphaCutoffs + stats.ttBetaCutoffs;
+	U64 searchNanoseconds = (U64)searchTime * 1000000;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "info string stats nodes " << nodes << " interior " << stats.interiorNodes
+		<< " qsearch " << stats.qsearchNodes << " (" << statPercent(stats.qsearchNodes, nodes) << "%)" << "\n";
+	std::cout << "info string stats tt probes " << stats.ttProbes << " hits " << stats.ttHits
+		<< " (" << statPercent(stats.ttHits, stats.ttProbes) << "%) cutoffs " << ttCutoffs
+		<< " exact " << stats.ttExactCutoffs << " alpha " << stats.ttAlphaCutoffs << " beta " << stats.ttBetaCutoffs
+		<< " qsearch " << stats.qsearchTTCutoffs << "\n";
+	std::cout << "info string stats cutoffs " << stats.betaCutoffs << " firstmove " << stats.firstMoveCutoffs
+		<< " (" << statPercent(stats.firstMoveCutoffs, stats.betaCutoffs) << "%) illegal " << stats.illegalMoves
+		<< " singular " << stats.singularExtensions << " multicut " << stats.multiCuts << " iid " << stats.iidNodes
+		<< " razor " << stats.razorCuts << " probcut " << stats.probCuts << "\n";
+	std::cout << "info string stats time ms " << searchTime
+		<< " movegen " << stats.movegenTime / 1000000 << " (" << statPercent(stats.movegenTime, searchNanoseconds) << "%)"
+		<< " eval " << stats.evalTime / 1000000 << " (" << statPercent(stats.evalTime, searchNanoseconds) << "%)"
+		<< " makeunmake " << stats.makeUnmakeTime / 1000000 << " (" << statPercent(stats.makeUnmakeTime, searchNanoseconds) << "%)" << "\n";
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+// One line JSON object, times in ns
+void printSearchStatsJson(const SearchStats& stats, long long searchTime)
+{
+	std::cout << "{\"interior_nodes\": " << stats.interiorNodes << ", \"qsearch_nodes\": " << stats.qsearchNodes
+		<< ", \"tt_probes\": " << stats.ttProbes << ", \"tt_hits\": " << stats.ttHits
+		<< ", \"tt_cutoffs\": {\"exact\": " << stats.ttExactCutoffs << ", \"alpha\": " << stats.ttAlphaCutoffs << ", \"beta\": " << stats.ttBetaCutoffs << ", \"qsearch\": " << stats.qsearchTTCutoffs << "}"
+		<< ", \"beta_cutoffs\": " << stats.betaCutoffs << ", \"first_move_cutoffs\": " << stats.firstMoveCutoffs
+		<< ", \"illegal_moves\": " << stats.illegalMoves << ", \"singular_extensions\": " << stats.singularExtensions
+		<< ", \"multi_cuts\": " << stats.multiCuts << ", \"iid_nodes\": " << stats.iidNodes
+		<< ", \"razor_cuts\": " << stats.razorCuts << ", \"probcuts\": " << stats.probCuts << ", \"search_time_ns\": " << (U64)searchTime * 1000000
+		<< ", \"movegen_ns\": " << stats.movegenTime << ", \"eval_ns\": " << stats.evalTime
+		<< ", \"make_unmake_ns\": " << stats.makeUnmakeTime << "}" << "\n";
+}
+#else
+#define STAT_INC(counter) ((void)0)
+#define STAT_TIMER(field) ((void)0)
+#endif
+
+// Board and search state below is thread_local, every thread works on its own position
+// (the tuner and bench run positions on several threads). Tables that are filled once
+// at startup and the transposition table are shared.
+
+thread_local int plyCounter = 0;
+
+// Enumerate sides / colors
+enum Color { white, black };
+
+thread_local Color currentSideToMove = white; // This is for UCI
+
+
+thread_local std::array<std::array<Move, MAX_MOVES>, MAX_DEPTH> moveStack; // Max depth 64, one array that stores moves for all depth levels
+thread_local std::array<int, MAX_DEPTH> moveCountStack; // Number of moves for each depth level
+
+
+// Forward declarations 
+void getPseudoLegalMoves(Color c, std::array<Move, MAX_MOVES>& moveStack, int& moveCount);
+
+void makeMove(Move m, Color c, int ply);
+void unmakeMove(Move m, Color c, int ply);
+
+SearchResult negaMax(Color c, int alpha, int beta, int depthLeft, int ply);
+
+enum EFlag {
+	quiet_move,
+	double_pawn_push,
+	king_side_castle,
+	queen_side_castle,
+	capture,
+	en_passant_capture,
+	knight_promotion,
+	bishop_promotion,
+	rook_promotion,
+	queen_promotion,
+	knight_promo_capture,
+	bishop_promo_capture,
+	rook_promo_capture,
+	queen_promo_capture
+};
+
+thread_local bool whiteKingSideCastlingRights{ true };
+thread_local bool whiteQueenSideCastlingRights{ true };
+
+thread_local bool blackKingSideCastlingRights{ true };
+thread_local bool blackQueenSideCastlingRights{ true };
+
+// Enumerate board squares
+enum EnumSquare {
+	a8, b8, c8, d8, e8, f8, g8, h8,
+	a7, b7, c7, d7, e7, f7, g7, h7,
+	a6, b6, c6, d6, e6, f6, g6, h6,
+	a5, b5, c5, d5, e5, f5, g5, h5,
+	a4, b4, c4, d4, e4, f4, g4, h4,
+	a3, b3, c3, d3, e3, f3, g3, h3,
+	a2, b2, c2, d2, e2, f2, g2, h2,
+	a1, b1, c1, d1, e1, f1, g1, h1
+};
+
+
+constexpr int getFile(int sq)
+{
+	return sq % 8 + 1;
+}
+
+constexpr int getRank(int sq)
+{
+	return 8 - (sq / 8);
+}
+
+int stringToSquare(const std::string& str)
+{
+	if (str.length() != 2) return -1; // Invalid input
+
+	char file = str[0];
+	char rank = str[1];
+
+	if (file < 'a' || file > 'h') return -1;
+	if (rank < '1' || rank > '8') return -1;
+
+	int fileNum = file - 'a'; // 0-7
+	int rankNum = '8' - rank; // 0-7 
+
+	return rankNum * 8 + fileNum; // Convert to 0-63
+}
+
+std::string squareToString(int square)
+{
+	char file = 'a' + (square % 8);
+	char rank = '8' - (square / 8);
+	return std::string(1, file) + std::string(1, rank);
+}
+
+/*
+--------------------
+
+LOOKUP TABLES
+
+--------------------
+*/
+
+// Computed by the compiler into read only data, nothing is built at startup
+
+// std::mt19937_64 at compile time, the hash keys keep the numbers of the fixed seeds they were drawn with
+template <int count>
+constexpr std::array<U64, count> mersenneTwister64(U64 seed)
+{
+	constexpr int n = 312;
+	constexpr int m = 156;
+	constexpr U64 upperMask = ~0ULL << 31;
+	constexpr U64 lowerMask = (1ULL << 31) - 1;
+
+	U64 state[n] = {};
+	state[0] = seed;
+	for (int i = 1; i < n; i++) state[i] = 6364136223846793005ULL * (state[i - 1] ^ (state[i - 1] >> 62)) + i;
+
+	std::array<U64, count> numbers{};
+	int index = n;
+	for (int k = 0; k < count; k++)
+	{
+		if (index == n)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				U64 x = (state[i] & upperMask) | (state[(i + 1) % n] & lowerMask);
+				state[i] = state[(i + m) % n] ^ (x >> 1) ^ ((x & 1) ? 0xB5026F5AA96619E9ULL : 0ULL);
+			}
+			index = 0;
+		}
+
+		U64 y = state[index++];
+		y ^= (y >> 29) & 0x5555555555555555ULL;
+		y ^= (y << 17) & 0x71D67FFFEDA60000ULL;
+		y ^= (y << 37) & 0xFFF7EEE000000000ULL;
+		y ^= y >> 43;
+		numbers[k] = y;
+	}
+	return numbers;
+}
+
+// Bit of the square on file and rank (1..8), 0 off the board
+constexpr U64 squareBit(int file, int rank)
+{
+	return (file >= 1 && file <= 8 && rank >= 1 && rank <= 8) ? 1ULL << ((8 - rank) * oneRank + file - 1) : 0ULL;
+}
+
+// Steps as (file, rank)
+constexpr int knightSteps[8][2] = { { -1, 2 }, { 1, 2 }, { -2, 1 }, { 2, 1 }, { -2, -1 }, { 2, -1 }, { -1, -2 }, { 1, -2 } };
+constexpr int kingSteps[8][2] = { { -1, 1 }, { 0, 1 }, { 1, 1 }, { -1, 0 }, { 1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } };
+constexpr int whitePawnSteps[2][2] = { { -1, 1 }, { 1, 1 } };
+constexpr int blackPawnSteps[2][2] = { { -1, -1 }, { 1, -1 } };
+constexpr int rayDirections[8][2] = { { -1, 1 }, { 1, 1 }, { -1, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 }, { 0, -1 } }; // diagonals first
+
+// Squares reached from every square with one of the steps
+template <int stepCount>
+constexpr std::array<U64, 64> stepAttackTable(const int (&steps)[stepCount][2])
+{
+	std::array<U64, 64> table{};
+	for (int square = 0; square < 64; square++)
+	{
+		for (int i = 0; i < stepCount; i++) table[square] |= squareBit(getFile(square) + steps[i][0], getRank(square) + steps[i][1]);
+	}
+	return table;
+}
+
+constexpr std::array<U64, 64> knightAttacks = stepAttackTable(knightSteps);
+constexpr std::array<U64, 64> kingAttacks = stepAttackTable(kingSteps);
+constexpr std::array<std::array<U64, 64>, 2> pawnAttacks = { stepAttackTable(whitePawnSteps), stepAttackTable(blackPawnSteps) }; // by color
+
+// For two squares on a rank, file or diagonal the squares strictly between them (wholeLine false) or the
+// whole line through both, edge to edge (wholeLine true). 0 for squares that aren't aligned.
+constexpr std::array<std::array<U64, 64>, 64> lineTable(bool wholeLine)
+{
+	std::array<std::array<U64, 64>, 64> table{};
+	for (int from = 0; from < 64; from++)
+	{
+		for (int d = 0; d < 8; d++)
+		{
+			int fileStep = rayDirections[d][0];
+			int rankStep = rayDirections[d][1];
+
+			U64 line = squareBit(getFile(from), getRank(from));
+			for (int j = 1; j < 8; j++)
+			{
+				line |= squareBit(getFile(from) + j * fileStep, getRank(from) + j * rankStep);
+				line |= squareBit(getFile(from) - j * fileStep, getRank(from) - j * rankStep);
+			}
+
+			U64 between{ 0 };
+			for (int j = 1; j < 8; j++)
+			{
+				int file = getFile(from) + j * fileStep;
+				int rank = getRank(from) + j * rankStep;
+				if (squareBit(file, rank) == 0) break;
+
+				table[from][(8 - rank) * oneRank + file - 1] = wholeLine ? line : between;
+				between |= squareBit(file, rank);
+			}
+		}
+	}
+	return table;
+}
+
+constexpr std::array<std::array<U64, 64>, 64> betweenSquares = lineTable(false);
+constexpr std::array<std::array<U64, 64>, 64> lineSquares = lineTable(true);
+
+// Squares from every square to the edge, for each of the rayDirections
+constexpr std::array<std::array<U64, 64>, 8> directionRays = [] {
+	std::array<std::array<U64, 64>, 8> table{};
+	for (int d = 0; d < 8; d++)
+	{
+		for (int square = 0; square < 64; square++)
+		{
+			for (int j = 1; j < 8; j++) table[d][square] |= squareBit(getFile(square) + j * rayDirections[d][0], getRank(square) + j * rayDirections[d][1]);
+		}
+	}
+	return table;
+}();
+
+// Squares a slider on the square attacks along rayDirections first to last, up to and including the
+// first piece of occupancy
+inline U64 slidingAttacks(int square, U64 occupancy, int firstDirection, int lastDirection)
+{
+	U64 attacks{ 0 };
+	for (int d = firstDirection; d <= lastDirection; d++)
+	{
+		U64 ray = directionRays[d][square];
+		U64 blockers = ray & occupancy;
+		if (blockers != 0)
+		{
+			bool increasing = rayDirections[d][0] - oneRank * rayDirections[d][1] > 0; // square index grows along the ray
+			ray ^= directionRays[d][increasing ? lowestBit(blockers) : highestBit(blockers)];
+		}
+		attacks |= ray;
+	}
+	return attacks;
+}
+
+inline U64 bishopAttacks(int square, U64 occupancy) { return slidingAttacks(square, occupancy, 0, 3); }
+inline U64 rookAttacks(int square, U64 occupancy) { return slidingAttacks(square, occupancy, 4, 7); }
+
+/* --- Kogge-Stone fills --- */
+
+// Squares attacked by a whole set of sliders at once: an occluded fill per direction, three shifts
+// whatever the number of pieces. Four directions grow the square index (shift left) and the other
+// four shrink it (shift right), each group is one 4 x 64 bit vector with a direction per lane.
+constexpr U64 notFileA = 0xFEFEFEFEFEFEFEFEULL;
+constexpr U64 notFileH = 0x7F7F7F7F7F7F7F7FULL;
+
+constexpr int fillShifts[4] = { 1, 7, 8, 9 }; // straight lanes 0 and 2, diagonal lanes 1 and 3
+constexpr U64 increasingMasks[4] = { notFileA, notFileH, ~0ULL, notFileA }; // east, south west, south, south east
+constexpr U64 decreasingMasks[4] = { notFileH, notFileA, ~0ULL, notFileH }; // west, north east, north, north west
+
+// One step of every piece of the bitboard along a lane, squares that wrap around the board are dropped
+inline U64 shiftIncreasing(U64 bitboard, int lane) { return (bitboard << fillShifts[lane]) & increasingMasks[lane]; }
+inline U64 shiftDecreasing(U64 bitboard, int lane) { return (bitboard >> fillShifts[lane]) & decreasingMasks[lane]; }
+
+// Attacks of the diagonal sliders (bishops, queens) and straight sliders (rooks, queens), up to and
+// including the first piece of occupancy
+U64 sliderFillScalar(U64 diagonal, U64 straight, U64 occupancy)
+{
+	U64 attacks{ 0 };
+	for (int lane = 0; lane < 4; lane++)
+	{
+		int shift = fillShifts[lane];
+		U64 sliders = (lane % 2 == 0) ? straight : diagonal;
+
+		U64 generator = sliders;
+		U64 propagator = ~occupancy & increasingMasks[lane];
+		generator |= propagator & (generator << shift);
+		propagator &= propagator << shift;
+		generator |= propagator & (generator << 2 * shift);
+		propagator &= propagator << 2 * shift;
+		generator |= propagator & (generator << 4 * shift);
+		attacks |= shiftIncreasing(generator, lane);
+
+		generator = sliders;
+		propagator = ~occupancy & decreasingMasks[lane];
+		generator |= propagator & (generator >> shift);
+		propagator &= propagator >> shift;
+		generator |= propagator & (generator >> 2 * shift);
+		propagator &= propagator >> 2 * shift;
+		generator |= propagator & (generator >> 4 * shift);
+		attacks |= shiftDecreasing(generator, lane);
+	}
+	return attacks;
+}
+
+#ifdef SLIDER_FILL_AVX2
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// The same fill with all four lanes of a direction group in one AVX2 register
+TARGET_AVX2 U64 sliderFillAvx2(U64 diagonal, U64 straight, U64 occupancy)
+{
+	const __m256i shift1 = _mm256_setr_epi64x(1, 7, 8, 9);
+	const __m256i shift2 = _mm256_setr_epi64x(2, 14, 16, 18);
+	const __m256i shift4 = _mm256_setr_epi64x(4, 28, 32, 36);
+	const __m256i sliders = _mm256_setr_epi64x((long long)straight, (long long)diagonal, (long long)straight, (long long)diagonal);
+	const __m256i empty = _mm256_set1_epi64x((long long)~occupancy);
+
+	const __m256i increasing = _mm256_setr_epi64x((long long)notFileA, (long long)notFileH, -1LL, (long long)notFileA);
+	__m256i generator = sliders;
+	__m256i propagator = _mm256_and_si256(empty, increasing);
+	generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, _mm256_sllv_epi64(generator, shift1)));
+	propagator = _mm256_and_si256(propagator, _mm256_sllv_epi64(propagator, shift1));
+	generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, _mm256_sllv_epi64(generator, shift2)));
+	propagator = _mm256_and_si256(propagator, _mm256_sllv_epi64(propagator, shift2));
+	generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, _mm256_sllv_epi64(generator, shift4)));
+	__m256i attacks = _mm256_and_si256(_mm256_sllv_epi64(generator, shift1), increasing);
+
+	const __m256i decreasing = _mm256_setr_epi64x((long long)notFileH, (long long)notFileA, -1LL, (long long)notFileH);
+	generator = sliders;
+	propagator = _mm256_and_si256(empty, decreasing);
+	generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, _mm256_srlv_epi64(generator, shift1)));
+	propagator = _mm256_and_si256(propagator, _mm256_srlv_epi64(propagator, shift1));
+	generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, _mm256_srlv_epi64(generator, shift2)));
+	propagator = _mm256_and_si256(propagator, _mm256_srlv_epi64(propagator, shift2));
+	generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, _mm256_srlv_epi64(generator, shift4)));
+	attacks = _mm256_or_si256(attacks, _mm256_and_si256(_mm256_srlv_epi64(generator, shift1), decreasing));
+
+	// Union of the four lanes
+	__m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+	half = _mm_or_si128(half, _mm_unpackhi_epi64(half, half));
+	return (U64)_mm_cvtsi128_si64(half);
+}
+
+// AVX2 in the CPU and enabled by the OS (saves the ymm registers)
+bool cpuHasAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+const bool useAvx2Fill = cpuHasAvx2();
+#endif
+
+inline U64 sliderFill(U64 diagonal, U64 straight, U64 occupancy)
+{
+#if defined(SLIDER_FILL_AVX2) && defined(__AVX2__)
+	return sliderFillAvx2(diagonal, straight, occupancy); // built for AVX2, no dispatch
+#elif defined(SLIDER_FILL_AVX2)
+	return useAvx2Fill ? sliderFillAvx2(diagonal, straight, occupancy) : sliderFillScalar(diagonal, straight, occupancy);
+#else
+	return sliderFillScalar(diagonal, straight, occupancy);
+#endif
+}
+
+const char* sliderFillKernel()
+{
+#ifdef SLIDER_FILL_AVX2
+	return useAvx2Fill ? "avx2" : "scalar";
+#else
+	return "scalar";
+#endif
+}
+
+// King moves from one square to the other
+constexpr std::array<std::array<uint8_t, 64>, 64> squareDistance = [] {
+	std::array<std::array<uint8_t, 64>, 64> table{};
+	for (int a = 0; a < 64; a++)
+	{
+		for (int b = 0; b < 64; b++)
+		{
+			int fileDistance = (getFile(a) > getFile(b)) ? getFile(a) - getFile(b) : getFile(b) - getFile(a);
+			int rankDistance = (getRank(a) > getRank(b)) ? getRank(a) - getRank(b) : getRank(b) - getRank(a);
+			table[a][b] = (uint8_t)((fileDistance > rankDistance) ? fileDistance : rankDistance);
+		}
+	}
+	return table;
+}();
+
+// Enumerate piece type
+enum EPieceType {
+	ept_pnil = 0, // empty
+	ept_wpawn = 1,
+	ept_bpawn = 2,
+	ept_knight = 3,
+	ept_bishop = 4,
+	ept_rook = 5,
+	ept_queen = 6,
+	ept_king = 7,
+};
+
+// Enumerate piece code
+enum EPieceCode {
+	epc_empty = ept_pnil,
+	epc_wpawn = ept_wpawn,
+	epc_woff = ept_bpawn, // may be used as off the board blocker in mailbox
+	epc_wknight = ept_knight,
+	epc_wbishop = ept_bishop,
+	epc_wrook = ept_rook,
+	epc_wqueen = ept_queen,
+	epc_wking = ept_king,
+
+	epc_blacky = 8, // color code, may used as off the board blocker in mailbox
+	epc_boff = ept_wpawn + epc_blacky, // may be used as off the board blocker in mailbox
+	epc_bpawn = ept_bpawn + epc_blacky,
+	epc_bknight = ept_knight + epc_blacky,
+	epc_bbishop = ept_bishop + epc_blacky,
+	epc_brook = ept_rook + epc_blacky,
+	epc_bqueen = ept_queen + epc_blacky,
+	epc_bking = ept_king + epc_blacky,
+};
+
+std::string pieceToUnicode(int piece)
+{ // Best solution
+	switch (piece)
+	{
+	case epc_wpawn:   return "♙";
+	case epc_wrook:   return "♖";
+	case epc_wknight: return "♘";
+	case epc_wbishop: return "♗";
+	case epc_wqueen:  return "♕";
+	case epc_wking:   return "♔";
+
+	case epc_bpawn:   return "♟";
+	case epc_brook:   return "♜";
+	case epc_bknight: return "♞";
+	case epc_bbishop: return "♝";
+	case epc_bqueen:  return "♛";
+	case epc_bking:   return "♚";
+
+	case epc_empty:   return ".";
+	}
+	return "?"; // fallback
+}
+
+char pieceToChar(int piece)
+{ // Temporary
+	switch (piece)
+	{
+	case epc_wpawn:   return 'P';
+	case epc_wrook:   return 'R';
+	case epc_wknight: return 'N';
+	case epc_wbishop: return 'B';
+	case epc_wqueen:  return 'Q';
+	case epc_wking:   return 'K';
+	case epc_bpawn:   return 'p';
+	case epc_brook:   return 'r';
+	case epc_bknight: return 'n';
+	case epc_bbishop: return 'b';
+	case epc_bqueen:  return 'q';
+	case epc_bking:   return 'k';
+	default:          return '.';
+	}
+}
+
+
+// Create Board Array / Main Board of type EPieceCode
+thread_local EPieceCode mainBoard[64];
+
+// Create the 12 bitboards for every piece
+thread_local std::array<U64, 12> bitboardPieces;
+
+enum Bitboard_index {
+	bb_wpawn = 0,
+	bb_bpawn,
+	bb_wknight,
+	bb_bknight,
+	bb_wbishop,
+	bb_bbishop,
+	bb_wrook,
+	bb_brook,
+	bb_wqueen,
+	bb_bqueen,
+	bb_wking,
+	bb_bking
+};
+
+thread_local std::array<int, MAX_DEPTH> whichWhitePieceIndexWasThere;
+thread_local std::array<int, MAX_DEPTH> whichBlackPieceIndexWasThere;
+
+EPieceCode convertPieceIndexToEPC(Color c, int num)
+{
+	if (c == white)
+	{
+		if (num == 0) return epc_wpawn;
+		if (num == 2) return epc_wknight;
+		if (num == 4) return epc_wbishop;
+		if (num == 6) return epc_wrook;
+		if (num == 8) return epc_wqueen;
+		if (num == 10) return epc_wking;
+	}
+	else if (c == black)
+	{
+		if (num == 1) return epc_bpawn;
+		if (num == 3) return epc_bknight;
+		if (num == 5) return epc_bbishop;
+		if (num == 7) return epc_brook;
+		if (num == 9) return epc_bqueen;
+		if (num == 11) return epc_bking;
+	}
+
+	return epc_empty;
+}
+
+// Occupancy bitboards (white, black and all pieces)
+thread_local U64 whitePiecesOccupancy;
+thread_local U64 blackPiecesOccupancy;
+thread_local U64 allPiecesOccupancy;
+
+int getPieceIndex(int sq)
+{
+	for (int i = bb_wpawn; i <= bb_bking; i++)
+	{
+		if (get_bit(bitboardPieces[i], sq) == 1) return i;
+	}
+
+	return -1;
+}
+
+
+// Initialization of the piece bitboards
+void initializeAllBoards()
+{
+	for (int i = bb_wpawn; i <= bb_bking; i++)
+	{
+		bitboardPieces[i] = 0ULL;
+	}
+	whitePiecesOccupancy = 0ULL;
+	blackPiecesOccupancy = 0ULL;
+	allPiecesOccupancy = 0ULL;
+
+	for (int square = a8; square <= h1; square++)
+	{
+
+		if (square == a8 || square == h8)
+		{
+			set_bit(bitboardPieces[bb_brook], square);
+			mainBoard[square] = epc_brook;
+		}
+		else if (square == b8 || square == g8)
+		{
+			set_bit(bitboardPieces[bb_bknight], square);
+			mainBoard[square] = epc_bknight;
+		}
+		else if (square == c8 || square == f8)
+		{
+			set_bit(bitboardPieces[bb_bbishop], square);
+			mainBoard[square] = epc_bbishop;
+		}
+		else if (square == d8)
+		{
+			set_bit(bitboardPieces[bb_bqueen], square);
+			mainBoard[square] = epc_bqueen;
+		}
+		else if (square == e8)
+		{
+			set_bit(bitboardPieces[bb_bking], square);
+			mainBoard[square] = epc_bking;
+		}
+		else if (square == a7 || square == b7 || square == c7 || square == d7 || square == e7
+			|| square == f7 || square == g7 || square == h7)
+		{
+			set_bit(bitboardPieces[bb_bpawn], square);
+			mainBoard[square] = epc_bpawn;
+		}
+		else if (square == a1 || square == h1)
+		{
+			set_bit(bitboardPieces[bb_wrook], square);
+			mainBoard[square] = epc_wrook;
+		}
+		else if (square == b1 || square == g1)
+		{
+			set_bit(bitboardPieces[bb_wknight], square);
+			mainBoard[square] = epc_wknight;
+		}
+		else if (square == c1 || square == f1)
+		{
+			set_bit(bitboardPieces[bb_wbishop], square);
+			mainBoard[square] = epc_wbishop;
+		}
+		else if (square == d1)
+		{
+			set_bit(bitboardPieces[bb_wqueen], square);
+			mainBoard[square] = epc_wqueen;
+		}
+		else if (square == e1)
+		{
+			set_bit(bitboardPieces[bb_wking], square);
+			mainBoard[square] = epc_wking;
+		}
+		else if (square == a2 || square == b2 || square == c2 || square == d2 || square == e2
+			|| square == f2 || square == g2 || square == h2)
+		{
+			set_bit(bitboardPieces[bb_wpawn], square);
+			mainBoard[square] = epc_wpawn;
+		}
+		else
+		{
+			mainBoard[square] = epc_empty;
+		}
+	}
+
+	// Occupancy bitboards initialization
+	whitePiecesOccupancy = bitboardPieces[bb_wrook] | bitboardPieces[bb_wpawn] | bitboardPieces[bb_wknight] | bitboardPieces[bb_wbishop] | bitboardPieces[bb_wqueen] | bitboardPieces[bb_wking];
+	blackPiecesOccupancy = bitboardPieces[bb_brook] | bitboardPieces[bb_bpawn] | bitboardPieces[bb_bknight] | bitboardPieces[bb_bbishop] | bitboardPieces[bb_bqueen] | bitboardPieces[bb_bking];
+	allPiecesOccupancy = whitePiecesOccupancy | blackPiecesOccupancy;
+}
+
+/*
+--------------------
+
+TRANSPOSITION TABLES
+		  
+--------------------
+*/
+
+constexpr std::array<U64, 12 * 64 + 1> zobristNumbers = mersenneTwister64<12 * 64 + 1>(123456789); // fixed seed = same numbers every run
+
+// every piece piece and square combo
+constexpr std::array<std::array<U64, 64>, 12> zobristPieces = [] {
+	std::array<std::array<U64, 64>, 12> keys{};
+	for (int piece = 0; piece < 12; piece++)
+	{
+		for (int square = 0; square < 64; square++) keys[piece][square] = zobristNumbers[piece * 64 + square];
+	}
+	return keys;
+}();
+constexpr U64 zobristSideToMove = zobristNumbers[12 * 64];
+thread_local U64 positionKey; // current position hash, updated on make/unmake move
+
+// Material signature: zobristMaterial[piece][n] for every n below the number of pieces of a kind, the
+// same for all positions with the same pieces on the board
+constexpr std::array<U64, 12 * 64> zobristMaterialNumbers = mersenneTwister64<12 * 64>(192837465);
+constexpr std::array<std::array<U64, 64>, 12> zobristMaterial = [] {
+	std::array<std::array<U64, 64>, 12> keys{};
+	for (int piece = 0; piece < 12; piece++)
+	{
+		for (int count = 0; count < 64; count++) keys[piece][count] = zobristMaterialNumbers[piece * 64 + count];
+	}
+	return keys;
+}();
+thread_local U64 materialKey; // updated on make move, restored on unmake move
+
+struct TTEntry {
+	U64 key; // position hash 
+	int score; // evaluation score
+	int depth; // depth reached
+	Move bestMove; // best move found
+	uint8_t flag; // type of score (exact, upper, lower)
+	int16_t staticEval; // static evaluation for the side to move
+};
+
+// The table is shared by the search threads without locks. A slot holds the entry packed into one
+// word and the key xor that word, so a read that mixes the words of two writes doesn't give back the
+// key and is a miss rather than the wrong entry.
+struct TTSlot {
+	U64 check; // key ^ data
+	U64 data; // score 16 bits, static eval 16, best move 16, depth 8, flag 8
+};
+
+constexpr size_t TT_ALIGNMENT = 2 * 1024 * 1024; // x86-64 huge page
+
+U64 ttSize{ 0 };
+TTSlot* transpositionTable{ nullptr };
+size_t ttBytes{ 0 }; // allocated, a multiple of TT_ALIGNMENT
+bool ttMapped{ false }; // MAP_HUGETLB mapping, else aligned_alloc
+std::string ttPages; // page type of the table, reported by setoption Hash and bench
+
+// Zeroes the table. Large tables are split over the cores, a single memset of many GB takes seconds.
+void clearTranspositionTable()
+{
+	size_t bytes = ttSize * sizeof(TTSlot);
+	int threadCount = (int)std::clamp<size_t>(bytes / (16 * 1024 * 1024), 1, std::max(1u, std::thread::hardware_concurrency()));
+	runOnThreads(threadCount, [&](int thread)
+	{
+		U64 first = ttSize * thread / threadCount;
+		U64 last = ttSize * (thread + 1) / threadCount;
+		std::memset((void*)(transpositionTable + first), 0, (last - first) * sizeof(TTSlot));
+	});
+}
+
+void freeTranspositionTable()
+{
+	if (transpositionTable == nullptr) return;
+#ifdef _WIN32
+	_aligned_free(transpositionTable);
+#else
+	if (ttMapped) munmap(transpositionTable, ttBytes);
+	else std::free(transpositionTable);
+#endif
+	transpositionTable = nullptr;
+}
+
+// Table memory is aligned to 2 MB so it can be backed by huge pages, random probes of a large table
+// then miss the TLB far less. Linux tries reserved huge pages (MAP_HUGETLB) first, then transparent
+// huge pages (madvise), other systems get normal pages.
+void allocateTranspositionTable(U64 entries)
+{
+	freeTranspositionTable();
+	ttSize = entries;
+	ttBytes = (entries * sizeof(TTSlot) + TT_ALIGNMENT - 1) / TT_ALIGNMENT * TT_ALIGNMENT;
+	ttMapped = false;
+	void* memory{ nullptr };
+
+#ifdef _WIN32
+	memory = _aligned_malloc(ttBytes, TT_ALIGNMENT);
+	ttPages = "normal pages";
+#else
+#ifdef MAP_HUGETLB
+	memory = mmap(nullptr, ttBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (memory == MAP_FAILED) memory = nullptr;
+	ttMapped = (memory != nullptr);
+	ttPages = "huge pages (MAP_HUGETLB)";
+#endif
+	if (memory == nullptr)
+	{
+		memory = std::aligned_alloc(TT_ALIGNMENT, ttBytes);
+		ttPages = "normal pages";
+#ifdef MADV_HUGEPAGE
+		std::ifstream thpMode("/sys/kernel/mm/transparent_hugepage/enabled");
+		std::string mode((std::istreambuf_iterator<char>(thpMode)), std::istreambuf_iterator<char>());
+		if (memory != nullptr && mode.find("[never]") == std::string::npos && madvise(memory, ttBytes, MADV_HUGEPAGE) == 0)
+		{
+			ttPages = "transparent huge pages (madvise)";
+		}
+#endif
+	}
+#endif
+
+	if (memory == nullptr) throw std::bad_alloc();
+	transpositionTable = (TTSlot*)memory;
+	clearTranspositionTable();
+}
+
+// UCI "Hash" option, table size in megabytes. Clears the table.
+void setHashSize(int megabytes)
+{
+	U64 entries = std::max<U64>(1, (U64)megabytes * 1024 * 1024 / sizeof(TTSlot));
+	if (entries == ttSize) clearTranspositionTable();
+	else allocateTranspositionTable(entries);
+}
+
+static_assert(-checkmateScore + MAX_DEPTH < 32768, "table scores are 16 bits");
+
+// Entry of the key's slot. Its key is the one stored there, the entry belongs to another position
+// or was torn by a concurrent write if it isn't the key probed for.
+inline TTEntry ttRead(U64 key)
+{
+	const TTSlot& slot = transpositionTable[key % ttSize];
+	U64 data = slot.data;
+	U64 check = slot.check;
+	return { check ^ data, (int16_t)data, (int8_t)(data >> 48), (Move)(data >> 32), (uint8_t)(data >> 56), (int16_t)(data >> 16) };
+}
+
+inline void ttStore(U64 key, int score, int depth, Move bestMove, uint8_t flag, int16_t staticEval)
+{
+	TTSlot& slot = transpositionTable[key % ttSize];
+	U64 data = (U64)(uint16_t)score | (U64)(uint16_t)staticEval << 16 | (U64)bestMove << 32 | (U64)(uint8_t)depth << 48 | (U64)flag << 56;
+	slot.check = key ^ data;
+	slot.data = data;
+}
+
+enum TTFlag {
+	TT_EXACT,
+	TT_ALPHA,
+	TT_BETA
+};
+
+
+U64 computePositionKey()
+{
+	// Called in every board initialization
+	U64 key = 0ULL;
+
+	for (int index = bb_wpawn; index <= bb_bking; index++)
+	{
+		for (int square = 0; square < 64; square++)
+		{
+			if (get_bit(bitboardPieces[index], square))
+			{
+				key ^= zobristPieces[index][square];
+			}
+		}
+	}
+
+	if (currentSideToMove == black)
+	{
+		key ^= zobristSideToMove;
+	}
+
+	return key;
+}
+
+U64 computeMaterialKey()
+{
+	U64 key = 0ULL;
+
+	for (int index = bb_wpawn; index <= bb_bking; index++)
+	{
+		for (int count = 0; count < countBits(bitboardPieces[index]); count++) key ^= zobristMaterial[index][count];
+	}
+
+	return key;
+}
+
+// Pieces of both colors attacking the square, sliders blocked by occupancy
+U64 attackersTo(int square, U64 occupancy)
+{
+	return (pawnAttacks[black][square] & bitboardPieces[bb_wpawn])
+		| (pawnAttacks[white][square] & bitboardPieces[bb_bpawn])
+		| (knightAttacks[square] & (bitboardPieces[bb_wknight] | bitboardPieces[bb_bknight]))
+		| (kingAttacks[square] & (bitboardPieces[bb_wking] | bitboardPieces[bb_bking]))
+		| (bishopAttacks(square, occupancy) & (bitboardPieces[bb_wbishop] | bitboardPieces[bb_bbishop] | bitboardPieces[bb_wqueen] | bitboardPieces[bb_bqueen]))
+		| (rookAttacks(square, occupancy) & (bitboardPieces[bb_wrook] | bitboardPieces[bb_brook] | bitboardPieces[bb_wqueen] | bitboardPieces[bb_bqueen]));
+}
+
+bool isSquareAttacked(int square, Color byColor)
+{
+	return (attackersTo(square, allPiecesOccupancy) & ((byColor == white) ? whitePiecesOccupancy : blackPiecesOccupancy)) != 0;
+}
+
+int findKing(Color c)
+{
+	U64 king = bitboardPieces[(c == white) ? bb_wking : bb_bking];
+	return king ? lowestBit(king) : -1;
+}
+
+bool isKingInCheck(Color c)
+{
+	int kingSquare = findKing(c);
+	if (kingSquare == -1) return false;
+	return isSquareAttacked(kingSquare, (c == white) ? black : white);
+}
+
+/* --- Attack info --- */
+
+// Attacks of the position at one ply, computed once per node. Checkers and pins are filled when the node
+// asks for them, the attack maps on first use (attackMaps). Slider attacks of a side go through the
+// other side's king, so a king can't step back along the line of a check.
+struct AttackInfo {
+	U64 key{ 0 }; // position the info belongs to
+	Color side{ white }; // side to move
+	int kingSquare{ -1 }; // of the side to move, -1 without a king
+	U64 checkers{ 0 }; // pieces giving check to the side to move
+	U64 pinned{ 0 }; // pieces of the side to move that shield their king from a slider
+	bool mapsReady{ false };
+	std::array<U64, 12> pieceAttacks{}; // squares attacked by the pieces of each bitboard index
+	std::array<U64, 2> attacked{}; // squares attacked by each color
+};
+
+thread_local std::array<AttackInfo, MAX_DEPTH> attackStack;
+
+void computeAttackInfo(Color c, AttackInfo& info)
+{
+	Color opp = (c == white) ? black : white;
+	U64 oppPieces = (c == white) ? blackPiecesOccupancy : whitePiecesOccupancy;
+	U64 ownPieces = (c == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
+
+	info.key = positionKey;
+	info.side = c;
+	info.checkers = 0;
+	info.pinned = 0;
+	info.mapsReady = false;
+
+	U64 king = bitboardPieces[(c == white) ? bb_wking : bb_bking];
+	info.kingSquare = king ? lowestBit(king) : -1;
+	if (info.kingSquare == -1) return;
+
+	info.checkers = attackersTo(info.kingSquare, allPiecesOccupancy) & oppPieces;
+
+	// A slider on a line with the king and one own piece between pins that piece
+	U64 diagonalSliders = bitboardPieces[(opp == white) ? bb_wbishop : bb_bbishop] | bitboardPieces[(opp == white) ? bb_wqueen : bb_bqueen];
+	U64 straightSliders = bitboardPieces[(opp == white) ? bb_wrook : bb_brook] | bitboardPieces[(opp == white) ? bb_wqueen : bb_bqueen];
+	U64 snipers = (bishopAttacks(info.kingSquare, 0) & diagonalSliders) | (rookAttacks(info.kingSquare, 0) & straightSliders);
+	for (; snipers != 0; snipers &= snipers - 1)
+	{
+		U64 between = betweenSquares[info.kingSquare][lowestBit(snipers)] & allPiecesOccupancy;
+		if (between != 0 && (between & (between - 1)) == 0 && (between & ownPieces)) info.pinned |= between;
+	}
+}
+
+// Info of the current position at ply, c to move
+AttackInfo& nodeAttackInfo(Color c, int ply)
+{
+	AttackInfo& info = attackStack[ply];
+	if (info.key != positionKey || info.side != c) computeAttackInfo(c, info);
+	return info;
+}
+
+// Fills the attack maps of info on first use
+AttackInfo& attackMaps(AttackInfo& info)
+{
+	if (info.mapsReady) return info;
+
+	info.attacked = { 0, 0 };
+	for (int index = bb_wpawn; index <= bb_bking; index++)
+	{
+		Color pieceColor = (index % 2 == 0) ? white : black;
+		U64 occupancy = allPiecesOccupancy & ~bitboardPieces[(pieceColor == white) ? bb_bking : bb_wking]; // through the enemy king
+		U64 pieces = bitboardPieces[index];
+
+		U64 attacks{ 0 };
+		switch (index / 2)
+		{
+		case 0:
+			if (pieceColor == white) attacks = shiftDecreasing(pieces, 1) | shiftDecreasing(pieces, 3);
+			else attacks = shiftIncreasing(pieces, 1) | shiftIncreasing(pieces, 3);
+			break;
+		case 2: attacks = sliderFill(pieces, 0, occupancy); break;
+		case 3: attacks = sliderFill(0, pieces, occupancy); break;
+		case 4: attacks = sliderFill(pieces, pieces, occupancy); break;
+		default:
+			for (; pieces != 0; pieces &= pieces - 1) attacks |= (index / 2 == 1) ? knightAttacks[lowestBit(pieces)] : kingAttacks[lowestBit(pieces)];
+			break;
+		}
+		info.pieceAttacks[index] = attacks;
+		info.attacked[pieceColor] |= attacks;
+	}
+	info.mapsReady = true;
+	return info;
+}
+
+/*
+--------------------
+
+EVALUATION PARAMETERS
+
+--------------------
+*/
+
+// Every evaluation weight lives in one parameter vector so it can be tuned (see TUNER below).
+// Weights are from white's point of view, black terms are subtracted.
+enum EvalParam {
+	ep_pawn_value,
+	ep_knight_value,
+	ep_bishop_value,
+	ep_rook_value,
+	ep_queen_value,
+	ep_doubled_pawn,
+	ep_diagonal_mobility, // bishop/queen, per free neighbour square
+	ep_rook_mobility, // per free neighbour square
+	ep_rook_blocked, // corner rook boxed in by own pieces
+	ep_king_shelter_front,
+	ep_king_shelter_side,
+	ep_early_queen, // per undeveloped minor piece once the queen has left
+	ep_king_side_castled,
+	ep_queen_side_castled,
+	ep_bishop_pair,
+	ep_pawn_table, // Bonus for pawns in center
+	ep_knight_table = ep_pawn_table + 64, // Bonus for knights in center
+	ep_king_table = ep_knight_table + 64, // Bonus for king in corners
+	NUM_EVAL_PARAMS = ep_king_table + 64
+};
+
+std::array<int, NUM_EVAL_PARAMS> evalParams = {
+	// Piece values
+	100, 300, 300, 500, 900,
+
+	// Pawn structure, mobility, king safety, development, imbalance
+	-25,
+	20,
+	20, -5,
+	50, 20,
+	-25,
+	60, 40,
+	30,
+
+	// Pawn square table
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	100, 100, 100, 100, 100, 100, 100, 100,
+	10, 10, 20, 80, 80, 20, 10, 10,
+	 5,  5, 10, 60, 60, 10,  5,  5,
+	 0,  0,  20, 50, 50,  20,  0,  0,
+	 5, -5,-10,  10,  10,-10, -5,  5,
+	 5, 10, 10,-20,-20, 10, 10,  5,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+
+	// Knight square table
+   -50,-30,-30,-30,-30,-30,-30,-50,
+   -40,-20,  0,  0,  0,  0,-20,-40,
+   -40,  0, 10, 15, 15, 10,  0,-40,
+   -30,  5, 15, 20, 20, 15,  5,-30,
+   -30,  0, 15, 20, 20, 15,  0,-30,
+   -40,  5, 10, 15, 15, 10,  5,-40,
+   -40,-20,  0,  5,  5,  0,-20,-40,
+   -50,-30,-30,-30,-30,-30,-30,-50,
+
+	// King square table
+	-80,-70,-70,-70,-70,-70,-70,-80,
+	-60,-60,-60,-60,-60,-60,-60,-60,
+	-40,-40,-40,-40,-40,-40,-40,-40,
+	-20,-20,-20,-20,-20,-20,-20,-20,
+	  0,  0,  0,  0,  0,  0,  0,  0,
+	 20, 20, 20, 20, 20, 20, 20, 20,
+	 40, 40, 40, 40, 40, 40, 40, 40,
+	 60, 100, 40, 20, 20, 40, 100, 60
+};
+
+#ifdef TUNE
+// Coefficient of every parameter in the last evaluation (white +1, black -1 per occurrence)
+thread_local std::array<int, NUM_EVAL_PARAMS> evalTrace;
+#define TRACE_TERM(index, sign) (evalTrace[index] += (sign))
+#else
+#define TRACE_TERM(index, sign) ((void)0)
+#endif
+
+// Adds a weight to the evaluation, sign is 1 for white and -1 for black
+#define EVAL_TERM(index, sign) do { evaluation += (sign) * evalParams[index]; TRACE_TERM(index, sign); } while (0)
+
+// Terms of one side, added for white and subtracted for black. The square tables are written from
+// white's side and mirrored for black. heavyPieces counts the knights, bishops, rooks and queens on the board.
+template <Color Us>
+int pieceEvaluation(int heavyPieces)
+{
+	constexpr int sign = (Us == white) ? 1 : -1;
+	constexpr int flip = (Us == white) ? 0 : 56; // square ^ flip mirrors the rank
+	constexpr int up = (Us == white) ? -oneRank : oneRank;
+
+	constexpr int pawnIndex = (Us == white) ? bb_wpawn : bb_bpawn;
+	constexpr int knightIndex = (Us == white) ? bb_wknight : bb_bknight;
+	constexpr int bishopIndex = (Us == white) ? bb_wbishop : bb_bbishop;
+	constexpr int rookIndex = (Us == white) ? bb_wrook : bb_brook;
+	constexpr int queenIndex = (Us == white) ? bb_wqueen : bb_bqueen;
+	constexpr int kingIndex = (Us == white) ? bb_wking : bb_bking;
+
+	U64 currOccupancy = (Us == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
+
+	int evaluation{ 0 };
+
+	for (int square = a8; square <= h1; square++)
+	{
+		// From positioning & piece value
+
+		// Pawn
+		if (get_bit(bitboardPieces[pawnIndex], square) == 1)
+		{
+			EVAL_TERM(ep_pawn_value, sign);
+			EVAL_TERM(ep_pawn_table + (square ^ flip), sign);
+
+			if (get_bit(bitboardPieces[pawnIndex], square + up) == 1) EVAL_TERM(ep_doubled_pawn, sign); // Doubled
+		}
+		// Knight
+		else if (get_bit(bitboardPieces[knightIndex], square) == 1)
+		{
+			EVAL_TERM(ep_knight_value, sign);
+			EVAL_TERM(ep_knight_table + (square ^ flip), sign);
+		}
+		// Bishop/queen
+		else if (get_bit(bitboardPieces[bishopIndex], square) == 1 || get_bit(bitboardPieces[queenIndex], square) == 1)
+		{
+			if (get_bit(bitboardPieces[bishopIndex], square) == 1) EVAL_TERM(ep_bishop_value, sign);
+			if (get_bit(bitboardPieces[queenIndex], square) == 1) EVAL_TERM(ep_queen_value, sign);
+		}
+		// Rook
+		else if (get_bit(bitboardPieces[rookIndex], square) == 1)
+		{
+			EVAL_TERM(ep_rook_value, sign);
+
+			if (square == (a1 ^ flip))
+			{
+				if (get_bit(currOccupancy, b1 ^ flip) == 1) EVAL_TERM(ep_rook_blocked, sign);
+				if (get_bit(currOccupancy, a2 ^ flip) == 1) EVAL_TERM(ep_rook_blocked, sign);
+			}
+			else if (square == (h1 ^ flip))
+			{
+				if (get_bit(currOccupancy, g1 ^ flip) == 1) EVAL_TERM(ep_rook_blocked, sign);
+				if (get_bit(currOccupancy, h2 ^ flip) == 1) EVAL_TERM(ep_rook_blocked, sign);
+			}
+		}
+		// King
+		else if (get_bit(bitboardPieces[kingIndex], square) == 1)
+		{
+			if (heavyPieces > 4) EVAL_TERM(ep_king_table + (square ^ flip), sign);
+			if (get_bit(bitboardPieces[pawnIndex], square + up) == 1) EVAL_TERM(ep_king_shelter_front, sign);
+			if (getFile(square) > 1 && get_bit(bitboardPieces[pawnIndex], square + up - 1) == 1) EVAL_TERM(ep_king_shelter_side, sign);
+			if (getFile(square) < 8 && get_bit(bitboardPieces[pawnIndex], square + up + 1) == 1) EVAL_TERM(ep_king_shelter_side, sign);
+		}
+	}
+
+	// Mobility: neighbour squares of the bishops/queens and rooks not taken by an own piece, one shift
+	// per direction for all pieces of a kind
+	U64 diagonalPieces = bitboardPieces[bishopIndex] | bitboardPieces[queenIndex];
+	for (int lane = 0; lane < 4; lane++)
+	{
+		U64 pieces = (lane % 2 == 0) ? bitboardPieces[rookIndex] : diagonalPieces;
+		int mobility = countBits(shiftIncreasing(pieces, lane) & ~currOccupancy) + countBits(shiftDecreasing(pieces, lane) & ~currOccupancy);
+		EVAL_TERM((lane % 2 == 0) ? ep_rook_mobility : ep_diagonal_mobility, sign * mobility);
+	}
+
+	// Discourage early queen moves
+	if (get_bit(bitboardPieces[queenIndex], d1 ^ flip) == 0)
+	{
+		if (get_bit(bitboardPieces[knightIndex], b1 ^ flip) == 1) EVAL_TERM(ep_early_queen, sign);
+		if (get_bit(bitboardPieces[knightIndex], g1 ^ flip) == 1) EVAL_TERM(ep_early_queen, sign);
+
+		if (get_bit(bitboardPieces[bishopIndex], c1 ^ flip) == 1) EVAL_TERM(ep_early_queen, sign);
+		if (get_bit(bitboardPieces[bishopIndex], f1 ^ flip) == 1) EVAL_TERM(ep_early_queen, sign);
+	}
+
+	// Castling
+	if (get_bit(bitboardPieces[kingIndex], g1 ^ flip)) EVAL_TERM(ep_king_side_castled, sign);
+	else if (get_bit(bitboardPieces[kingIndex], c1 ^ flip)) EVAL_TERM(ep_queen_side_castled, sign);
+
+	return evaluation;
+}
+
+/*
+--------------------
+
+ENDGAMES
+
+--------------------
+*/
+
+// Known endgames are scored by their own functions instead of pieceEvaluation. Won endings get
+// knownWinScore on top of their material: below every mate and tablebase score, above anything the
+// normal evaluation gives, so the search goes for the ending and then for the mate.
+const auto knownWinScore = 4000;
+
+// Scale factors shrink the evaluation of the side ahead towards a draw
+constexpr int normalScale = 64;
+constexpr int drawScale = 0;
+constexpr int noScale = -1; // a scale function that doesn't apply to the position
+
+// Score of a known endgame for the strong side
+using EndgameFunction = int (*)(Color strongSide, Color sideToMove);
+// Scale factor of the evaluation when strongSide is ahead, or noScale
+using ScaleFunction = int (*)(Color strongSide);
+
+constexpr U64 darkSquares = [] {
+	U64 squares{ 0 };
+	for (int square = 0; square < 64; square++)
+	{
+		if ((getFile(square) + getRank(square)) % 2 == 0) squares |= 1ULL << square;
+	}
+	return squares;
+}();
+
+// Grows towards the edges and corners, 0 on the four centre squares
+int pushToEdge(int square)
+{
+	int fileDistance = (getFile(square) <= 4) ? 4 - getFile(square) : getFile(square) - 5;
+	int rankDistance = (getRank(square) <= 4) ? 4 - getRank(square) : getRank(square) - 5;
+	return 20 * (fileDistance + rankDistance);
+}
+
+// Grows as the two squares get closer
+int pushClose(int a, int b)
+{
+	return 140 - 20 * squareDistance[a][b];
+}
+
+/* --- KPK bitbase --- */
+
+// Result of every king and pawn against king position, with the pawn white on a2-d7 (other positions
+// are mirrored onto these), one bit per position: set if white wins. Built by retrograde analysis on
+// first use, unlike the tables above it would take the compiler too long.
+constexpr int KPK_SIZE = 2 * 64 * 64 * 24; // side to move, white king, black king, pawn square
+
+enum KPKResult : uint8_t {
+	kpk_invalid = 0,
+	kpk_unknown = 1,
+	kpk_draw = 2,
+	kpk_win = 4
+};
+
+int kpkIndex(Color sideToMove, int whiteKing, int blackKing, int pawn)
+{
+	int pawnIndex = (7 - getRank(pawn)) * 4 + getFile(pawn) - 1; // a7 = 0 to d2 = 23
+	return sideToMove + 2 * (whiteKing + 64 * (blackKing + 64 * pawnIndex));
+}
+
+std::vector<U64> generateKPK()
+{
+	std::vector<uint8_t> results(KPK_SIZE, kpk_invalid);
+
+	auto forEachPosition = [](auto function)
+	{
+		for (int pawnIndex = 0; pawnIndex < 24; pawnIndex++)
+		{
+			int pawn = (pawnIndex / 4 + 1) * oneRank + pawnIndex % 4;
+			for (int blackKing = 0; blackKing < 64; blackKing++)
+			{
+				for (int whiteKing = 0; whiteKing < 64; whiteKing++)
+				{
+					function(white, whiteKing, blackKing, pawn);
+					function(black, whiteKing, blackKing, pawn);
+				}
+			}
+		}
+	};
+
+	// Positions decided without looking ahead: illegal ones, a safe promotion, stalemate and a lost pawn
+	forEachPosition([&](Color sideToMove, int whiteKing, int blackKing, int pawn)
+	{
+		int push = pawn - oneRank;
+		uint8_t& result = results[kpkIndex(sideToMove, whiteKing, blackKing, pawn)];
+
+		if (squareDistance[whiteKing][blackKing] <= 1 || whiteKing == pawn || blackKing == pawn
+			|| (sideToMove == white && (pawnAttacks[white][pawn] & (1ULL << blackKing)) != 0)) result = kpk_invalid;
+		else if (sideToMove == white && getRank(pawn) == 7 && whiteKing != push && blackKing != push
+			&& (squareDistance[blackKing][push] > 1 || squareDistance[whiteKing][push] == 1)) result = kpk_win;
+		else if (sideToMove == black && ((kingAttacks[blackKing] & ~(kingAttacks[whiteKing] | pawnAttacks[white][pawn])) == 0
+			|| (squareDistance[blackKing][pawn] == 1 && squareDistance[whiteKing][pawn] > 1))) result = kpk_draw;
+		else result = kpk_unknown;
+	});
+
+	// A position is won for white when one white move reaches a win, drawn when one black move reaches
+	// a draw, and decided for the other side once every move is decided against the mover
+	bool changed{ true };
+	while (changed)
+	{
+		changed = false;
+		forEachPosition([&](Color sideToMove, int whiteKing, int blackKing, int pawn)
+		{
+			uint8_t& result = results[kpkIndex(sideToMove, whiteKing, blackKing, pawn)];
+			if (result != kpk_unknown) return;
+
+			KPKResult good = (sideToMove == white) ? kpk_win : kpk_draw;
+			KPKResult bad = (sideToMove == white) ? kpk_draw : kpk_win;
+
+			uint8_t reached{ kpk_invalid };
+			for (U64 targets = kingAttacks[(sideToMove == white) ? whiteKing : blackKing]; targets != 0; targets &= targets - 1)
+			{
+				int to = lowestBit(targets);
+				reached |= (sideToMove == white) ? results[kpkIndex(black, to, blackKing, pawn)] : results[kpkIndex(white, whiteKing, to, pawn)];
+			}
+			if (sideToMove == white && getRank(pawn) < 7)
+			{
+				int push = pawn - oneRank;
+				reached |= results[kpkIndex(black, whiteKing, blackKing, push)]; // invalid if a king stands there
+				if (getRank(pawn) == 2 && whiteKing != push && blackKing != push) reached |= results[kpkIndex(black, whiteKing, blackKing, push - oneRank)];
+			}
+
+			uint8_t newResult = (reached & good) ? good : (reached & kpk_unknown) ? kpk_unknown : bad;
+			if (newResult != result)
+			{
+				result = newResult;
+				changed = true;
+			}
+		});
+	}
+
+	std::vector<U64> bitbase(KPK_SIZE / 64, 0ULL);
+	for (int index = 0; index < KPK_SIZE; index++)
+	{
+		if (results[index] == kpk_win) bitbase[index / 64] |= 1ULL << (index % 64);
+	}
+	return bitbase;
+}
+
+bool probeKPK(Color sideToMove, int whiteKing, int blackKing, int pawn)
+{
+	static const std::vector<U64> bitbase = generateKPK();
+	int index = kpkIndex(sideToMove, whiteKing, blackKing, pawn);
+	return ((bitbase[index / 64] >> (index % 64)) & 1) != 0;
+}
+
+/* --- Evaluation functions --- */
+
+// Mate with a queen, a rook, two bishops or a bishop and a knight: drive the king to the edge
+int endgameKXK(Color strongSide, Color)
+{
+	Color weakSide = (strongSide == white) ? black : white;
+	int strongKing = findKing(strongSide);
+	int weakKing = findKing(weakSide);
+	U64 bishops = bitboardPieces[bb_wbishop + strongSide];
+
+	int result = countBits(bitboardPieces[bb_wpawn + strongSide]) * evalParams[ep_pawn_value]
+		+ countBits(bitboardPieces[bb_wknight + strongSide]) * evalParams[ep_knight_value]
+		+ countBits(bishops) * evalParams[ep_bishop_value]
+		+ countBits(bitboardPieces[bb_wrook + strongSide]) * evalParams[ep_rook_value]
+		+ countBits(bitboardPieces[bb_wqueen + strongSide]) * evalParams[ep_queen_value]
+		+ pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+
+	if (bitboardPieces[bb_wqueen + strongSide] != 0 || bitboardPieces[bb_wrook + strongSide] != 0
+		|| (bishops != 0 && bitboardPieces[bb_wknight + strongSide] != 0) || ((bishops & darkSquares) != 0 && (bishops & ~darkSquares) != 0))
+	{
+		result += knownWinScore;
+	}
+	return std::min(result, 2 * knownWinScore); // a handful of extra queens stays below the mate scores
+}
+
+// Bishop and knight mate, only in a corner of the bishop's colour
+int endgameKBNK(Color strongSide, Color)
+{
+	Color weakSide = (strongSide == white) ? black : white;
+	int strongKing = findKing(strongSide);
+	int weakKing = findKing(weakSide);
+	bool darkBishop = (bitboardPieces[bb_wbishop + strongSide] & darkSquares) != 0;
+
+	int cornerDistance{ 14 };
+	for (int corner : darkBishop ? std::array<int, 2>{ a1, h8 } : std::array<int, 2>{ a8, h1 })
+	{
+		int distance = std::abs(getFile(weakKing) - getFile(corner)) + std::abs(getRank(weakKing) - getRank(corner));
+		cornerDistance = std::min(cornerDistance, distance);
+	}
+
+	return knownWinScore + evalParams[ep_knight_value] + evalParams[ep_bishop_value] + 20 * (14 - cornerDistance)
+		+ pushClose(strongKing, weakKing);
+}
+
+// King and pawn against king, exact from the bitbase
+int endgameKPK(Color strongSide, Color sideToMove)
+{
+	Color weakSide = (strongSide == white) ? black : white;
+	int strongKing = findKing(strongSide);
+	int weakKing = findKing(weakSide);
+	int pawn = lowestBit(bitboardPieces[bb_wpawn + strongSide]);
+
+	// The strong side plays up the board on files a-d
+	int flip = ((strongSide == white) ? 0 : 56) ^ ((getFile(pawn) <= 4) ? 0 : 7);
+	Color whiteToMove = (sideToMove == strongSide) ? white : black;
+	if (!probeKPK(whiteToMove, strongKing ^ flip, weakKing ^ flip, pawn ^ flip)) return 0;
+
+	return knownWinScore + evalParams[ep_pawn_value] + 10 * getRank(pawn ^ flip);
+}
+
+// Rook against pawn: won unless the defending king escorts an advanced pawn
+int endgameKRKP(Color strongSide, Color sideToMove)
+{
+	Color weakSide = (strongSide == white) ? black : white;
+	int flip = (strongSide == white) ? 0 : 56; // the pawn runs down the board
+	int strongKing = findKing(strongSide) ^ flip;
+	int weakKing = findKing(weakSide) ^ flip;
+	int rook = lowestBit(bitboardPieces[bb_wrook + strongSide]) ^ flip;
+	int pawn = lowestBit(bitboardPieces[bb_wpawn + weakSide]) ^ flip;
+	int queeningSquare = a1 + getFile(pawn) - 1;
+	int rookValue = evalParams[ep_rook_value];
+
+	// King in front of the pawn
+	if (getFile(strongKing) == getFile(pawn) && getRank(strongKing) < getRank(pawn)) return rookValue - 10 * squareDistance[strongKing][pawn];
+
+	// Defending king too far from the pawn and the rook
+	if (squareDistance[weakKing][pawn] >= 3 + (sideToMove == weakSide) && squareDistance[weakKing][rook] >= 3)
+	{
+		return rookValue - 10 * squareDistance[strongKing][pawn];
+	}
+
+	// Advanced pawn next to its king, the attacking king too far away to help
+	if (getRank(weakKing) <= 3 && squareDistance[weakKing][pawn] == 1 && getRank(strongKing) >= 4
+		&& squareDistance[strongKing][pawn] > 2 + (sideToMove == strongSide))
+	{
+		return 40 - 4 * squareDistance[strongKing][pawn];
+	}
+
+	return 100 - 4 * (squareDistance[strongKing][pawn + oneRank] - squareDistance[weakKing][pawn + oneRank] - squareDistance[pawn][queeningSquare]);
+}
+
+// Rook against a minor piece, drawn unless the defence goes wrong
+int endgameKRKB(Color strongSide, Color)
+{
+	return pushToEdge(findKing((strongSide == white) ? black : white));
+}
+
+int endgameKRKN(Color strongSide, Color)
+{
+	Color weakSide = (strongSide == white) ? black : white;
+	int weakKing = findKing(weakSide);
+	int knight = lowestBit(bitboardPieces[bb_wknight + weakSide]);
+	return pushToEdge(weakKing) + 10 * squareDistance[weakKing][knight];
+}
+
+// Two knights can't force mate
+int endgameKNNK(Color, Color)
+{
+	return 0;
+}
+
+/* --- Scale functions --- */
+
+// Bishop and pawns: a rook pawn whose promotion square the bishop can't cover is drawn with the
+// defending king in front of it, and bishops of opposite colours alone are drawish
+int scaleKBPsK(Color strongSide)
+{
+	Color weakSide = (strongSide == white) ? black : white;
+	U64 pawns = bitboardPieces[bb_wpawn + strongSide];
+	U64 bishop = bitboardPieces[bb_wbishop + strongSide];
+	int weakKing = findKing(weakSide);
+
+	constexpr U64 fileA = 0x0101010101010101ULL;
+	constexpr U64 fileH = fileA << 7;
+	if ((pawns & ~fileA) == 0 || (pawns & ~fileH) == 0)
+	{
+		int queeningSquare = ((strongSide == white) ? a8 : a1) + getFile(lowestBit(pawns)) - 1;
+		bool bishopCovers = ((bishop & darkSquares) != 0) == (((darkSquares >> queeningSquare) & 1) != 0);
+		if (!bishopCovers && squareDistance[weakKing][queeningSquare] <= 1) return drawScale;
+	}
+
+	U64 weakPieces = (weakSide == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
+	U64 weakBishop = bitboardPieces[bb_wbishop + weakSide];
+	if (weakBishop != 0 && (weakPieces & ~(weakBishop | bitboardPieces[bb_wpawn + weakSide] | bitboardPieces[bb_wking + weakSide])) == 0
+		&& ((bishop & darkSquares) != 0) != ((weakBishop & darkSquares) != 0))
+	{
+		int extraPawns = countBits(pawns) - countBits(bitboardPieces[bb_wpawn + weakSide]);
+		return (extraPawns <= 1) ? 16 : 32;
+	}
+
+	return noScale;
+}
+
+// Pawns on one rook file against a lone king standing in front of them
+int scaleKPsK(Color strongSide)
+{
+	Color weakSide = (strongSide == white) ? black : white;
+	U64 pawns = bitboardPieces[bb_wpawn + strongSide];
+	int weakKing = findKing(weakSide);
+
+	constexpr U64 fileA = 0x0101010101010101ULL;
+	constexpr U64 fileH = fileA << 7;
+	if ((pawns & ~fileA) != 0 && (pawns & ~fileH) != 0) return noScale;
+
+	int frontPawn = (strongSide == white) ? lowestBit(pawns) : highestBit(pawns);
+	bool inFront = (strongSide == white) ? getRank(weakKing) > getRank(frontPawn) : getRank(weakKing) < getRank(frontPawn);
+	return (std::abs(getFile(weakKing) - getFile(frontPawn)) <= 1 && inFront) ? drawScale : noScale;
+}
+
+/*
+--------------------
+
+MATERIAL TABLE
+
+--------------------
+*/
+
+// What only depends on the material, shared by every position with the same materialKey
+struct MaterialEntry {
+	U64 key;
+	int heavyPieces; // knights, bishops, rooks and queens on the board, the game phase
+	int bishopPairs; // 1 if only white has two bishops, -1 if only black has them
+	EndgameFunction evaluate; // known endgame, replaces the evaluation
+	Color strongSide; // of evaluate
+	std::array<ScaleFunction, 2> scaleFunction; // by the side ahead, nullptr if none
+	std::array<int, 2> scale; // by the side ahead, what the scale function falls back to
+};
+
+constexpr int MATERIAL_TABLE_SIZE = 4096;
+thread_local std::array<MaterialEntry, MATERIAL_TABLE_SIZE> materialTable;
+
+// Pieces of one side as a single number, to compare against known endgames
+constexpr int materialSignature(int pawns, int knights, int bishops, int rooks, int queens)
+{
+	return pawns + 16 * knights + 256 * bishops + 4096 * rooks + 65536 * queens;
+}
+
+MaterialEntry& probeMaterial()
+{
+	MaterialEntry& entry = materialTable[materialKey % MATERIAL_TABLE_SIZE];
+	if (entry.key == materialKey) return entry;
+
+	entry = { materialKey, 0, 0, nullptr, white, { nullptr, nullptr }, { normalScale, normalScale } };
+
+	std::array<int, 12> count;
+	for (int index = bb_wpawn; index <= bb_bking; index++) count[index] = countBits(bitboardPieces[index]);
+	for (int index = bb_wknight; index <= bb_bqueen; index++) entry.heavyPieces += count[index];
+	entry.bishopPairs = (count[bb_wbishop] >= 2) - (count[bb_bbishop] >= 2);
+
+	std::array<int, 2> pieceMaterial{}; // knights, bishops, rooks and queens
+	std::array<int, 2> signature{};
+	for (Color c : { white, black })
+	{
+		pieceMaterial[c] = count[bb_wknight + c] * evalParams[ep_knight_value] + count[bb_wbishop + c] * evalParams[ep_bishop_value]
+			+ count[bb_wrook + c] * evalParams[ep_rook_value] + count[bb_wqueen + c] * evalParams[ep_queen_value];
+		signature[c] = materialSignature(count[bb_wpawn + c], count[bb_wknight + c], count[bb_wbishop + c], count[bb_wrook + c], count[bb_wqueen + c]);
+	}
+
+	for (Color c : { white, black })
+	{
+		Color them = (c == white) ? black : white;
+		int pawns = count[bb_wpawn + c];
+
+		EndgameFunction evaluate{ nullptr };
+		if (signature[c] == materialSignature(0, 1, 1, 0, 0) && signature[them] == 0) evaluate = endgameKBNK;
+		else if (signature[c] == materialSignature(1, 0, 0, 0, 0) && signature[them] == 0) evaluate = endgameKPK;
+		else if (signature[c] == materialSignature(0, 2, 0, 0, 0) && signature[them] == 0) evaluate = endgameKNNK;
+		else if (signature[them] == 0 && pieceMaterial[c] >= evalParams[ep_rook_value]) evaluate = endgameKXK;
+		else if (signature[c] == materialSignature(0, 0, 0, 1, 0) && signature[them] == materialSignature(1, 0, 0, 0, 0)) evaluate = endgameKRKP;
+		else if (signature[c] == materialSignature(0, 0, 0, 1, 0) && signature[them] == materialSignature(0, 0, 1, 0, 0)) evaluate = endgameKRKB;
+		else if (signature[c] == materialSignature(0, 0, 0, 1, 0) && signature[them] == materialSignature(0, 1, 0, 0, 0)) evaluate = endgameKRKN;
+		if (evaluate != nullptr)
+		{
+			entry.evaluate = evaluate;
+			entry.strongSide = c;
+			return entry;
+		}
+
+		// Without pawns a minor piece more isn't enough
+		if (pawns == 0 && pieceMaterial[c] - pieceMaterial[them] <= evalParams[ep_bishop_value])
+		{
+			entry.scale[c] = (pieceMaterial[c] < evalParams[ep_rook_value]) ? drawScale : (pieceMaterial[them] <= evalParams[ep_bishop_value]) ? 4 : 14;
+		}
+
+		if (pawns > 0 && signature[c] - pawns == materialSignature(0, 0, 1, 0, 0)) entry.scaleFunction[c] = scaleKBPsK;
+		else if (pawns >= 2 && signature[c] == pawns && signature[them] == 0) entry.scaleFunction[c] = scaleKPsK;
+	}
+
+	return entry;
+}
+
+int pieceEvaluation(const MaterialEntry& material)
+{
+	// Adds when white benefits/black loses, subtracts when white loses/black benefits
+	int evaluation = pieceEvaluation<white>(material.heavyPieces) + pieceEvaluation<black>(material.heavyPieces);
+	EVAL_TERM(ep_bishop_pair, material.bishopPairs);
+	return evaluation;
+}
+
+int pieceEvaluation()
+{
+	return pieceEvaluation(probeMaterial());
+}
+
+/*
+--------------------
+
+EVALUATION CACHE
+
+--------------------
+*/
+
+// Lossy cache of static evaluations, one U64 per entry: the upper 48 bits of the position key
+// and the 16 bit score. The lower 16 bits of the key are implied by the index.
+constexpr int EVAL_CACHE_SIZE = 65536; // 2^16
+thread_local std::array<U64, EVAL_CACHE_SIZE> evalCache;
+
+thread_local U64 evalCacheProbes{ 0 };
+thread_local U64 evalCacheHits{ 0 };
+
+// White's point of view, known endgames from their own functions, the rest scaled down when the
+// side ahead can't make progress
+int calculateEvaluation(Color sideToMove)
+{
+	STAT_TIMER(evalTime);
+	evalCacheProbes++;
+
+	U64& cached = evalCache[positionKey % EVAL_CACHE_SIZE];
+	if (((cached ^ positionKey) >> 16) == 0)
+	{
+		evalCacheHits++;
+		return (int16_t)(cached & 0xFFFF);
+	}
+
+	int evaluation{ 0 };
+
+	const MaterialEntry& material = probeMaterial();
+	if (material.evaluate != nullptr)
+	{
+		evaluation = material.evaluate(material.strongSide, sideToMove);
+		if (material.strongSide == black) evaluation = -evaluation;
+	}
+	else
+	{
+		evaluation = pieceEvaluation(material);
+
+		Color ahead = (evaluation > 0) ? white : black;
+		int scale = material.scale[ahead];
+		if (material.scaleFunction[ahead] != nullptr)
+		{
+			int positionScale = material.scaleFunction[ahead](ahead);
+			if (positionScale != noScale) scale = positionScale;
+		}
+		evaluation = evaluation * scale / normalScale;
+	}
+
+	cached = (positionKey & ~0xFFFFULL) | (uint16_t)evaluation;
+
+	return evaluation;
+}
+
+
+void printBitboard(U64 bitboard)
+{
+	std::cout << '\n';
+
+	// Loop over ranks
+	for (int rank = 0; rank < 8; rank++)
+	{
+
+		// Loop over files
+		for (int file = 0; file < 8; file++)
+		{
+
+			// Create square index
+			int square = rank * 8 + file;
+
+			// Print rank info
+			if (file == 0)
+			{
+				std::cout << 8 - rank << "   ";
+			}
+
+			// Print bit state (either 1 or 0)
+			std::cout << (get_bit(bitboard, square)) << " ";
+		}
+
+		// New line every rank
+		std::cout << '\n';
+	}
+
+	// Print file info
+	std::cout << '\n' << "    A B C D E F G H" << '\n';
+}
+
+void printMainboard()
+{
+	std::cout << "\n";
+
+	for (int index = a8; index <= h1; index++)
+	{
+
+		// Print rank info
+		if (index % 8 == 0)
+		{
+			int rank = 8 - (index / 8);
+			std::cout << rank << "  ";
+		}
+
+		// Print square
+		std::cout << pieceToChar(mainBoard[index]) << " ";
+
+		// New line every rank
+		if (index % 8 == 7)
+		{
+			std::cout << "\n";
+		}
+	}
+
+	// Print file letters
+	std::cout << "\n   A B C D E F G H\n";
+	std::cout << '\n';
+}
+
+// Encode a move (Flag | From | To)
+inline Move encodeMove(int from, int to, int flag)
+{
+	return (flag << 12) | (from << 6) | to;
+}
+
+inline int getFrom(Move m) { return (m >> 6) & 0x3F; }
+inline int getTo(Move m) { return m & 0x3F; }
+inline int getFlag(Move m) { return (m >> 12) & 0xF; }
+
+thread_local std::vector<Move> whiteMoveLog;
+thread_local std::vector<Move> blackMoveLog;
+
+// Set up the board from a FEN string, only placement, side to move, castling rights
+// and en passant square are used. Returns false if the placement can't be parsed.
+bool setPositionFromFen(const std::string& fen)
+{
+	std::istringstream iss(fen);
+	std::string placement, side, castling, enPassant;
+	iss >> placement >> side >> castling >> enPassant;
+
+	for (int i = bb_wpawn; i <= bb_bking; i++)
+	{
+		bitboardPieces[i] = 0ULL;
+	}
+	for (int square = a8; square <= h1; square++)
+	{
+		mainBoard[square] = epc_empty;
+	}
+
+	int square = a8;
+	for (char ch : placement)
+	{
+		if (ch == '/') continue;
+		if (ch >= '1' && ch <= '8')
+		{
+			square += ch - '0';
+			continue;
+		}
+
+		int index{ -1 };
+		switch (ch)
+		{
+		case 'P': index = bb_wpawn; break;
+		case 'N': index = bb_wknight; break;
+		case 'B': index = bb_wbishop; break;
+		case 'R': index = bb_wrook; break;
+		case 'Q': index = bb_wqueen; break;
+		case 'K': index = bb_wking; break;
+		case 'p': index = bb_bpawn; break;
+		case 'n': index = bb_bknight; break;
+		case 'b': index = bb_bbishop; break;
+		case 'r': index = bb_brook; break;
+		case 'q': index = bb_bqueen; break;
+		case 'k': index = bb_bking; break;
+		}
+		if (index == -1 || square > h1) return false;
+
+		set_bit(bitboardPieces[index], square);
+		mainBoard[square] = convertPieceIndexToEPC((index % 2 == 0) ? white : black, index);
+		square++;
+	}
+
+	whitePiecesOccupancy = bitboardPieces[bb_wrook] | bitboardPieces[bb_wpawn] | bitboardPieces[bb_wknight] | bitboardPieces[bb_wbishop] | bitboardPieces[bb_wqueen] | bitboardPieces[bb_wking];
+	blackPiecesOccupancy = bitboardPieces[bb_brook] | bitboardPieces[bb_bpawn] | bitboardPieces[bb_bknight] | bitboardPieces[bb_bbishop] | bitboardPieces[bb_bqueen] | bitboardPieces[bb_bking];
+	allPiecesOccupancy = whitePiecesOccupancy | blackPiecesOccupancy;
+
+	currentSideToMove = (side == "b") ? black : white;
+
+	whiteKingSideCastlingRights = castling.find('K') != std::string::npos;
+	whiteQueenSideCastlingRights = castling.find('Q') != std::string::npos;
+	blackKingSideCastlingRights = castling.find('k') != std::string::npos;
+	blackQueenSideCastlingRights = castling.find('q') != std::string::npos;
+
+	// En passant is generated from the opponent's last move, so log the double push that allowed it
+	whiteMoveLog.clear();
+	blackMoveLog.clear();
+	int epSquare = stringToSquare(enPassant);
+	if (epSquare != -1)
+	{
+		if (currentSideToMove == white) blackMoveLog.push_back(encodeMove(epSquare - oneRank, epSquare + oneRank, double_pawn_push));
+		else whiteMoveLog.push_back(encodeMove(epSquare + oneRank, epSquare - oneRank, double_pawn_push));
+	}
+
+	plyCounter = 0;
+	positionKey = computePositionKey();
+	materialKey = computeMaterialKey();
+
+	return true;
+}
+
+/* --- Generation types --- */
+
+enum GenType {
+	gen_all,
+	gen_captures, // captures, en passant and queen promotions
+	gen_evasions, // king moves and the moves that capture the checker or block its line
+	gen_checks // direct and discovered checks, and every promotion, en passant capture and castling (test those after the move)
+};
+
+// Squares from which a piece of c attacks the enemy king, by piece kind (pawn, knight, bishop, rook, queen, king)
+void directCheckSquares(Color c, U64 checkSquares[6])
+{
+	int kingSquare = findKing((c == white) ? black : white);
+	for (int kind = 0; kind < 6; kind++) checkSquares[kind] = 0;
+	if (kingSquare == -1) return;
+
+	checkSquares[0] = pawnAttacks[(c == white) ? black : white][kingSquare];
+	checkSquares[1] = knightAttacks[kingSquare];
+
+	checkSquares[2] = bishopAttacks(kingSquare, allPiecesOccupancy);
+	checkSquares[3] = rookAttacks(kingSquare, allPiecesOccupancy);
+	checkSquares[4] = checkSquares[2] | checkSquares[3];
+}
+
+// Pieces of c that are the only piece between a slider of c and the enemy king, moving them off the line checks
+U64 discoveredCheckCandidates(Color c)
+{
+	int kingSquare = findKing((c == white) ? black : white);
+	if (kingSquare == -1) return 0;
+
+	U64 ownPieces = (c == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
+	U64 diagonalSliders = bitboardPieces[(c == white) ? bb_wbishop : bb_bbishop] | bitboardPieces[(c == white) ? bb_wqueen : bb_bqueen];
+	U64 straightSliders = bitboardPieces[(c == white) ? bb_wrook : bb_brook] | bitboardPieces[(c == white) ? bb_wqueen : bb_bqueen];
+	U64 snipers = (bishopAttacks(kingSquare, 0) & diagonalSliders) | (rookAttacks(kingSquare, 0) & straightSliders);
+
+	U64 candidates{ 0 };
+	for (; snipers != 0; snipers &= snipers - 1)
+	{
+		U64 between = betweenSquares[kingSquare][lowestBit(snipers)] & allPiecesOccupancy;
+		if (between != 0 && (between & (between - 1)) == 0 && (between & ownPieces)) candidates |= between;
+	}
+	return candidates;
+}
+
+// Whether pseudo legal move m of the side to move of info leaves its king safe. King moves are generated
+// safe already. Other moves are legal without a check or pin, the rest test the king on the board after the move.
+bool isLegal(Move m, const AttackInfo& info)
+{
+	int from = getFrom(m);
+	int to = getTo(m);
+	int flag = getFlag(m);
+
+	if (info.kingSquare == -1 || from == info.kingSquare) return true;
+	if (info.checkers == 0 && !get_bit(info.pinned, from) && flag != en_passant_capture) return true;
+
+	int captured = (flag == en_passant_capture) ? to + ((info.side == white) ? oneRank : -oneRank) : to;
+	U64 occupancy = (allPiecesOccupancy & ~(1ULL << from) & ~(1ULL << captured)) | (1ULL << to);
+	U64 oppPieces = ((info.side == white) ? blackPiecesOccupancy : whitePiecesOccupancy) & ~(1ULL << captured);
+
+	return (attackersTo(info.kingSquare, occupancy) & oppPieces) == 0;
+}
+
+// GENERATE ALL PSEUDO LEGAL MOVES (checks legality after, king moves are legal already). info is the
+// attack info of the position with Us to move.
+template <Color Us, GenType type>
+void generateMoves(AttackInfo& info, std::array<Move, MAX_MOVES>& moveStack, int& moveCount)
+{
+	STAT_TIMER(movegenTime);
+	moveCount = 0;
+
+	constexpr bool genCaptures = true; // also queen promotions
+	constexpr bool genQuiets = type != gen_captures; // also under promotions
+	constexpr bool genCastling = type == gen_all || type == gen_checks;
+
+	constexpr Color Them = (Us == white) ? black : white;
+	constexpr int pawnIndex = (Us == white) ? bb_wpawn : bb_bpawn;
+	constexpr int knightIndex = (Us == white) ? bb_wknight : bb_bknight;
+	constexpr int bishopIndex = (Us == white) ? bb_wbishop : bb_bbishop;
+	constexpr int rookIndex = (Us == white) ? bb_wrook : bb_brook;
+	constexpr int queenIndex = (Us == white) ? bb_wqueen : bb_bqueen;
+	constexpr int kingIndex = (Us == white) ? bb_wking : bb_bking;
+
+	constexpr int up = (Us == white) ? -oneRank : oneRank; // one square towards the promotion rank
+	constexpr int startRank = (Us == white) ? 2 : 7;
+	constexpr int promotionRank = (Us == white) ? 7 : 2; // rank the pawns promote from
+	constexpr int enPassantRank = (Us == white) ? 5 : 4;
+
+	constexpr int kingStartSquare = (Us == white) ? e1 : e8;
+	constexpr int kingSideRookSquare = (Us == white) ? h1 : h8;
+	constexpr int queenSideRookSquare = (Us == white) ? a1 : a8;
+
+	U64 currOccupancy = (Us == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
+	U64 oppOccupancy = (Us == white) ? blackPiecesOccupancy : whitePiecesOccupancy;
+
+	bool kingSideCastlingRights = (Us == white) ? whiteKingSideCastlingRights : blackKingSideCastlingRights;
+	bool queenSideCastlingRights = (Us == white) ? whiteQueenSideCastlingRights : blackQueenSideCastlingRights;
+
+	// Knight and king targets of this mode: empty squares for quiets, opponent pieces for captures
+	U64 targetMask = (genQuiets ? ~allPiecesOccupancy : 0ULL) | (genCaptures ? oppOccupancy : 0ULL);
+
+	// A double push on the opponent's last move allows en passant
+	const std::vector<Move>& oppMoveLog = (Us == white) ? blackMoveLog : whiteMoveLog;
+	int lastOppMove = (oppMoveLog.size() != 0) ? oppMoveLog.back() : 0;
+	bool lastOppDoublePush = getFlag(lastOppMove) == double_pawn_push;
+
+	// Evasions: a single checker can be captured or, if it is a slider, blocked. In a double check only the king moves.
+	U64 evasionTargets{ ~0ULL };
+	if constexpr (type == gen_evasions)
+	{
+		evasionTargets = (info.checkers != 0 && (info.checkers & (info.checkers - 1)) == 0) ? info.checkers | betweenSquares[info.kingSquare][lowestBit(info.checkers)] : 0ULL;
+	}
+
+	// Checks: the squares every piece kind attacks the enemy king from, any square for a piece uncovering a slider
+	U64 checkSquares[6]{};
+	U64 discoverers{ 0 };
+	if constexpr (type == gen_checks)
+	{
+		directCheckSquares(Us, checkSquares);
+		discoverers = discoveredCheckCandidates(Us);
+	}
+
+	// Iterate through every square
+	for (int square = a8; square <= h1; square++)
+	{
+		if (get_bit(currOccupancy, square) == 0) continue;
+
+		// Destinations of this piece's moves in this mode
+		U64 allowed{ ~0ULL };
+		if constexpr (type == gen_evasions)
+		{
+			if (square != info.kingSquare) allowed = evasionTargets;
+		}
+		if constexpr (type == gen_checks)
+		{
+			if (get_bit(discoverers, square) == 0) allowed = checkSquares[getPieceIndex(square) / 2];
+		}
+		if (allowed == 0 && get_bit(bitboardPieces[pawnIndex] | bitboardPieces[kingIndex], square) == 0) continue;
+
+		// Pawn
+
+		if (get_bit(bitboardPieces[pawnIndex], square) == 1 && moveCount < MAX_MOVES)
+		{
+			// Promotions, and en passant captures that may uncover a check, are all checking candidates
+			U64 specialAllowed = (type == gen_checks) ? ~0ULL : allowed;
+
+			// Push
+			if (genQuiets && getRank(square) != promotionRank && get_bit(allPiecesOccupancy, square + up) == 0 && get_bit(allowed, square + up))
+			{
+				if (moveCount < MAX_MOVES)
+				{
+					moveStack[moveCount] = encodeMove(square, square + up, quiet_move);
+					moveCount++;
+				}
+			}
+
+			// Double push
+			if (genQuiets && getRank(square) == startRank && get_bit(allPiecesOccupancy, square + up) == 0
+				&& get_bit(allPiecesOccupancy, square + up * 2) == 0 && get_bit(allowed, square + up * 2))
+			{
+				if (moveCount < MAX_MOVES)
+				{
+					moveStack[moveCount] = encodeMove(square, square + up * 2, double_pawn_push);
+					moveCount++;
+				}
+			}
+
+			// Pawn capture left
+			if (genCaptures && getRank(square) != promotionRank && getFile(square) > 1 && get_bit(oppOccupancy, square + up - 1) == 1 && get_bit(allowed, square + up - 1))
+			{
+				if (moveCount < MAX_MOVES)
+				{
+					moveStack[moveCount] = encodeMove(square, square + up - 1, capture);
+					moveCount++;
+				}
+			}
+			// Pawn capture right
+			if (genCaptures && getRank(square) != promotionRank && getFile(square) < 8 && get_bit(oppOccupancy, square + up + 1) == 1 && get_bit(allowed, square + up + 1))
+			{
+				if (moveCount < MAX_MOVES)
+				{
+					moveStack[moveCount] = encodeMove(square, square + up + 1, capture);
+					moveCount++;
+				}
+			}
+
+			// En passant capture
+			// Left
+			if (genCaptures && lastOppDoublePush && getFile(square) > 1 && getRank(square) == enPassantRank && getTo(lastOppMove) == square - 1
+				&& (get_bit(specialAllowed, square + up - 1) || get_bit(specialAllowed, square - 1)))
+			{
+				if (moveCount < MAX_MOVES)
+				{
+					moveStack[moveCount] = encodeMove(square, square + up - 1, en_passant_capture);
+					moveCount++;
+				}
+			}
+			// Right
+			if (genCaptures && lastOppDoublePush && getFile(square) < 8 && getRank(square) == enPassantRank && getTo(lastOppMove) == square + 1
+				&& (get_bit(specialAllowed, square + up + 1) || get_bit(specialAllowed, square + 1)))
+			{
+				if (moveCount < MAX_MOVES)
+				{
+					moveStack[moveCount] = encodeMove(square, square + up + 1, en_passant_capture);
+					moveCount++;
+				}
+			}
+
+			if (getRank(square) == promotionRank)
+			{
+				// Promotions (no capture), knight to queen. The queen promotion goes with the captures.
+				if (get_bit(allPiecesOccupancy, square + up) == 0 && get_bit(specialAllowed, square + up))
+				{
+					for (int flag = knight_promotion; flag <= queen_promotion; flag++)
+					{
+						if (((flag == queen_promotion) ? genCaptures : genQuiets) && moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, square + up, flag);
+							moveCount++;
+						}
+					}
+				}
+
+				// Promotion capture left
+				if (genCaptures && getFile(square) > 1 && get_bit(oppOccupancy, square + up - 1) == 1 && get_bit(specialAllowed, square + up - 1))
+				{
+					for (int flag = knight_promo_capture; flag <= queen_promo_capture; flag++)
+					{
+						if (moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, square + up - 1, flag);
+							moveCount++;
+						}
+					}
+				}
+				// Promotion capture right
+				if (genCaptures && getFile(square) < 8 && get_bit(oppOccupancy, square + up + 1) == 1 && get_bit(specialAllowed, square + up + 1))
+				{
+					for (int flag = knight_promo_capture; flag <= queen_promo_capture; flag++)
+					{
+						if (moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, square + up + 1, flag);
+							moveCount++;
+						}
+					}
+				}
+			}
+		}
+
+		// Knight
+
+		if (get_bit(bitboardPieces[knightIndex], square) == 1)
+		{
+			for (U64 targets = knightAttacks[square] & targetMask & allowed; targets != 0; targets &= targets - 1)
+			{
+				int target = lowestBit(targets);
+
+				if (moveCount < MAX_MOVES)
+				{
+					// Quiet move or capture
+					moveStack[moveCount] = encodeMove(square, target, get_bit(oppOccupancy, target) ? capture : quiet_move);
+					moveCount++;
+				}
+			}
+		}
+
+		// Bishop
+
+		if (get_bit(bitboardPieces[bishopIndex], square) == 1)
+		{
+			int squareToMove{ 0 };
+
+			// Quiet moves & Captures
+			for (int i = 0; i <= 3; i++)
+			{
+				for (int j = 1; j <= 7; j++)
+				{
+					if (i == 0) { squareToMove = square - j * (oneRank - 1); } // Top left
+					else if (i == 1) { squareToMove = square - j * (oneRank + 1); } // Top right
+					else if (i == 2) { squareToMove = square + j * (oneRank - 1); } // Bottom left
+					else if (i == 3) { squareToMove = square + j * (oneRank + 1); } // Bottom right
+
+					if (squareToMove > 63 || squareToMove < 0) break;
+
+					// Prevent file wrap around
+					int fromFile = square % 8;
+					int toFile = squareToMove % 8;
+					if (abs(toFile - fromFile) != j) break;
+
+					// Prevent other bugs
+					int fromRank = getRank(square);
+					int toRank = getRank(squareToMove);
+					if (abs(toRank - fromRank) != j) break;
+
+					if (get_bit(allPiecesOccupancy, squareToMove) == 0)
+					{
+						// Quiet move
+						if (genQuiets && get_bit(allowed, squareToMove) && moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, squareToMove, quiet_move);
+							moveCount++;
+						}
+					}
+					else if (get_bit(oppOccupancy, squareToMove) == 1)
+					{
+						// Capture
+						if (genCaptures && get_bit(allowed, squareToMove) && moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, squareToMove, capture);
+							moveCount++;
+						}
+						break;
+					}
+					else if (get_bit(currOccupancy, squareToMove) == 1)
+					{
+						// Same color piece blocks the way, break.
+						break;
+					}
+				}
+			}
+		}
+
+		// Rook
+
+		if (get_bit(bitboardPieces[rookIndex], square) == 1)
+		{
+			int squareToMove{ 0 };
+
+			// Quiet moves & Captures
+			for (int i = 0; i <= 3; i++)
+			{
+				for (int j = 1; j <= 7; j++)
+				{
+					if (i == 0)
+					{
+						// Left
+						squareToMove = square - j;
+						if (getRank(square) != getRank(squareToMove)) { break; }
+					}
+					else if (i == 1)
+					{
+						// Right
+						squareToMove = square + j;
+						if (getRank(square) != getRank(squareToMove)) { break; }
+					}
+					else if (i == 2) { squareToMove = square - j * (oneRank); } // Up
+					else if (i == 3) { squareToMove = square + j * (oneRank); } // Down
+
+					if (squareToMove > 63 || squareToMove < 0 || moveCount >= 256) break;
+
+					if (get_bit(allPiecesOccupancy, squareToMove) == 0)
+					{
+						// Quiet move
+						if (genQuiets && get_bit(allowed, squareToMove) && moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, squareToMove, quiet_move);
+							moveCount++;
+						}
+					}
+					else if (get_bit(oppOccupancy, squareToMove) == 1)
+					{
+						// Capture
+						if (genCaptures && get_bit(allowed, squareToMove) && moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, squareToMove, capture);
+							moveCount++;
+						}
+						break;
+					}
+					else if (get_bit(currOccupancy, squareToMove) == 1)
+					{
+						// Same color piece blocks the way, break.
+						break;
+					}
+				}
+			}
+		}
+
+		// Queen
+
+		if (get_bit(bitboardPieces[queenIndex], square) == 1)
+		{
+			int squareToMove{ 0 };
+
+			// Quiet moves & Captures
+			for (int i = 0; i <= 7; i++)
+			{
+				for (int j = 1; j <= 7; j++)
+				{
+					if (i == 0)
+					{
+						// Left
+						squareToMove = square - j;
+						if (getRank(square) != getRank(squareToMove)) { break; }
+					}
+					else if (i == 1)
+					{
+						// Right
+						squareToMove = square + j;
+						if (getRank(square) != getRank(squareToMove)) { break; }
+					}
+					else if (i == 2) { squareToMove = square - j * (oneRank); } // Up
+					else if (i == 3) { squareToMove = square + j * (oneRank); } // Down
+					else if (i == 4) { squareToMove = square - j * (oneRank - 1); } // Top left
+					else if (i == 5) { squareToMove = square - j * (oneRank + 1); } // Top right
+					else if (i == 6) { squareToMove = square + j * (oneRank - 1); } // Bottom left
+					else if (i == 7) { squareToMove = square + j * (oneRank + 1); } // Bottom right
+
+					if (squareToMove > 63 || squareToMove < 0 || moveCount >= 256) break;
+
+					if (i >= 4)
+					{
+						// Prevent file wrap around
+						int fromFile = square % 8;
+						int toFile = squareToMove % 8;
+						if (abs(toFile - fromFile) != j) break;
+
+						// Prevent other bugs
+						int fromRank = getRank(square);
+						int toRank = getRank(squareToMove);
+						if (abs(toRank - fromRank) != j) break;
+					}
+
+
+					if (get_bit(allPiecesOccupancy, squareToMove) == 0)
+					{
+						// Quiet move
+						if (genQuiets && get_bit(allowed, squareToMove) && moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, squareToMove, quiet_move);
+							moveCount++;
+						}
+					}
+					else if (get_bit(oppOccupancy, squareToMove) == 1)
+					{
+						// Capture
+						if (genCaptures && get_bit(allowed, squareToMove) && moveCount < MAX_MOVES)
+						{
+							moveStack[moveCount] = encodeMove(square, squareToMove, capture);
+							moveCount++;
+						}
+						break;
+					}
+					else if (get_bit(currOccupancy, squareToMove) == 1)
+					{
+						// Same piece blocks the way, break.
+						break;
+					}
+				}
+			}
+		}
+
+		// King
+
+		if (get_bit(bitboardPieces[kingIndex], square) == 1 && moveCount < MAX_MOVES)
+		{
+			// Targets this mode doesn't generate skip the attack test
+			for (U64 targets = kingAttacks[square] & targetMask & allowed; targets != 0; targets &= targets - 1)
+			{
+				int target = lowestBit(targets);
+				if (get_bit(attackMaps(info).attacked[Them], target)) continue;
+
+				if (moveCount < MAX_MOVES)
+				{
+					// Quiet move or capture
+					moveStack[moveCount] = encodeMove(square, target, get_bit(oppOccupancy, target) ? capture : quiet_move);
+					moveCount++;
+				}
+			}
+
+			if (genCastling && kingSideCastlingRights && square == kingStartSquare && get_bit(bitboardPieces[rookIndex], kingSideRookSquare) == 1
+				&& get_bit(allPiecesOccupancy, square + 1) == 0 && get_bit(allPiecesOccupancy, square + 2) == 0)
+			{
+				// King side castling
+				if (moveCount < MAX_MOVES)
+				{
+					// Ensure no castling through checks
+					U64 attacked = attackMaps(info).attacked[Them];
+					if (!get_bit(attacked, square) && !get_bit(attacked, square + 1) && !get_bit(attacked, square + 2))
+					{
+						moveStack[moveCount] = encodeMove(square, square + 2, king_side_castle);
+						moveCount++;
+					}
+				}
+			}
+
+			if (genCastling && queenSideCastlingRights && square == kingStartSquare && get_bit(bitboardPieces[rookIndex], queenSideRookSquare) == 1
+				&& get_bit(allPiecesOccupancy, square - 1) == 0 && get_bit(allPiecesOccupancy, square - 2) == 0 && get_bit(allPiecesOccupancy, square - 3) == 0)
+			{
+				// Queen side castling
+				if (moveCount < MAX_MOVES)
+				{
+					// Ensure no castling through checks
+					U64 attacked = attackMaps(info).attacked[Them];
+					if (!get_bit(attacked, square) && !get_bit(attacked, square - 1) && !get_bit(attacked, square - 2))
+					{
+						moveStack[moveCount] = encodeMove(square, square - 2, queen_side_castle);
+						moveCount++;
+					}
+				}
+			}
+		}
+	}
+
+	if (moveCount > MAX_MOVES)
+	{
+		moveCount = MAX_MOVES;  // Clamp it
+	}
+}
+
+// Generation for a side known at run time
+template <GenType type>
+void generateMoves(Color c, std::array<Move, MAX_MOVES>& moveStack, int& moveCount)
+{
+	AttackInfo info;
+	computeAttackInfo(c, info);
+	if (c == white) generateMoves<white, type>(info, moveStack, moveCount);
+	else generateMoves<black, type>(info, moveStack, moveCount);
+}
+
+void getPseudoLegalMoves(Color c, std::array<Move, MAX_MOVES>& moveStack, int& moveCount)
+{
+	generateMoves<gen_all>(c, moveStack, moveCount);
+}
+
+thread_local std::array<bool, MAX_DEPTH> savedWKS, savedWQS, savedBKS, savedBQS;
+thread_local std::array<U64, MAX_DEPTH> savedMaterialKey;
+
+template <Color Us>
+void makeMove(Move m, int ply)
+{
+	STAT_TIMER(makeUnmakeTime);
+	savedWKS[ply] = whiteKingSideCastlingRights;
+	savedWQS[ply] = whiteQueenSideCastlingRights;
+	savedBKS[ply] = blackKingSideCastlingRights;
+	savedBQS[ply] = blackQueenSideCastlingRights;
+	savedMaterialKey[ply] = materialKey;
+
+	constexpr int pawnIndex = (Us == white) ? bb_wpawn : bb_bpawn;
+	constexpr int oppPawnIndex = (Us == white) ? bb_bpawn : bb_wpawn;
+	constexpr int knightIndex = (Us == white) ? bb_wknight : bb_bknight;
+	constexpr int rookIndex = (Us == white) ? bb_wrook : bb_brook;
+	constexpr int kingIndex = (Us == white) ? bb_wking : bb_bking;
+	constexpr int down = (Us == white) ? oneRank : -oneRank; // from the en passant target to the captured pawn
+
+	int from = getFrom(m);
+	int to = getTo(m);
+	int flag = getFlag(m);
+
+	int currPieceIndex = getPieceIndex(from);
+
+	int& whichOppPieceIndex = (Us == white) ? whichBlackPieceIndexWasThere[ply] : whichWhitePieceIndexWasThere[ply];
+
+	U64& currOccupancy = (Us == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
+	U64& oppOccupancy = (Us == white) ? blackPiecesOccupancy : whitePiecesOccupancy;
+
+	bool kingSideCastlingRights = (Us == white) ? whiteKingSideCastlingRights : blackKingSideCastlingRights;
+	bool queenSideCastlingRights = (Us == white) ? whiteQueenSideCastlingRights : blackQueenSideCastlingRights;
+
+	if (flag == capture || flag >= knight_promo_capture)
+	{
+		whichOppPieceIndex = getPieceIndex(to); // No need to check for ep, a pawn was always there
+	}
+
+	// Key of the child position first, so its table entry and eval cache line are loaded from memory
+	// while the board is updated. negaMax probes them right after the move.
+	U64 childKey = positionKey ^ zobristSideToMove;
+	if (flag == king_side_castle || flag == queen_side_castle)
+	{
+		int rookFrom = (flag == king_side_castle) ? from + 3 : from - 4;
+		int rookTo = (flag == king_side_castle) ? to - 1 : to + 1;
+		childKey ^= zobristPieces[currPieceIndex][from] ^ zobristPieces[currPieceIndex][to] ^ zobristPieces[rookIndex][rookFrom] ^ zobristPieces[rookIndex][rookTo];
+	}
+	else
+	{
+		int toIndex = (flag >= knight_promotion) ? knightIndex + 2 * ((flag - knight_promotion) % 4) : currPieceIndex;
+		childKey ^= zobristPieces[currPieceIndex][from] ^ zobristPieces[toIndex][to];
+		if (flag == capture || flag >= knight_promo_capture) childKey ^= zobristPieces[whichOppPieceIndex][to];
+		else if (flag == en_passant_capture) childKey ^= zobristPieces[oppPawnIndex][to + down];
+	}
+	prefetch(&transpositionTable[childKey % ttSize]);
+	prefetch(&evalCache[childKey % EVAL_CACHE_SIZE]);
+
+	// Quiet move / pawn double push
+	if (flag == quiet_move || flag == double_pawn_push)
+	{
+		pop_bit(bitboardPieces[currPieceIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		set_bit(bitboardPieces[currPieceIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, currPieceIndex);
+
+		positionKey ^= zobristPieces[currPieceIndex][from];
+		positionKey ^= zobristPieces[currPieceIndex][to];
+
+	}
+
+	// Capture
+	else if (flag == capture)
+	{
+		pop_bit(bitboardPieces[currPieceIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		pop_bit(bitboardPieces[whichOppPieceIndex], to);
+		pop_bit(oppOccupancy, to);
+
+		set_bit(bitboardPieces[currPieceIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, currPieceIndex);
+
+		positionKey ^= zobristPieces[currPieceIndex][from];
+		positionKey ^= zobristPieces[whichOppPieceIndex][to];
+		positionKey ^= zobristPieces[currPieceIndex][to];
+
+		materialKey ^= zobristMaterial[whichOppPieceIndex][countBits(bitboardPieces[whichOppPieceIndex])];
+	}
+
+	// Promotion (no capture)
+	else if (flag >= knight_promotion && flag <= queen_promotion)
+	{
+		int promoIndex = knightIndex + 2 * (flag - knight_promotion);
+
+		pop_bit(bitboardPieces[pawnIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		set_bit(bitboardPieces[promoIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, promoIndex);
+
+		positionKey ^= zobristPieces[pawnIndex][from];
+		positionKey ^= zobristPieces[promoIndex][to];
+
+		materialKey ^= zobristMaterial[pawnIndex][countBits(bitboardPieces[pawnIndex])];
+		materialKey ^= zobristMaterial[promoIndex][countBits(bitboardPieces[promoIndex]) - 1];
+	}
+
+	// Promotion with capture
+	else if (flag >= knight_promo_capture)
+	{
+		int promoIndex = knightIndex + 2 * (flag - knight_promo_capture);
+
+		pop_bit(bitboardPieces[pawnIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		pop_bit(bitboardPieces[whichOppPieceIndex], to);
+		pop_bit(oppOccupancy, to);
+
+		set_bit(bitboardPieces[promoIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, promoIndex);
+
+		positionKey ^= zobristPieces[pawnIndex][from];
+		positionKey ^= zobristPieces[whichOppPieceIndex][to];
+		positionKey ^= zobristPieces[promoIndex][to];
+
+		materialKey ^= zobristMaterial[whichOppPieceIndex][countBits(bitboardPieces[whichOppPieceIndex])];
+		materialKey ^= zobristMaterial[pawnIndex][countBits(bitboardPieces[pawnIndex])];
+		materialKey ^= zobristMaterial[promoIndex][countBits(bitboardPieces[promoIndex]) - 1];
+	}
+
+	// En passant
+	else if (flag == en_passant_capture)
+	{
+		whichOppPieceIndex = oppPawnIndex; // Store captured pawn
+		pop_bit(bitboardPieces[pawnIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		pop_bit(bitboardPieces[oppPawnIndex], to + down);
+		pop_bit(oppOccupancy, to + down);
+		pop_bit(allPiecesOccupancy, to + down);
+		mainBoard[to + down] = epc_empty;
+
+		set_bit(bitboardPieces[pawnIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, pawnIndex);
+
+		positionKey ^= zobristPieces[pawnIndex][from];
+		positionKey ^= zobristPieces[oppPawnIndex][to + down];
+		positionKey ^= zobristPieces[pawnIndex][to];
+
+		materialKey ^= zobristMaterial[oppPawnIndex][countBits(bitboardPieces[oppPawnIndex])];
+	}
+
+	// Castling, the rook jumps from the corner next to the king
+	else if ((flag == king_side_castle && kingSideCastlingRights) || (flag == queen_side_castle && queenSideCastlingRights))
+	{
+		int rookFrom = (flag == king_side_castle) ? from + 3 : from - 4;
+		int rookTo = (flag == king_side_castle) ? to - 1 : to + 1;
+
+		pop_bit(bitboardPieces[kingIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		pop_bit(bitboardPieces[rookIndex], rookFrom);
+		pop_bit(currOccupancy, rookFrom);
+		pop_bit(allPiecesOccupancy, rookFrom);
+		mainBoard[from] = epc_empty;
+		mainBoard[rookFrom] = epc_empty;
+
+		set_bit(bitboardPieces[kingIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		set_bit(bitboardPieces[rookIndex], rookTo);
+		set_bit(currOccupancy, rookTo);
+		set_bit(allPiecesOccupancy, rookTo);
+		mainBoard[to] = convertPieceIndexToEPC(Us, kingIndex);
+		mainBoard[rookTo] = convertPieceIndexToEPC(Us, rookIndex);
+
+		positionKey ^= zobristPieces[kingIndex][from];
+		positionKey ^= zobristPieces[rookIndex][rookFrom];
+
+		positionKey ^= zobristPieces[kingIndex][to];
+		positionKey ^= zobristPieces[rookIndex][rookTo];
+	}
+
+	((Us == white) ? whiteMoveLog : blackMoveLog).push_back(m);
+
+	if (from == e1 || to == e1) { whiteKingSideCastlingRights = false; whiteQueenSideCastlingRights = false; }
+	if (from == e8 || to == e8) { blackKingSideCastlingRights = false; blackQueenSideCastlingRights = false; }
+	if (from == a1 || to == a1) whiteQueenSideCastlingRights = false;
+	if (from == h1 || to == h1) whiteKingSideCastlingRights = false;
+	if (from == a8 || to == a8) blackQueenSideCastlingRights = false;
+	if (from == h8 || to == h8) blackKingSideCastlingRights = false;
+
+	positionKey ^= zobristSideToMove;
+	assert(positionKey == childKey);
+}
+
+template <Color Us>
+void unmakeMove(Move m, int ply)
+{
+	STAT_TIMER(makeUnmakeTime);
+	constexpr Color Them = (Us == white) ? black : white;
+	constexpr int pawnIndex = (Us == white) ? bb_wpawn : bb_bpawn;
+	constexpr int oppPawnIndex = (Us == white) ? bb_bpawn : bb_wpawn;
+	constexpr int knightIndex = (Us == white) ? bb_wknight : bb_bknight;
+	constexpr int rookIndex = (Us == white) ? bb_wrook : bb_brook;
+	constexpr int kingIndex = (Us == white) ? bb_wking : bb_bking;
+	constexpr int down = (Us == white) ? oneRank : -oneRank; // from the en passant target to the captured pawn
+
+	int from = getTo(m);
+	int to = getFrom(m);
+	int flag = getFlag(m);
+
+	int currPieceIndex = getPieceIndex(from);
+
+	int whichOppPieceIndex = (Us == white) ? whichBlackPieceIndexWasThere[ply] : whichWhitePieceIndexWasThere[ply];
+
+	U64& currOccupancy = (Us == white) ? whitePiecesOccupancy : blackPiecesOccupancy;
+	U64& oppOccupancy = (Us == white) ? blackPiecesOccupancy : whitePiecesOccupancy;
+
+	// Quiet move / double pawn push
+	if (flag == quiet_move || flag == double_pawn_push)
+	{
+		pop_bit(bitboardPieces[currPieceIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		set_bit(bitboardPieces[currPieceIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, currPieceIndex);
+
+		positionKey ^= zobristPieces[currPieceIndex][from];
+		positionKey ^= zobristPieces[currPieceIndex][to];
+	}
+
+	// Capture
+	else if (flag == capture)
+	{
+		pop_bit(bitboardPieces[currPieceIndex], from);
+		pop_bit(currOccupancy, from);
+		mainBoard[from] = convertPieceIndexToEPC(Them, whichOppPieceIndex);
+
+		set_bit(bitboardPieces[whichOppPieceIndex], from);
+		set_bit(oppOccupancy, from);
+
+		set_bit(bitboardPieces[currPieceIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, currPieceIndex);
+
+		positionKey ^= zobristPieces[currPieceIndex][from];
+		positionKey ^= zobristPieces[whichOppPieceIndex][from];
+		positionKey ^= zobristPieces[currPieceIndex][to];
+	}
+
+	// Promotion without capture
+	else if (flag >= knight_promotion && flag <= queen_promotion)
+	{
+		int promoIndex = knightIndex + 2 * (flag - knight_promotion);
+
+		pop_bit(bitboardPieces[promoIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		set_bit(bitboardPieces[pawnIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, pawnIndex);
+
+		positionKey ^= zobristPieces[promoIndex][from];
+		positionKey ^= zobristPieces[pawnIndex][to];
+	}
+
+	// Promotion with capture
+	else if (flag >= knight_promo_capture && flag <= queen_promo_capture)
+	{
+		int promoIndex = knightIndex + 2 * (flag - knight_promo_capture);
+
+		pop_bit(bitboardPieces[promoIndex], from);
+		pop_bit(currOccupancy, from);
+		mainBoard[from] = convertPieceIndexToEPC(Them, whichOppPieceIndex);
+
+		set_bit(bitboardPieces[whichOppPieceIndex], from);
+		set_bit(oppOccupancy, from);
+
+		set_bit(bitboardPieces[pawnIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, pawnIndex);
+
+		positionKey ^= zobristPieces[promoIndex][from];
+		positionKey ^= zobristPieces[whichOppPieceIndex][from];
+		positionKey ^= zobristPieces[pawnIndex][to];
+	}
+
+	// En passant
+	else if (flag == en_passant_capture)
+	{
+		pop_bit(bitboardPieces[pawnIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		mainBoard[from] = epc_empty;
+
+		int capturedPawnSquare = from + down;
+
+		set_bit(bitboardPieces[oppPawnIndex], capturedPawnSquare);
+		set_bit(oppOccupancy, capturedPawnSquare);
+		set_bit(allPiecesOccupancy, capturedPawnSquare);
+		mainBoard[capturedPawnSquare] = convertPieceIndexToEPC(Them, oppPawnIndex);
+
+		set_bit(bitboardPieces[pawnIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		mainBoard[to] = convertPieceIndexToEPC(Us, pawnIndex);
+
+		positionKey ^= zobristPieces[pawnIndex][from];
+		positionKey ^= zobristPieces[oppPawnIndex][capturedPawnSquare];
+		positionKey ^= zobristPieces[pawnIndex][to];
+	}
+
+	// Castling, the rook goes back to its corner
+	else if (flag == king_side_castle || flag == queen_side_castle)
+	{
+		int rookFrom = (flag == king_side_castle) ? from - 1 : from + 1;
+		int rookTo = (flag == king_side_castle) ? to + 3 : to - 4;
+
+		pop_bit(bitboardPieces[kingIndex], from);
+		pop_bit(currOccupancy, from);
+		pop_bit(allPiecesOccupancy, from);
+		pop_bit(bitboardPieces[rookIndex], rookFrom);
+		pop_bit(currOccupancy, rookFrom);
+		pop_bit(allPiecesOccupancy, rookFrom);
+		mainBoard[from] = epc_empty;
+		mainBoard[rookFrom] = epc_empty;
+
+		set_bit(bitboardPieces[kingIndex], to);
+		set_bit(currOccupancy, to);
+		set_bit(allPiecesOccupancy, to);
+		set_bit(bitboardPieces[rookIndex], rookTo);
+		set_bit(currOccupancy, rookTo);
+		set_bit(allPiecesOccupancy, rookTo);
+		mainBoard[to] = convertPieceIndexToEPC(Us, kingIndex);
+		mainBoard[rookTo] = convertPieceIndexToEPC(Us, rookIndex);
+
+		positionKey ^= zobristPieces[kingIndex][from];
+		positionKey ^= zobristPieces[rookIndex][rookFrom];
+
+		positionKey ^= zobristPieces[kingIndex][to];
+		positionKey ^= zobristPieces[rookIndex][rookTo];
+	}
+
+	((Us == white) ? whiteMoveLog : blackMoveLog).pop_back();
+
+	whiteKingSideCastlingRights = savedWKS[ply];
+	whiteQueenSideCastlingRights = savedWQS[ply];
+	blackKingSideCastlingRights = savedBKS[ply];
+	blackQueenSideCastlingRights = savedBQS[ply];
+	materialKey = savedMaterialKey[ply];
+
+	positionKey ^= zobristSideToMove;
+}
+
+void makeMove(Move m, Color c, int ply)
+{
+	if (c == white) makeMove<white>(m, ply);
+	else makeMove<black>(m, ply);
+}
+
+void unmakeMove(Move m, Color c, int ply)
+{
+	if (c == white) unmakeMove<white>(m, ply);
+	else unmakeMove<black>(m, ply);
+}
+
+std::array<int, 12> pieceValueMVV = { 100, 100, 300, 300, 300, 300, 500, 500, 900, 900, 10000, 10000 };
+
+// Static exchange evaluation of a capture: the material the moving side wins when both sides keep
+// recapturing on the target square with their least valuable piece (x-rays included, pins ignored)
+// and either may stop when recapturing would lose
+int staticExchange(Move m)
+{
+	int from = getFrom(m);
+	int to = getTo(m);
+	int pieceIndex = getPieceIndex(from);
+	Color side = (pieceIndex % 2 == 0) ? white : black;
+
+	U64 occupancy = allPiecesOccupancy;
+	std::array<int, 32> gain{};
+	if (getFlag(m) == en_passant_capture)
+	{
+		gain[0] = pieceValueMVV[bb_wpawn];
+		occupancy ^= 1ULL << (to + ((side == white) ? oneRank : -oneRank));
+	}
+	else gain[0] = pieceValueMVV[getPieceIndex(to)];
+
+	U64 diagonalSliders = bitboardPieces[bb_wbishop] | bitboardPieces[bb_bbishop] | bitboardPieces[bb_wqueen] | bitboardPieces[bb_bqueen];
+	U64 straightSliders = bitboardPieces[bb_wrook] | bitboardPieces[bb_brook] | bitboardPieces[bb_wqueen] | bitboardPieces[bb_bqueen];
+	U64 attackers = attackersTo(to, occupancy);
+	U64 fromBit = 1ULL << from;
+
+	int depth{ 0 };
+	while (fromBit != 0 && depth < 31)
+	{
+		depth++;
+		gain[depth] = pieceValueMVV[pieceIndex] - gain[depth - 1]; // if the piece on the square is taken next
+
+		occupancy ^= fromBit;
+		attackers |= (bishopAttacks(to, occupancy) & diagonalSliders) | (rookAttacks(to, occupancy) & straightSliders);
+		attackers &= occupancy;
+		side = (side == white) ? black : white;
+
+		fromBit = 0;
+		for (int index = (side == white) ? bb_wpawn : bb_bpawn; index <= bb_bking; index += 2)
+		{
+			U64 candidates = attackers & bitboardPieces[index];
+			if (candidates != 0)
+			{
+				fromBit = candidates & (~candidates + 1);
+				pieceIndex = index;
+				break;
+			}
+		}
+	}
+
+	while (--depth > 0) gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+	return gain[0];
+}
+
+int scoreMove(Color c, Move m)
+{
+	int from = getFrom(m);
+	int to = getTo(m);
+	int flag = getFlag(m);
+
+	if (flag == capture || flag >= knight_promo_capture)
+	{
+		int attackerValue = pieceValueMVV[getPieceIndex(from)];
+		int victimValue = pieceValueMVV[getPieceIndex(to)];
+
+		return victimValue * 10 - attackerValue;
+	}
+	else if (flag == knight_promotion)
+	{
+		return 3000;
+	}
+	else if (flag == bishop_promotion)
+	{
+		return 3000;
+	}
+	else if (flag == rook_promotion)
+	{
+		return 5000;
+	}
+	else if (flag == queen_promotion)
+	{
+		return 9000;
+	}
+	else if (flag == king_side_castle)
+	{
+		return 2000;
+	}
+	else if (flag == queen_side_castle)
+	{
+		return 1500;
+	}
+
+	return 0;
+}
+
+void sortMoves(Color c, std::array<Move, MAX_MOVES>& moves, int moveCount)
+{
+	for (int i = 1; i < moveCount; i++)
+	{
+		Move key = moves[i];
+		int keyScore = scoreMove(c, key);
+		int j = i - 1;
+
+		while (j >= 0 && scoreMove(c, moves[j]) < keyScore)
+		{
+			moves[j + 1] = moves[j];
+			j--;
+		}
+		if (j < MAX_MOVES) // silence a warning
+		{
+			moves[j + 1] = key;
+		}
+	}
+}
+
+/*
+--------------------
+
+MEMORY MAPPED FILES
+
+--------------------
+*/
+
+// Read only file mapping, used for the tablebases and the opening book
+struct MappedFile {
+	const uint8_t* data{ nullptr };
+	U64 size{ 0 };
+	void* handle{ nullptr }; // Windows file mapping object
+};
+
+void unmapFile(MappedFile& file)
+{
+	if (file.data == nullptr) return;
+#ifdef _WIN32
+	UnmapViewOfFile(file.data);
+	CloseHandle(file.handle);
+#else
+	munmap((void*)file.data, file.size);
+#endif
+	file = MappedFile{};
+}
+
+// Maps a whole file read only, false if it can't be opened or is empty
+bool mapFile(const std::string& path, MappedFile& file)
+{
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(handle, &size);
+	HANDLE mapping = (size.QuadPart > 0) ? CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	CloseHandle(handle);
+	if (mapping == nullptr) return false;
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	file.handle = mapping;
+	file.size = (U64)size.QuadPart;
+#else
+	int handle = open(path.c_str(), O_RDONLY);
+	if (handle == -1) return false;
+
+	struct stat fileStatus;
+	if (fstat(handle, &fileStatus) != 0 || fileStatus.st_size == 0)
+	{
+		close(handle);
+		return false;
+	}
+
+	void* data = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_SHARED, handle, 0);
+	close(handle);
+	if (data == MAP_FAILED) return false;
+	madvise(data, fileStatus.st_size, MADV_RANDOM); // Probes jump around the file
+	file.size = (U64)fileStatus.st_size;
+#endif
+
+	file.data = (const uint8_t*)data;
+	return true;
+}
+
+/*
+--------------------
+
+TABLEBASES
+
+--------------------
+*/
+
+// Syzygy WDL/DTZ probing. The table files of SyzygyPath are memory mapped, the file layout and the
+// position encoding follow the reference prober by Ronald de Man. Inside this section squares are
+// numbered like the table files, a1 = 0 .. h8 = 63 (engine square ^ 56), and pieces use the table
+// codes, pawn 1 .. king 6 with 8 added for black.
+
+constexpr int TB_PIECES = 7;
+
+const auto tbWinScore = -checkmateScore - 2 * MAX_DEPTH; // below every mate score
+
+enum TBWDL { tb_loss = -2, tb_blessed_loss = -1, tb_draw = 0, tb_cursed_win = 1, tb_win = 2 };
+
+enum TBProbeState {
+	tb_change_stm = -1, // DTZ table is for the other side to move
+	tb_fail = 0,
+	tb_ok = 1,
+	tb_zeroing_best_move = 2 // best move is a capture or pawn move, DTZ isn't stored
+};
+
+enum TBFlag {
+	tbf_stm = 1,
+	tbf_mapped = 2,
+	tbf_win_plies = 4,
+	tbf_loss_plies = 8,
+	tbf_wide = 16,
+	tbf_single_value = 128
+};
+
+// Huffman coded data of one table (one side to move and, with pawns, one leading pawn file)
+struct TBPairsData {
+	uint8_t flags{ 0 };
+	U64 blockSize{ 0 }; // bytes
+	U64 span{ 0 }; // a sparse index entry about every span values
+	uint32_t numBlocks{ 0 };
+	int maxSymLen{ 0 };
+	int minSymLen{ 0 }; // also the value of single value tables
+	const uint8_t* lowestSym{ nullptr }; // uint16 per symbol length
+	const uint8_t* btree{ nullptr }; // 3 bytes per symbol: left and right 12 bit symbols
+	const uint8_t* blockLength{ nullptr }; // uint16 per block, stored values - 1
+	U64 blockLengthSize{ 0 };
+	const uint8_t* sparseIndex{ nullptr }; // 6 bytes per entry: uint32 block, uint16 offset
+	U64 sparseIndexSize{ 0 };
+	const uint8_t* data{ nullptr };
+	std::vector<U64> base64; // lowest symbol of every length, padded to 64 bits
+	std::vector<uint8_t> symLen; // values - 1 a symbol expands to
+	int pieces[TB_PIECES]{};
+	U64 groupIdx[TB_PIECES + 1]{};
+	int groupLen[TB_PIECES + 1]{};
+	uint16_t mapIdx[4]{}; // DTZ value maps of win, loss, cursed win, blessed loss
+};
+
+struct TBTable {
+	MappedFile file;
+	bool dtz{ false };
+	const uint8_t* dtzMap{ nullptr };
+	TBPairsData items[2][4]; // [side to move][leading pawn file], DTZ tables have one side
+
+	TBPairsData* get(int stm, int file) { return &items[dtz ? 0 : stm][file]; }
+};
+
+// One material combination like KRPvKR, white is the stronger side in the file name
+struct TBEntry {
+	std::string name;
+	U64 key{ 0 };
+	U64 key2{ 0 }; // colours swapped
+	int pieceCount{ 0 };
+	bool hasPawns{ false };
+	bool hasUniquePieces{ false };
+	int pawnCount[2]{}; // leading colour first
+	TBTable wdl;
+	TBTable dtz;
+};
+
+std::deque<TBEntry> tbEntries;
+std::unordered_map<U64, TBEntry*> tbEntryByKey;
+int tbLargest{ 0 }; // most pieces of a loaded table
+int tbProbeLimit{ TB_PIECES }; // UCI SyzygyProbeLimit
+thread_local U64 tbHits{ 0 };
+
+int tbMapA1D1D4[64];
+int tbMapB1H1H7[64];
+int tbMapKK[10][64];
+U64 tbBinomial[6][64];
+int tbMapPawns[64];
+int tbLeadPawnIdx[6][64];
+int tbLeadPawnsSize[6][4];
+
+inline int tbFileOf(int square) { return square & 7; }
+inline int tbRankOf(int square) { return square >> 3; }
+inline int tbOffA1H8(int square) { return tbRankOf(square) - tbFileOf(square); }
+
+inline uint16_t readLE16(const uint8_t* p) { return uint16_t(p[0] | (p[1] << 8)); }
+inline uint32_t readLE32(const uint8_t* p) { return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24); }
+inline uint16_t readBE16(const uint8_t* p) { return uint16_t((p[0] << 8) | p[1]); }
+inline uint32_t readBE32(const uint8_t* p) { return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]); }
+inline U64 readBE64(const uint8_t* p) { return (U64(readBE32(p)) << 32) | readBE32(p + 4); }
+
+inline int tbSymLeft(const TBPairsData* d, int sym) { const uint8_t* lr = d->btree + 3 * sym; return ((lr[1] & 0xF) << 8) | lr[0]; }
+inline int tbSymRight(const TBPairsData* d, int sym) { const uint8_t* lr = d->btree + 3 * sym; return (lr[2] << 4) | (lr[1] >> 4); }
+
+// Index tables of the position encoding
+void initTablebaseIndexing()
+{
+	int code{ 0 };
+	for (int s = 0; s < 64; s++)
+	{
+		if (tbOffA1H8(s) < 0) tbMapB1H1H7[s] = code++;
+	}
+
+	// a1-d1-d4 triangle, diagonal squares last
+	std::vector<int> diagonal;
+	code = 0;
+	for (int s = 0; s < 64; s++)
+	{
+		tbMapA1D1D4[s] = 0;
+		if (tbRankOf(s) > 3 || tbFileOf(s) > 3) continue;
+		if (tbOffA1H8(s) < 0) tbMapA1D1D4[s] = code++;
+		else if (tbOffA1H8(s) == 0) diagonal.push_back(s);
+	}
+	for (int s : diagonal) tbMapA1D1D4[s] = code++;
+
+	// The 462 legal king pairs with the first king in the triangle, both on the diagonal last
+	std::vector<std::pair<int, int>> bothOnDiagonal;
+	code = 0;
+	for (int idx = 0; idx < 10; idx++)
+	{
+		for (int s1 = 0; s1 < 64; s1++)
+		{
+			if (tbRankOf(s1) > 3 || tbFileOf(s1) > 3 || tbOffA1H8(s1) > 0 || tbMapA1D1D4[s1] != idx) continue;
+
+			for (int s2 = 0; s2 < 64; s2++)
+			{
+				if (std::abs(tbFileOf(s1) - tbFileOf(s2)) <= 1 && std::abs(tbRankOf(s1) - tbRankOf(s2)) <= 1) continue; // Touching kings
+				if (tbOffA1H8(s1) == 0 && tbOffA1H8(s2) > 0) continue; // First on the diagonal, second above
+				if (tbOffA1H8(s1) == 0 && tbOffA1H8(s2) == 0) bothOnDiagonal.emplace_back(idx, s2);
+				else tbMapKK[idx][s2] = code++;
+			}
+		}
+	}
+	for (auto& pair : bothOnDiagonal) tbMapKK[pair.first][pair.second] = code++;
+
+	// tbBinomial[k][n]: ways to choose k of n squares
+	for (int k = 0; k < 6; k++)
+	{
+		for (int n = 0; n < 64; n++)
+		{
+			tbBinomial[k][n] = (k == 0) ? 1 : (n == 0) ? 0 : tbBinomial[k - 1][n - 1] + tbBinomial[k][n - 1];
+		}
+	}
+
+	// tbMapPawns numbers a2-h7 from the edges inwards, so the leading pawn (nearest the edge,
+	// lowest rank) has the highest value. Leading pawn groups are indexed per file a-d.
+	int availableSquares{ 47 };
+	for (int leadPawnsCount = 1; leadPawnsCount <= 5; leadPawnsCount++)
+	{
+		for (int file = 0; file < 4; file++)
+		{
+			int idx{ 0 };
+			for (int rank = 1; rank <= 6; rank++)
+			{
+				int s = rank * 8 + file;
+				if (leadPawnsCount == 1)
+				{
+					tbMapPawns[s] = availableSquares--;
+					tbMapPawns[s ^ 7] = availableSquares--;
+				}
+				tbLeadPawnIdx[leadPawnsCount][s] = idx;
+				idx += (int)tbBinomial[leadPawnsCount - 1][tbMapPawns[s]];
+			}
+			tbLeadPawnsSize[leadPawnsCount][file] = idx;
+		}
+	}
+}
+
+/* --- Table files --- */
+
+// Maps a table file, the size of a valid table is 16 mod 64 and it starts with magic
+bool mapTableFile(const std::string& path, const uint8_t magic[4], MappedFile& file)
+{
+	if (!mapFile(path, file)) return false;
+	if (file.size % 64 == 16 && std::equal(magic, magic + 4, file.data)) return true;
+
+	unmapFile(file);
+	return false;
+}
+
+// Material signature, 4 bits per count of pawns to queens, white then black
+U64 tbMaterialKey(const int counts[2][5])
+{
+	U64 key{ 0 };
+	for (int side = 0; side < 2; side++)
+	{
+		for (int type = 0; type < 5; type++)
+		{
+			key |= (U64)counts[side][type] << (20 * side + 4 * type);
+		}
+	}
+	return key;
+}
+
+// Material signature of the current position
+U64 tbPositionKey()
+{
+	int counts[2][5] = {
+		{ countBits(bitboardPieces[bb_wpawn]), countBits(bitboardPieces[bb_wknight]), countBits(bitboardPieces[bb_wbishop]), countBits(bitboardPieces[bb_wrook]), countBits(bitboardPieces[bb_wqueen]) },
+		{ countBits(bitboardPieces[bb_bpawn]), countBits(bitboardPieces[bb_bknight]), countBits(bitboardPieces[bb_bbishop]), countBits(bitboardPieces[bb_brook]), countBits(bitboardPieces[bb_bqueen]) }
+	};
+	return tbMaterialKey(counts);
+}
+
+// Table code of the piece on a table square, 0 if empty
+int tbPieceOn(int tbSquare)
+{
+	int piece = mainBoard[tbSquare ^ 56];
+	if (piece == epc_empty) return 0;
+	int type = piece & 7;
+	return ((type <= ept_bpawn) ? 1 : type - 1) | (piece & epc_blacky);
+}
+
+// Sets up entry from a name like KRPvKR, false if it isn't one
+bool parseTableName(const std::string& name, TBEntry& entry)
+{
+	const std::string types = "PNBRQ";
+	int counts[2][5] = {};
+	int kings[2] = {};
+	int side{ 0 };
+
+	for (char ch : name)
+	{
+		if (ch == 'v' && side == 0) side = 1;
+		else if (ch == 'K') kings[side]++;
+		else if (types.find(ch) != std::string::npos) counts[side][types.find(ch)]++;
+		else return false;
+	}
+	if (side != 1 || kings[0] != 1 || kings[1] != 1) return false;
+
+	int swapped[2][5];
+	entry.pieceCount = 2;
+	for (int type = 0; type < 5; type++)
+	{
+		entry.pieceCount += counts[0][type] + counts[1][type];
+		if (counts[0][type] == 1 || counts[1][type] == 1) entry.hasUniquePieces = true;
+		swapped[0][type] = counts[1][type];
+		swapped[1][type] = counts[0][type];
+	}
+	if (entry.pieceCount > TB_PIECES) return false;
+
+	entry.name = name;
+	entry.key = tbMaterialKey(counts);
+	entry.key2 = tbMaterialKey(swapped);
+	entry.hasPawns = counts[0][0] + counts[1][0] > 0;
+
+	// With pawns on both sides the side with fewer pawns leads, it compresses better
+	bool whiteLeads = counts[1][0] == 0 || (counts[0][0] != 0 && counts[1][0] >= counts[0][0]);
+	entry.pawnCount[0] = whiteLeads ? counts[0][0] : counts[1][0];
+	entry.pawnCount[1] = whiteLeads ? counts[1][0] : counts[0][0];
+	return true;
+}
+
+/* --- Table layout --- */
+
+// Number of values - 1 every symbol expands to, following the pair tree
+uint8_t setSymLen(TBPairsData* d, int sym, std::vector<bool>& visited)
+{
+	visited[sym] = true;
+	int right = tbSymRight(d, sym);
+	if (right == 0xFFF) return 0;
+
+	int left = tbSymLeft(d, sym);
+	if (!visited[left]) d->symLen[left] = setSymLen(d, left, visited);
+	if (!visited[right]) d->symLen[right] = setSymLen(d, right, visited);
+	return uint8_t(d->symLen[left] + d->symLen[right] + 1);
+}
+
+const uint8_t* setSizes(TBPairsData* d, const uint8_t* data)
+{
+	d->flags = *data++;
+	if (d->flags & tbf_single_value)
+	{
+		d->numBlocks = 0;
+		d->span = 0;
+		d->sparseIndexSize = 0;
+		d->minSymLen = *data++;
+		return data;
+	}
+
+	// groupLen is zero terminated and the last groupIdx is the size of the table
+	int groups{ 0 };
+	while (d->groupLen[groups] != 0) groups++;
+	U64 tableSize = d->groupIdx[groups];
+
+	d->blockSize = 1ULL << *data++;
+	d->span = 1ULL << *data++;
+	d->sparseIndexSize = (tableSize + d->span - 1) / d->span;
+	int padding = *data++;
+	d->numBlocks = readLE32(data);
+	data += 4;
+	d->blockLengthSize = (U64)d->numBlocks + padding; // Padded so the sparse index never points out of range
+	d->maxSymLen = *data++;
+	d->minSymLen = *data++;
+	d->lowestSym = data;
+	d->base64.assign(d->maxSymLen - d->minSymLen + 1, 0);
+
+	// Canonical Huffman code: longer symbols have lower values, base64[i] >= base64[i + 1]
+	for (int i = (int)d->base64.size() - 2; i >= 0; i--)
+	{
+		d->base64[i] = (d->base64[i + 1] + readLE16(d->lowestSym + 2 * i) - readLE16(d->lowestSym + 2 * (i + 1))) / 2;
+	}
+	for (size_t i = 0; i < d->base64.size(); i++)
+	{
+		d->base64[i] <<= 64 - i - d->minSymLen;
+	}
+
+	data += d->base64.size() * 2;
+	d->symLen.assign(readLE16(data), 0);
+	data += 2;
+	d->btree = data;
+
+	std::vector<bool> visited(d->symLen.size());
+	for (size_t sym = 0; sym < d->symLen.size(); sym++)
+	{
+		if (!visited[sym]) d->symLen[sym] = setSymLen(d, (int)sym, visited);
+	}
+
+	return data + d->symLen.size() * 3 + (d->symLen.size() & 1);
+}
+
+const uint8_t* setDTZMap(TBTable& table, const uint8_t* data, int maxFile)
+{
+	table.dtzMap = data;
+	for (int file = 0; file <= maxFile; file++)
+	{
+		TBPairsData* d = table.get(0, file);
+		if (!(d->flags & tbf_mapped)) continue;
+
+		if (d->flags & tbf_wide)
+		{
+			data += (uintptr_t)data & 1;
+			for (int i = 0; i < 4; i++)
+			{
+				d->mapIdx[i] = uint16_t((data - table.dtzMap) / 2 + 1);
+				data += 2 * readLE16(data) + 2;
+			}
+		}
+		else
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				d->mapIdx[i] = uint16_t(data - table.dtzMap + 1);
+				data += *data + 1;
+			}
+		}
+	}
+	return data + ((uintptr_t)data & 1);
+}
+
+// Groups of equal pieces and the factor of every group in the index
+void setGroups(const TBEntry& entry, TBPairsData* d, const int order[2], int file)
+{
+	int n{ 0 };
+	int firstLen = entry.hasPawns ? 0 : entry.hasUniquePieces ? 3 : 2;
+	d->groupLen[n] = 1;
+
+	for (int i = 1; i < entry.pieceCount; i++)
+	{
+		if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1]) d->groupLen[n]++;
+		else d->groupLen[++n] = 1;
+	}
+	d->groupLen[++n] = 0;
+
+	// The file stores in which order the groups are encoded: the leading group at order[0],
+	// the remaining pawns (pawns on both sides) at order[1]
+	bool pawnsOnBothSides = entry.hasPawns && entry.pawnCount[1] != 0;
+	int next = pawnsOnBothSides ? 2 : 1;
+	int freeSquares = 64 - d->groupLen[0] - (pawnsOnBothSides ? d->groupLen[1] : 0);
+	U64 idx{ 1 };
+
+	for (int k = 0; next < n || k == order[0] || k == order[1]; k++)
+	{
+		if (k == order[0])
+		{
+			d->groupIdx[0] = idx;
+			idx *= entry.hasPawns ? tbLeadPawnsSize[d->groupLen[0]][file] : entry.hasUniquePieces ? 31332 : 462;
+		}
+		else if (k == order[1])
+		{
+			d->groupIdx[1] = idx;
+			idx *= tbBinomial[d->groupLen[1]][48 - d->groupLen[0]];
+		}
+		else
+		{
+			d->groupIdx[next] = idx;
+			idx *= tbBinomial[d->groupLen[next]][freeSquares];
+			freeSquares -= d->groupLen[next++];
+		}
+	}
+	d->groupIdx[n] = idx;
+}
+
+// Reads the table headers, data points past the magic
+bool initTable(const TBEntry& entry, TBTable& table, const uint8_t* data)
+{
+	const uint8_t* end = table.file.data + table.file.size;
+
+	// First byte: 1 split (both sides to move stored), 2 has pawns
+	if (((*data & 2) != 0) != entry.hasPawns) return false;
+	data++;
+
+	int sides = (!table.dtz && entry.key != entry.key2) ? 2 : 1;
+	int maxFile = entry.hasPawns ? 3 : 0;
+	bool pawnsOnBothSides = entry.hasPawns && entry.pawnCount[1] != 0;
+
+	for (int file = 0; file <= maxFile; file++)
+	{
+		for (int i = 0; i < sides; i++) *table.get(i, file) = TBPairsData{};
+
+		int order[2][2] = {
+			{ *data & 0xF, pawnsOnBothSides ? *(data + 1) & 0xF : 0xF },
+			{ *data >> 4, pawnsOnBothSides ? *(data + 1) >> 4 : 0xF }
+		};
+		data += 1 + pawnsOnBothSides;
+
+		for (int k = 0; k < entry.pieceCount; k++, data++)
+		{
+			for (int i = 0; i < sides; i++) table.get(i, file)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+		}
+		for (int i = 0; i < sides; i++) setGroups(entry, table.get(i, file), order[i], file);
+	}
+
+	data += (uintptr_t)data & 1;
+
+	for (int file = 0; file <= maxFile; file++)
+	{
+		for (int i = 0; i < sides; i++) data = setSizes(table.get(i, file), data);
+	}
+
+	if (table.dtz) data = setDTZMap(table, data, maxFile);
+
+	for (int file = 0; file <= maxFile; file++)
+	{
+		for (int i = 0; i < sides; i++)
+		{
+			table.get(i, file)->sparseIndex = data;
+			data += table.get(i, file)->sparseIndexSize * 6;
+		}
+	}
+	for (int file = 0; file <= maxFile; file++)
+	{
+		for (int i = 0; i < sides; i++)
+		{
+			table.get(i, file)->blockLength = data;
+			data += table.get(i, file)->blockLengthSize * 2;
+		}
+	}
+	for (int file = 0; file <= maxFile; file++)
+	{
+		for (int i = 0; i < sides; i++)
+		{
+			data = (const uint8_t*)(((uintptr_t)data + 0x3F) & ~(uintptr_t)0x3F); // 64 byte alignment
+			table.get(i, file)->data = data;
+			data += table.get(i, file)->numBlocks * table.get(i, file)->blockSize;
+		}
+	}
+
+	return data <= end;
+}
+
+// Finds name in the SyzygyPath directories
+std::string findTableFile(const std::vector<std::string>& directories, const std::string& name)
+{
+	for (const std::string& directory : directories)
+	{
+		std::filesystem::path path = std::filesystem::path(directory) / name;
+		std::error_code error;
+		if (std::filesystem::is_regular_file(path, error)) return path.string();
+	}
+	return "";
+}
+
+void freeTablebases()
+{
+	for (TBEntry& entry : tbEntries)
+	{
+		unmapFile(entry.wdl.file);
+		unmapFile(entry.dtz.file);
+	}
+	tbEntries.clear();
+	tbEntryByKey.clear();
+	tbLargest = 0;
+}
+
+// UCI SyzygyPath: maps every WDL table (and its DTZ table if present) of the directories,
+// separated by ';' on Windows and ':' elsewhere. An empty path or <empty> unloads the tables.
+void initTablebases(const std::string& paths)
+{
+	static const uint8_t wdlMagic[4] = { 0x71, 0xE8, 0x23, 0x5D };
+	static const uint8_t dtzMagic[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+
+	freeTablebases();
+	if (paths.empty() || paths == "<empty>") return;
+
+#ifdef _WIN32
+	const char separator = ';';
+#else
+	const char separator = ':';
+#endif
+	std::vector<std::string> directories;
+	std::istringstream pathStream(paths);
+	std::string directory;
+	while (std::getline(pathStream, directory, separator))
+	{
+		if (!directory.empty()) directories.push_back(directory);
+	}
+
+	int dtzCount{ 0 };
+	for (const std::string& dir : directories)
+	{
+		std::error_code error;
+		for (const auto& file : std::filesystem::directory_iterator(dir, error))
+		{
+			if (file.path().extension() != ".rtbw") continue;
+
+			TBEntry entry;
+			if (!parseTableName(file.path().stem().string(), entry) || tbEntryByKey.count(entry.key) != 0) continue;
+
+			tbEntries.push_back(entry);
+			TBEntry& added = tbEntries.back();
+			added.dtz.dtz = true;
+
+			if (!mapTableFile(file.path().string(), wdlMagic, added.wdl.file) || !initTable(added, added.wdl, added.wdl.file.data + 4))
+			{
+				std::cout << "info string Bad tablebase file " << file.path().string() << "\n";
+				unmapFile(added.wdl.file);
+				tbEntries.pop_back();
+				continue;
+			}
+
+			std::string dtzPath = findTableFile(directories, added.name + ".rtbz");
+			if (!dtzPath.empty() && mapTableFile(dtzPath, dtzMagic, added.dtz.file))
+			{
+				if (initTable(added, added.dtz, added.dtz.file.data + 4)) dtzCount++;
+				else unmapFile(added.dtz.file);
+			}
+
+			tbEntryByKey[added.key] = &added;
+			tbEntryByKey[added.key2] = &added;
+			tbLargest = std::max(tbLargest, added.pieceCount);
+		}
+	}
+
+	std::cout << "info string Found " << tbEntries.size() << " WDL and " << dtzCount << " DTZ tablebase files, largest " << tbLargest << " pieces" << "\n";
+}
+
+/* --- Probing --- */
+
+// Value number idx of a table
+int decompressPairs(const TBPairsData* d, U64 idx)
+{
+	if (d->flags & tbf_single_value) return d->minSymLen;
+
+	// The sparse index gives a block and an offset near idx, walk the block lengths to the exact block
+	const uint8_t* sparseEntry = d->sparseIndex + 6 * (idx / d->span);
+	uint32_t block = readLE32(sparseEntry);
+	long long offset = readLE16(sparseEntry + 4);
+	offset += (long long)(idx % d->span) - (long long)(d->span / 2);
+
+	while (offset < 0) offset += readLE16(d->blockLength + 2 * --block) + 1;
+	while (offset > readLE16(d->blockLength + 2 * block)) offset -= readLE16(d->blockLength + 2 * block++) + 1;
+
+	// Read Huffman symbols until the one that contains offset
+	const uint8_t* ptr = d->data + (U64)block * d->blockSize;
+	U64 buffer = readBE64(ptr);
+	ptr += 8;
+	int bufferBits{ 64 };
+	int sym;
+
+	while (true)
+	{
+		int len{ 0 };
+		while (buffer < d->base64[len]) len++;
+		sym = int((buffer - d->base64[len]) >> (64 - len - d->minSymLen));
+		sym += readLE16(d->lowestSym + 2 * len);
+		if (offset < d->symLen[sym] + 1) break;
+
+		offset -= d->symLen[sym] + 1;
+		len += d->minSymLen;
+		buffer <<= len;
+		bufferBits -= len;
+		if (bufferBits <= 32)
+		{
+			bufferBits += 32;
+			buffer |= (U64)readBE32(ptr) << (64 - bufferBits);
+			ptr += 4;
+		}
+	}
+
+	// Expand the symbol's pairs down to the value
+	while (d->symLen[sym] != 0)
+	{
+		int left = tbSymLeft(d, sym);
+		if (offset < d->symLen[left] + 1) sym = left;
+		else
+		{
+			offset -= d->symLen[left] + 1;
+			sym = tbSymRight(d, sym);
+		}
+	}
+	return tbSymLeft(d, sym);
+}
+
+// DTZ value of a table in plies
+int mapDTZScore(TBTable& table, int file, int value, int wdl)
+{
+	static const int wdlMap[] = { 1, 3, 0, 2, 0 };
+	TBPairsData* d = table.get(0, file);
+
+	if (d->flags & tbf_mapped)
+	{
+		int mapIdx = d->mapIdx[wdlMap[wdl + 2]];
+		if (d->flags & tbf_wide) value = readLE16(table.dtzMap + 2 * (mapIdx + value));
+		else value = table.dtzMap[mapIdx + value];
+	}
+
+	// Tables store moves unless the flags say plies
+	if ((wdl == tb_win && !(d->flags & tbf_win_plies)) || (wdl == tb_loss && !(d->flags & tbf_loss_plies)) || wdl == tb_cursed_win || wdl == tb_blessed_loss)
+	{
+		value *= 2;
+	}
+	return value + 1;
+}
+
+// Looks up the current position, c to move: WDL value or DTZ in plies for a dtz table
+int probeTable(Color c, bool dtz, int wdl, TBProbeState& state)
+{
+	if (countBits(allPiecesOccupancy) == 2) return tb_draw; // KvK
+
+	U64 key = tbPositionKey();
+	auto found = tbEntryByKey.find(key);
+	if (found == tbEntryByKey.end() || (dtz && found->second->dtz.file.data == nullptr))
+	{
+		state = tb_fail;
+		return 0;
+	}
+	TBEntry& entry = *found->second;
+	TBTable& table = dtz ? entry.dtz : entry.wdl;
+
+	// Tables are stored with white as the stronger side, and symmetric ones with white to move.
+	// Otherwise swap the colours and mirror the ranks.
+	bool symmetricBlackToMove = entry.key == entry.key2 && c == black;
+	bool blackStronger = key != entry.key;
+	bool flip = symmetricBlackToMove || blackStronger;
+	int flipColor = flip ? 8 : 0;
+	int flipSquares = flip ? 56 : 0;
+	int stm = flip ^ (c == black);
+
+	int squares[TB_PIECES];
+	int pieces[TB_PIECES];
+	int size{ 0 };
+	int leadPawnsCount{ 0 };
+	int leadPawn{ 0 };
+	int file{ 0 };
+
+	// Pawn tables are split by the file of the leading pawn, the one with the highest tbMapPawns
+	if (entry.hasPawns)
+	{
+		leadPawn = table.get(0, 0)->pieces[0] ^ flipColor;
+		for (int s = 0; s < 64; s++)
+		{
+			if (tbPieceOn(s) == leadPawn) squares[size++] = s ^ flipSquares;
+		}
+		leadPawnsCount = size;
+
+		std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, [](int a, int b) { return tbMapPawns[a] < tbMapPawns[b]; }));
+		file = std::min(tbFileOf(squares[0]), 7 - tbFileOf(squares[0]));
+	}
+
+	// DTZ tables store one side to move
+	if (dtz && (table.get(0, file)->flags & tbf_stm) != stm && (entry.key != entry.key2 || entry.hasPawns))
+	{
+		state = tb_change_stm;
+		return 0;
+	}
+
+	for (int s = 0; s < 64; s++)
+	{
+		int piece = tbPieceOn(s);
+		if (piece == 0 || (entry.hasPawns && piece == leadPawn)) continue;
+		squares[size] = s ^ flipSquares;
+		pieces[size++] = piece ^ flipColor;
+	}
+
+	TBPairsData* d = table.get(stm, file);
+
+	// Order the pieces like the table
+	for (int i = leadPawnsCount; i < size - 1; i++)
+	{
+		for (int j = i + 1; j < size; j++)
+		{
+			if (d->pieces[i] == pieces[j])
+			{
+				std::swap(pieces[i], pieces[j]);
+				std::swap(squares[i], squares[j]);
+				break;
+			}
+		}
+	}
+
+	// Mirror so the leading piece is on files a-d
+	if (tbFileOf(squares[0]) > 3)
+	{
+		for (int i = 0; i < size; i++) squares[i] ^= 7;
+	}
+
+	U64 idx{ 0 };
+	if (entry.hasPawns)
+	{
+		idx = tbLeadPawnIdx[leadPawnsCount][squares[0]];
+		std::stable_sort(squares + 1, squares + leadPawnsCount, [](int a, int b) { return tbMapPawns[a] < tbMapPawns[b]; });
+		for (int i = 1; i < leadPawnsCount; i++) idx += tbBinomial[i][tbMapPawns[squares[i]]];
+	}
+	else
+	{
+		// Without pawns mirror the leading piece to ranks 1-4 and below the a1-h8 diagonal
+		if (tbRankOf(squares[0]) > 3)
+		{
+			for (int i = 0; i < size; i++) squares[i] ^= 56;
+		}
+		for (int i = 0; i < d->groupLen[0]; i++)
+		{
+			if (tbOffA1H8(squares[i]) == 0) continue;
+			if (tbOffA1H8(squares[i]) > 0)
+			{
+				for (int j = i; j < size; j++) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+			}
+			break;
+		}
+
+		if (entry.hasUniquePieces)
+		{
+			// Three unique pieces (kings included) are encoded together
+			int adjust1 = squares[1] > squares[0];
+			int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+			if (tbOffA1H8(squares[0]) != 0)
+			{
+				idx = ((U64)tbMapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+			}
+			else if (tbOffA1H8(squares[1]) != 0)
+			{
+				idx = (6 * 63 + tbRankOf(squares[0]) * 28 + tbMapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+			}
+			else if (tbOffA1H8(squares[2]) != 0)
+			{
+				idx = 6 * 63 * 62 + 4 * 28 * 62 + tbRankOf(squares[0]) * 7 * 28 + (tbRankOf(squares[1]) - adjust1) * 28 + tbMapB1H1H7[squares[2]];
+			}
+			else
+			{
+				idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + tbRankOf(squares[0]) * 7 * 6 + (tbRankOf(squares[1]) - adjust1) * 6 + (tbRankOf(squares[2]) - adjust2);
+			}
+		}
+		else idx = tbMapKK[tbMapA1D1D4[squares[0]]][squares[1]];
+	}
+
+	// Remaining groups in ascending square order, each square counted down past the squares of earlier groups
+	idx *= d->groupIdx[0];
+	int* groupSquares = squares + d->groupLen[0];
+	bool remainingPawns = entry.hasPawns && entry.pawnCount[1] != 0;
+
+	for (int next = 1; d->groupLen[next] != 0; next++)
+	{
+		std::stable_sort(groupSquares, groupSquares + d->groupLen[next]);
+		U64 n{ 0 };
+		for (int i = 0; i < d->groupLen[next]; i++)
+		{
+			int adjust = (int)std::count_if(squares, groupSquares, [&](int s) { return groupSquares[i] > s; });
+			n += tbBinomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+		}
+		remainingPawns = false;
+		idx += n * d->groupIdx[next];
+		groupSquares += d->groupLen[next];
+	}
+
+	int value = decompressPairs(d, idx);
+	return dtz ? mapDTZScore(table, file, value, wdl) : value - 2;
+}
+
+bool tbIsZeroing(Move m)
+{
+	int flag = getFlag(m);
+	return flag == capture || flag == en_passant_capture || flag >= knight_promo_capture || mainBoard[getFrom(m)] == epc_wpawn || mainBoard[getFrom(m)] == epc_bpawn;
+}
+
+bool tbIsCapture(Move m)
+{
+	int flag = getFlag(m);
+	return flag == capture || flag == en_passant_capture || flag >= knight_promo_capture;
+}
+
+bool tbHasLegalMove(Color c, int ply)
+{
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount;
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	for (int i = 0; i < moveCount; i++)
+	{
+		makeMove(moves[i], c, ply);
+		bool legal = !isKingInCheck(c);
+		unmakeMove(moves[i], c, ply);
+		if (legal) return true;
+	}
+	return false;
+}
+
+// Tables don't store the value when a capture (or with checkZeroing, any zeroing move) wins, so
+// those are searched and the best of them and the table value is the result
+int tbSearch(Color c, int ply, bool checkZeroing, TBProbeState& state)
+{
+	if (ply >= MAX_DEPTH - 1)
+	{
+		state = tb_fail;
+		return tb_draw;
+	}
+
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount;
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	int bestValue = tb_loss;
+	int legalCount{ 0 };
+	int searchedCount{ 0 };
+
+	for (int i = 0; i < moveCount; i++)
+	{
+		bool searchMove = tbIsCapture(moves[i]) || (checkZeroing && tbIsZeroing(moves[i]));
+
+		makeMove(moves[i], c, ply);
+		if (isKingInCheck(c))
+		{
+			unmakeMove(moves[i], c, ply);
+			continue;
+		}
+		legalCount++;
+		if (!searchMove)
+		{
+			unmakeMove(moves[i], c, ply);
+			continue;
+		}
+
+		searchedCount++;
+		int value = -tbSearch((c == white) ? black : white, ply + 1, false, state);
+		unmakeMove(moves[i], c, ply);
+
+		if (state == tb_fail) return tb_draw;
+		if (value > bestValue)
+		{
+			bestValue = value;
+			if (value >= tb_win)
+			{
+				state = tb_zeroing_best_move;
+				return value;
+			}
+		}
+	}
+
+	// If every legal move was searched the table isn't needed (it would be wrong with en passant)
+	bool noMoreMoves = searchedCount != 0 && searchedCount == legalCount;
+	int value = bestValue;
+	if (!noMoreMoves)
+	{
+		value = probeTable(c, false, tb_draw, state);
+		if (state == tb_fail) return tb_draw;
+	}
+
+	if (bestValue >= value)
+	{
+		state = (bestValue > tb_draw || noMoreMoves) ? tb_zeroing_best_move : tb_ok;
+		return bestValue;
+	}
+	state = tb_ok;
+	return value;
+}
+
+// WDL of the current position for c to move
+int probeWDL(Color c, int ply, TBProbeState& state)
+{
+	state = tb_ok;
+	return tbSearch(c, ply, false, state);
+}
+
+int dtzBeforeZeroing(int wdl)
+{
+	return (wdl == tb_win) ? 1 : (wdl == tb_cursed_win) ? 101 : (wdl == tb_blessed_loss) ? -101 : (wdl == tb_loss) ? -1 : 0;
+}
+
+// Plies to the next capture or pawn move with best play, positive when c wins, 0 for draws
+int probeDTZ(Color c, int ply, TBProbeState& state)
+{
+	state = tb_ok;
+	int wdl = tbSearch(c, ply, true, state);
+	if (state == tb_fail || wdl == tb_draw) return 0;
+	if (state == tb_zeroing_best_move) return dtzBeforeZeroing(wdl);
+
+	int dtz = probeTable(c, true, wdl, state);
+	if (state == tb_fail) return 0;
+	if (state != tb_change_stm) return (dtz + 100 * (wdl == tb_blessed_loss || wdl == tb_cursed_win)) * ((wdl > 0) ? 1 : -1);
+
+	// The table is for the other side to move: one ply search for the best dtz
+	Color opp = (c == white) ? black : white;
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount;
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	int minDTZ{ 0xFFFF };
+	for (int i = 0; i < moveCount; i++)
+	{
+		bool zeroing = tbIsZeroing(moves[i]);
+
+		makeMove(moves[i], c, ply);
+		if (isKingInCheck(c))
+		{
+			unmakeMove(moves[i], c, ply);
+			continue;
+		}
+
+		// Zeroing moves count from before the move, the search after it only gives the sign
+		dtz = zeroing ? -dtzBeforeZeroing(tbSearch(opp, ply + 1, false, state)) : -probeDTZ(opp, ply + 1, state);
+
+		if (dtz == 1 && isKingInCheck(opp) && !tbHasLegalMove(opp, ply + 1)) minDTZ = 1; // Mate
+		if (!zeroing) dtz += (dtz > 0) - (dtz < 0);
+		if (dtz < minDTZ && (dtz > 0) == (wdl > 0) && dtz != 0) minDTZ = dtz;
+
+		unmakeMove(moves[i], c, ply);
+		if (state == tb_fail) return 0;
+	}
+
+	return (minDTZ == 0xFFFF) ? -1 : minDTZ;
+}
+
+// A capture or pawn move led to the current position (c to move), the probe is exact only then
+bool lastMoveWasZeroing(Color c)
+{
+	const std::vector<Move>& moveLog = (c == white) ? blackMoveLog : whiteMoveLog;
+	if (moveLog.empty()) return false;
+
+	Move last = moveLog.back();
+	int flag = getFlag(last);
+	return flag == capture || flag == en_passant_capture || flag == double_pawn_push || flag >= knight_promotion
+		|| mainBoard[getTo(last)] == epc_wpawn || mainBoard[getTo(last)] == epc_bpawn;
+}
+
+// UCI SyzygyProbing. The prober hasn't been checked against real tables with tbcheck yet, so loaded
+// tables are only used by the search, the root and match adjudication once this is switched on.
+bool tbProbing{ false };
+
+// Piece count and castling allow probing the current position
+bool canProbeTablebases()
+{
+	int pieceCount = countBits(allPiecesOccupancy);
+	return tbProbing && tbLargest > 0 && pieceCount <= std::min(tbLargest, tbProbeLimit)
+		&& !whiteKingSideCastlingRights && !whiteQueenSideCastlingRights && !blackKingSideCastlingRights && !blackQueenSideCastlingRights;
+}
+
+// Root move from the DTZ tables: the fastest win, else a drawing move, else the longest loss.
+// The engine keeps no fifty move counter, so the root counts as just after a zeroing move.
+// Returns 0 if the tables don't cover the position.
+SearchResult probeRoot(Color c)
+{
+	if (!canProbeTablebases()) return { 0, 0 };
+
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount;
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	Color opp = (c == white) ? black : white;
+	TBProbeState state{ tb_ok };
+	Move bestMove{ 0 };
+	int bestRank{ minScore };
+	int bestDTZ{ 0 };
+
+	for (int i = 0; i < moveCount; i++)
+	{
+		bool zeroing = tbIsZeroing(moves[i]);
+
+		makeMove(moves[i], c, 0);
+		if (isKingInCheck(c))
+		{
+			unmakeMove(moves[i], c, 0);
+			continue;
+		}
+
+		int dtz;
+		if (zeroing) dtz = dtzBeforeZeroing(-probeWDL(opp, 1, state));
+		else
+		{
+			dtz = -probeDTZ(opp, 1, state);
+			dtz += (dtz > 0) - (dtz < 0);
+		}
+		if (dtz == 2 && isKingInCheck(opp) && !tbHasLegalMove(opp, 1)) dtz = 1; // Mate
+
+		unmakeMove(moves[i], c, 0);
+		if (state == tb_fail) return { 0, 0 };
+
+		// Shorter wins and longer losses rank higher
+		int rank = (dtz > 0) ? 1000 - dtz : (dtz < 0) ? -1000 - dtz : 0;
+		if (rank > bestRank)
+		{
+			bestRank = rank;
+			bestMove = moves[i];
+			bestDTZ = dtz;
+		}
+	}
+
+	if (bestMove == 0) return { 0, 0 };
+
+	tbHits++;
+	int score = (bestDTZ > 100) ? 2 : (bestDTZ > 0) ? tbWinScore : (bestDTZ < -100) ? -2 : (bestDTZ < 0) ? -tbWinScore : 0;
+	return { bestMove, score };
+}
+
+// tbcheck <syzygy path> <epd>: probes every position of the EPD file and compares with its "wdl" and
+// "dtz" opcodes, written by a reference prober (tools/syzygy_reference.py). Lines without them print
+// the probed values instead. Returns 1 on any mismatch or failed probe.
+int runTablebaseCheck(const std::vector<std::string>& args)
+{
+	std::ifstream epd((args.size() > 1) ? args[1] : std::string());
+	if (args.size() < 2 || !epd)
+	{
+		std::cout << "usage: tbcheck <syzygy path> <epd>" << "\n";
+		return 1;
+	}
+
+	initTablebases(args[0]);
+	tbProbing = true;
+	if (tbLargest == 0)
+	{
+		std::cout << "No tablebases found in " << args[0] << "\n";
+		return 1;
+	}
+
+	U64 positions{ 0 }, wdlChecked{ 0 }, dtzChecked{ 0 }, wdlMismatches{ 0 }, dtzMismatches{ 0 }, failures{ 0 };
+
+	std::string line;
+	while (std::getline(epd, line))
+	{
+		std::istringstream fields(line);
+		std::string placement, side, castling, enPassant;
+		fields >> placement >> side >> castling >> enPassant;
+		if (placement.empty()) continue;
+		std::string fen = placement + " " + side + " " + castling + " " + enPassant;
+		positions++;
+
+		if (!setPositionFromFen(fen) || !canProbeTablebases())
+		{
+			std::cout << "Not probed: " << fen << "\n";
+			failures++;
+			continue;
+		}
+
+		TBProbeState wdlState{ tb_ok }, dtzState{ tb_ok };
+		int wdl = probeWDL(currentSideToMove, 0, wdlState);
+		int dtz = probeDTZ(currentSideToMove, 0, dtzState);
+
+		size_t wdlPosition = line.find(" wdl ");
+		size_t dtzPosition = line.find(" dtz ");
+		if (wdlPosition == std::string::npos && dtzPosition == std::string::npos)
+		{
+			std::cout << fen << " wdl " << wdl << "; dtz " << dtz << ";" << "\n";
+			continue;
+		}
+
+		if (wdlState == tb_fail || (dtzPosition != std::string::npos && dtzState == tb_fail))
+		{
+			std::cout << "Probe failed: " << fen << "\n";
+			failures++;
+			continue;
+		}
+
+		if (wdlPosition != std::string::npos)
+		{
+			wdlChecked++;
+			int expected = std::atoi(line.c_str() + wdlPosition + 5);
+			if (wdl != expected)
+			{
+				std::cout << "WDL mismatch: " << fen << " wdl " << wdl << ", expected " << expected << "\n";
+				wdlMismatches++;
+			}
+		}
+		if (dtzPosition != std::string::npos)
+		{
+			dtzChecked++;
+			int expected = std::atoi(line.c_str() + dtzPosition + 5);
+			if (dtz != expected)
+			{
+				std::cout << "DTZ mismatch: " << fen << " dtz " << dtz << ", expected " << expected << "\n";
+				dtzMismatches++;
+			}
+		}
+	}
+
+	std::cout << "Positions: " << positions << "\n";
+	std::cout << "WDL checked: " << wdlChecked << ", mismatches: " << wdlMismatches << "\n";
+	std::cout << "DTZ checked: " << dtzChecked << ", mismatches: " << dtzMismatches << "\n";
+	std::cout << "Not probed or failed: " << failures << "\n";
+	return (wdlMismatches + dtzMismatches + failures > 0) ? 1 : 0;
+}
+
+// Search Algorithms
+
+// Mate and tablebase win scores count plies from the root. The table stores them counted from the node,
+// so an entry is right at whatever ply the position is reached again.
+constexpr int ttWinBound = tbWinScore - MAX_DEPTH; // lowest adjusted score
+
+int scoreToTT(int score, int ply)
+{
+	if (score >= ttWinBound) return score + ply;
+	if (score <= -ttWinBound) return score - ply;
+	return score;
+}
+
+int scoreFromTT(int score, int ply)
+{
+	if (score >= ttWinBound) return score - ply;
+	if (score <= -ttWinBound) return score + ply;
+	return score;
+}
+
+thread_local U64 nodeCount{ 0 }; // negaMax and quiescence calls
+thread_local U64 nodeLimit{ 0 }; // go nodes, 0 is no limit
+thread_local bool hasDeadline{ false }; // go movetime
+thread_local std::chrono::steady_clock::time_point searchDeadline;
+thread_local bool searchAborted{ false }; // nodeLimit or the deadline was reached, the scores are meaningless
+
+// Sets searchAborted at the node or time limit. The clock is only read every 1024 nodes.
+inline void checkSearchLimits()
+{
+	if (nodeLimit != 0 && nodeCount >= nodeLimit) searchAborted = true;
+	if (hasDeadline && (nodeCount & 1023) == 0 && std::chrono::steady_clock::now() >= searchDeadline) searchAborted = true;
+}
+
+// Principal variation, pvTable[ply] is the best line found from ply
+thread_local std::array<std::array<Move, MAX_DEPTH>, MAX_DEPTH> pvTable;
+thread_local std::array<int, MAX_DEPTH> pvLength;
+
+// Move left out of the search at this ply, set while a singular extension verifies the table move
+thread_local std::array<Move, MAX_DEPTH> excludedMove;
+
+// Singular extensions: a table move whose stored lower bound is this far above every other move
+// (cp per ply of depth) is searched a ply deeper
+constexpr int singularMinDepth = 4;
+constexpr int singularMargin = 10;
+
+// Razoring: at up to razorDepth plies left, a node whose static evaluation is more than razorMargin per
+// ply below alpha is only searched for captures. ProbCut: from probCutMinDepth plies left, a capture
+// that wins enough material and beats beta + probCutMargin at 4 plies less is taken as a fail high.
+// The margins are the UCI options RazorMargin and ProbCutMargin.
+constexpr int razorDepth = 2;
+constexpr int probCutMinDepth = 5;
+int razorMargin{ 200 };
+int probCutMargin{ 200 };
+
+// Node without a table move, where sortMoves has little to order the quiet moves by: internal iterative
+// deepening first searches it 2 plies shallower for a best move, internal iterative reduction searches
+// it a ply shallower. UCI option IIDMode.
+enum IIDMode {
+	iid_off,
+	iid_deepening,
+	iid_reduction
+};
+
+IIDMode iidMode{ iid_off };
+constexpr int iidMinDepth = 4;
+
+const char* iidModeName(IIDMode mode)
+{
+	return (mode == iid_deepening) ? "IID" : (mode == iid_reduction) ? "IIR" : "Off";
+}
+
+void updatePV(int ply, Move m)
+{
+	pvTable[ply][0] = m;
+	int childLength = (ply + 1 < MAX_DEPTH) ? pvLength[ply + 1] : 0;
+	for (int i = 0; i < childLength && i + 1 < MAX_DEPTH; i++) pvTable[ply][i + 1] = pvTable[ply + 1][i];
+	pvLength[ply] = std::min(childLength + 1, MAX_DEPTH);
+}
+
+// Captures only, from the stand pat score. UseTT probes and stores the transposition table: any stored
+// entry is at least a capture search of the position, results are stored at depth 0 where they don't
+// replace a deeper entry.
+template <Color Us, bool UseTT = true>
+int quiescence(int alpha, int beta, int ply)
+{
+	constexpr Color Them = (Us == white) ? black : white;
+
+	nodeCount++;
+	STAT_INC(qsearchNodes);
+
+	if (ply >= MAX_DEPTH - 1)
+	{
+		int eval = calculateEvaluation(Us);
+		return (Us == white) ? eval : -eval;
+	}
+
+	TTEntry entry = ttRead(positionKey);
+	bool ttHit = UseTT && entry.key == positionKey;
+	Move ttMove = 0;
+	int static_eval{ 0 };
+
+	if (ttHit)
+	{
+		int ttScore = scoreFromTT(entry.score, ply);
+		if (entry.flag == TT_EXACT || (entry.flag == TT_BETA ? ttScore >= beta : ttScore <= alpha))
+		{
+			STAT_INC(qsearchTTCutoffs);
+			return ttScore;
+		}
+		ttMove = entry.bestMove;
+		static_eval = entry.staticEval;
+	}
+	else
+	{
+		static_eval = calculateEvaluation(Us);
+		if (Us == black) static_eval = -static_eval;
+	}
+
+	// Stand Pat
+	int originalAlpha = alpha;
+	int best_value = static_eval;
+	if (best_value >= beta) return best_value;
+	if (best_value + 1000 < alpha) return alpha; // Skip hopeless captures
+	if (best_value > alpha) alpha = best_value;
+
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount = 0;
+	AttackInfo& info = nodeAttackInfo(Us, ply);
+	generateMoves<Us, gen_captures>(info, moves, moveCount);
+
+	// Table move first, only if it was generated here
+	if (ttMove != 0)
+	{
+		auto found = std::find(moves.begin(), moves.begin() + moveCount, ttMove);
+		if (found != moves.begin() + moveCount) std::rotate(moves.begin(), found, found + 1);
+	}
+
+	Move bestMove = 0;
+	for (int i = 0; i < moveCount; i++)
+	{
+		int flag = getFlag(moves[i]);
+		if (flag != capture && flag != en_passant_capture && flag < knight_promo_capture) continue;
+		// ignore non captures
+
+		if (!isLegal(moves[i], info))
+		{
+			STAT_INC(illegalMoves);
+			continue;
+		}
+
+		makeMove<Us>(moves[i], ply);
+		int score = -quiescence<Them, UseTT>(-beta, -alpha, ply + 1);
+		unmakeMove<Us>(moves[i], ply);
+
+		if (score >= beta)
+		{
+			if (UseTT && ttRead(positionKey).depth <= 0) ttStore(positionKey, scoreToTT(score, ply), 0, moves[i], TT_BETA, (int16_t)static_eval);
+			return score;
+		}
+		if (score > best_value)
+		{
+			best_value = score;
+			bestMove = moves[i];
+		}
+		if (score > alpha) alpha = score;
+	}
+
+	if (UseTT && ttRead(positionKey).depth <= 0)
+	{
+		uint8_t ttFlag = (best_value <= originalAlpha) ? TT_ALPHA : TT_EXACT;
+		ttStore(positionKey, scoreToTT(best_value, ply), 0, bestMove, ttFlag, (int16_t)static_eval);
+	}
+	return best_value;
+}
+
+template <Color Us>
+SearchResult negaMax(int alpha, int beta, int depthLeft, int ply)
+{
+	constexpr Color Them = (Us == white) ? black : white;
+
+	nodeCount++;
+	STAT_INC(interiorNodes);
+	pvLength[ply] = 0;
+
+	checkSearchLimits();
+	if (searchAborted) return { 0, 0 };
+
+	// Mate distance pruning: nothing here scores better than mating at the next ply or worse than being mated now
+	if (ply > 0)
+	{
+		alpha = std::max(alpha, checkmateScore + ply);
+		beta = std::min(beta, -checkmateScore - ply - 1);
+		if (alpha >= beta) return { 0, alpha };
+	}
+
+	std::vector<Move> moveLog = (Us == white) ? whiteMoveLog : blackMoveLog;
+	int originalAlpha = alpha;
+	TTEntry entry = ttRead(positionKey);
+	Move excluded = excludedMove[ply]; // the entry belongs to the search without it
+
+	STAT_INC(ttProbes);
+	if (entry.key == positionKey) STAT_INC(ttHits);
+
+	if (excluded == 0 && entry.key == positionKey && entry.depth >= depthLeft)
+	{
+		int ttScore = scoreFromTT(entry.score, ply);
+		if (entry.flag == TT_EXACT)
+		{
+			STAT_INC(ttExactCutoffs);
+			return { entry.bestMove, ttScore };
+		}
+		else if (entry.flag == TT_ALPHA && ttScore <= alpha)
+		{
+			//position is bad
+			STAT_INC(ttAlphaCutoffs);
+			return { entry.bestMove, alpha };
+		}
+		else if (entry.flag == TT_BETA && ttScore >= beta)
+		{
+			//position is good (cutoff)
+			STAT_INC(ttBetaCutoffs);
+			return { entry.bestMove, beta };
+		}
+	}
+
+	if (depthLeft == 0)
+	{
+		//int evaluation = calculateEvaluation(Us);
+		//return { 0, (Us == white) ? evaluation : -evaluation; }
+		return { 0, quiescence<Us>(alpha, beta, ply) };
+	}
+
+	// Tablebase probe, wins and losses are bounds and draws exact (cursed wins and blessed losses 2 from 0)
+	if (ply > 0 && excluded == 0 && canProbeTablebases() && lastMoveWasZeroing(Us))
+	{
+		TBProbeState state;
+		int wdl = probeWDL(Us, ply, state);
+		if (state != tb_fail)
+		{
+			tbHits++;
+			int value = (wdl == tb_loss) ? -tbWinScore + ply : (wdl == tb_win) ? tbWinScore - ply : 2 * wdl;
+			uint8_t tbFlag = (wdl == tb_loss) ? TT_ALPHA : (wdl == tb_win) ? TT_BETA : TT_EXACT;
+
+			if (tbFlag == TT_EXACT || (tbFlag == TT_BETA ? value >= beta : value <= alpha))
+			{
+				int tbStaticEval = calculateEvaluation(Us);
+				if (Us == black) tbStaticEval = -tbStaticEval;
+				ttStore(positionKey, scoreToTT(value, ply), std::min(depthLeft + 6, MAX_DEPTH - 1), 0, tbFlag, (int16_t)tbStaticEval);
+				return { 0, value };
+			}
+		}
+	}
+
+	// Static evaluation, reused from the table if this position was stored before
+	int staticEval{ 0 };
+	if (entry.key == positionKey) staticEval = entry.staticEval;
+	else
+	{
+		staticEval = calculateEvaluation(Us);
+		if (Us == black) staticEval = -staticEval;
+	}
+
+	AttackInfo& info = nodeAttackInfo(Us, ply);
+	bool inCheck = info.checkers != 0;
+
+	if (ply > 0 && excluded == 0 && !inCheck && depthLeft <= razorDepth && std::abs(alpha) < ttWinBound
+		&& staticEval + razorMargin * depthLeft < alpha)
+	{
+		int value = quiescence<Us>(alpha - 1, alpha, ply);
+		if (value < alpha)
+		{
+			STAT_INC(razorCuts);
+			return { 0, value };
+		}
+	}
+
+	entry = ttRead(positionKey); // the razoring search may have stored this position
+
+	int probCutBeta = beta + probCutMargin;
+	if (ply > 0 && excluded == 0 && !inCheck && depthLeft >= probCutMinDepth && std::abs(beta) < ttWinBound
+		&& !(entry.key == positionKey && entry.depth >= depthLeft - 3 && scoreFromTT(entry.score, ply) < probCutBeta))
+	{
+		std::array<Move, MAX_MOVES> captures;
+		int captureCount{ 0 };
+		generateMoves<Us, gen_captures>(info, captures, captureCount);
+		sortMoves(Us, captures, captureCount);
+
+		for (int i = 0; i < captureCount; i++)
+		{
+			int flag = getFlag(captures[i]);
+			if (flag != capture && flag != en_passant_capture && flag < knight_promo_capture) continue;
+			if (!isLegal(captures[i], info) || staticExchange(captures[i]) < probCutBeta - staticEval) continue;
+
+			// Captures confirm cheaply first, the reduced search only runs on those that hold
+			makeMove<Us>(captures[i], ply);
+			int value = -quiescence<Them>(-probCutBeta, -probCutBeta + 1, ply + 1);
+			if (value >= probCutBeta) value = -negaMax<Them>(-probCutBeta, -probCutBeta + 1, depthLeft - 4, ply + 1).score;
+			unmakeMove<Us>(captures[i], ply);
+			if (searchAborted) return { 0, 0 };
+
+			if (value >= probCutBeta)
+			{
+				STAT_INC(probCuts);
+				ttStore(positionKey, scoreToTT(value, ply), depthLeft - 3, captures[i], TT_BETA, (int16_t)staticEval);
+				return { captures[i], value };
+			}
+		}
+	}
+
+	int bestValue = minScore;
+	Move bestMove = 0;
+	bool hasLegalMoves{ false };
+	int movesSearched{ 0 };
+
+	Move iidMove = 0;
+	if (ply > 0 && excluded == 0 && depthLeft >= iidMinDepth && (entry.key != positionKey || entry.bestMove == 0))
+	{
+		if (iidMode == iid_reduction)
+		{
+			STAT_INC(iidNodes);
+			depthLeft--;
+		}
+		else if (iidMode == iid_deepening)
+		{
+			STAT_INC(iidNodes);
+			iidMove = negaMax<Us>(alpha, beta, depthLeft - 2, ply).move;
+			pvLength[ply] = 0;
+			if (searchAborted) return { 0, 0 };
+		}
+	}
+
+	// Singular extension: search the other moves at half depth against a bound below the table score.
+	// If they all fail low the table move is the only good one and gets an extra ply. If one fails high
+	// while the table move is at least beta too, two moves refute the parent: multi-cut.
+	int ttMoveExtension{ 0 };
+	entry = ttRead(positionKey); // the internal iterative deepening search may have stored this position
+	int ttScore = scoreFromTT(entry.score, ply);
+	if (ply > 0 && excluded == 0 && depthLeft >= singularMinDepth && ply + depthLeft < MAX_DEPTH - 4
+		&& entry.key == positionKey && entry.bestMove != 0 && entry.flag != TT_ALPHA && entry.depth >= depthLeft - 3
+		&& std::abs(ttScore) < ttWinBound)
+	{
+		int singularBeta = ttScore - singularMargin * depthLeft;
+		Move singularMove = entry.bestMove;
+		excludedMove[ply] = singularMove;
+		int value = negaMax<Us>(singularBeta - 1, singularBeta, (depthLeft - 1) / 2, ply).score;
+		excludedMove[ply] = 0;
+		pvLength[ply] = 0;
+		if (searchAborted) return { 0, 0 };
+
+		if (value < singularBeta)
+		{
+			STAT_INC(singularExtensions);
+			ttMoveExtension = 1;
+		}
+		else if (value >= beta && ttScore >= beta)
+		{
+			STAT_INC(multiCuts);
+			return { singularMove, value };
+		}
+	}
+
+	generateMoves<Us, gen_all>(info, moveStack[ply], moveCountStack[ply]); // get pseudo legal moves
+	sortMoves(Us, moveStack[ply], moveCountStack[ply]);
+
+	// Search stored tt table move from invalid score
+	Move ttMove = iidMove;
+	if (ttMove == 0 && entry.key == positionKey && entry.bestMove != excluded) ttMove = entry.bestMove;
+
+	// The entry may be a key collision or written by another thread, only play moves generated here
+	if (ttMove != 0 && std::find(moveStack[ply].begin(), moveStack[ply].begin() + moveCountStack[ply], ttMove) == moveStack[ply].begin() + moveCountStack[ply]) ttMove = 0;
+
+	if (ttMove != 0)
+	{
+		if (isLegal(ttMove, info))
+		{
+			makeMove<Us>(ttMove, ply);
+			hasLegalMoves = true;
+			movesSearched++;
+			SearchResult result = negaMax<Them>(-beta, -alpha, depthLeft - 1 + ttMoveExtension, ply + 1);
+			int score = -result.score;
+			if (searchAborted)
+			{
+				unmakeMove<Us>(ttMove, ply);
+				return { 0, 0 };
+			}
+
+			if (score > bestValue)
+			{
+				bestValue = score;
+				bestMove = ttMove;
+				if (score > alpha)
+				{
+					alpha = score;
+					updatePV(ply, ttMove);
+				}
+			}
+			if (score >= beta)
+			{
+				STAT_INC(betaCutoffs);
+				STAT_INC(firstMoveCutoffs);
+				unmakeMove<Us>(ttMove, ply);
+				if (excluded == 0) ttStore(positionKey, scoreToTT(bestValue, ply), depthLeft, bestMove, TT_BETA, (int16_t)staticEval);
+				return { bestMove, bestValue };
+			}
+
+			unmakeMove<Us>(ttMove, ply);
+		}
+		else STAT_INC(illegalMoves);
+	}
+
+	// Search rest of moves
+	for (int i = 0; i < moveCountStack[ply]; i++)
+	{
+		if (moveLog.size() > 4 && (moveStack[ply][i] == moveLog[moveLog.size() - 2] || moveStack[ply][i] == moveLog[moveLog.size() - 4])) continue; // Avoid 3 fold;
+		if (moveStack[ply][i] == ttMove || moveStack[ply][i] == excluded) continue;
+
+		if (!isLegal(moveStack[ply][i], info))
+		{
+			STAT_INC(illegalMoves);
+			continue;
+		}
+
+		makeMove<Us>(moveStack[ply][i], ply);
+		//printMainboard();
+		hasLegalMoves = true; // Found legal move
+		movesSearched++;
+
+		SearchResult result = negaMax<Them>(-beta, -alpha, depthLeft - 1, ply + 1);
+		int score = -result.score;
+		if (searchAborted)
+		{
+			unmakeMove<Us>(moveStack[ply][i], ply);
+			return { 0, 0 };
+		}
+		if (score > bestValue)
+		{
+			bestValue = score;
+			bestMove = moveStack[ply][i];
+			if (score > alpha)
+			{
+				alpha = score;
+				updatePV(ply, moveStack[ply][i]);
+			}
+		}
+		if (score >= beta)
+		{
+			STAT_INC(betaCutoffs);
+			if (movesSearched == 1) STAT_INC(firstMoveCutoffs);
+			unmakeMove<Us>(moveStack[ply][i], ply);
+			if (excluded == 0) ttStore(positionKey, scoreToTT(score, ply), depthLeft, bestMove, TT_BETA, (int16_t)staticEval);
+			return { bestMove, score };
+		}
+		unmakeMove<Us>(moveStack[ply][i], ply);
+		//printMainboard();
+	}
+
+	if (excluded != 0)
+	{
+		return { bestMove, hasLegalMoves ? bestValue : alpha }; // only the excluded move, it is singular
+	}
+
+	if (!hasLegalMoves) bestValue = inCheck ? checkmateScore + ply : 0; // Checkmate or stalemate
+
+	uint8_t ttFlag;
+	if (!hasLegalMoves)
+	{
+		ttFlag = TT_EXACT;
+	}
+	else if (bestValue <= originalAlpha)
+	{
+		ttFlag = TT_ALPHA;
+	}
+	else if (bestValue >= beta)
+	{
+		ttFlag = TT_BETA;
+	}
+	else
+	{
+		ttFlag = TT_EXACT;
+	}
+	ttStore(positionKey, scoreToTT(bestValue, ply), depthLeft, bestMove, ttFlag, (int16_t)staticEval);
+
+	return { bestMove, bestValue };
+}
+
+// Search for a side known at run time. Without the table the score is the capture search of this
+// position alone, not a stored deeper result.
+int quiescence(Color c, int alpha, int beta, int ply, bool useTT = true)
+{
+	if (!useTT) return (c == white) ? quiescence<white, false>(alpha, beta, ply) : quiescence<black, false>(alpha, beta, ply);
+	return (c == white) ? quiescence<white>(alpha, beta, ply) : quiescence<black>(alpha, beta, ply);
+}
+
+SearchResult negaMax(Color c, int alpha, int beta, int depthLeft, int ply)
+{
+	return (c == white) ? negaMax<white>(alpha, beta, depthLeft, ply) : negaMax<black>(alpha, beta, depthLeft, ply);
+}
+
+// Move in UCI notation (e.g. e2e4, e7e8q)
+std::string moveToString(Move m)
+{
+	// Format move
+	std::string moveStr = squareToString(getFrom(m)) + squareToString(getTo(m));
+
+	// Add promotion piece if needed
+	int flag = getFlag(m);
+	if (flag >= knight_promotion && flag <= queen_promo_capture)
+	{
+		if (flag == queen_promotion || flag == queen_promo_capture) moveStr += "q";
+		else if (flag == rook_promotion || flag == rook_promo_capture) moveStr += "r";
+		else if (flag == bishop_promotion || flag == bishop_promo_capture) moveStr += "b";
+		else if (flag == knight_promotion || flag == knight_promo_capture) moveStr += "n";
+	}
+
+	return moveStr;
+}
+
+// UCI score from the side to move: "mate N" in moves (negative when it is mated), else "cp N"
+std::string uciScore(int score)
+{
+	if (std::abs(score) >= -checkmateScore - MAX_DEPTH && std::abs(score) <= -checkmateScore)
+	{
+		int moves = (score > 0) ? (-checkmateScore - score + 1) / 2 : -(score - checkmateScore) / 2;
+		return "mate " + std::to_string(moves);
+	}
+	return "cp " + std::to_string(score);
+}
+
+/* --- Mate search --- */
+
+// Attacker positions with no mate in the stored plies. Lossy like the evaluation cache, one U64 per entry:
+// the upper 48 bits of the position key and the plies. The lower 16 bits of the key are implied by the index.
+constexpr int MATE_FAILURE_SIZE = 65536; // 2^16
+thread_local std::array<U64, MATE_FAILURE_SIZE> mateFailures;
+
+// Proof search for go mate: the attacker only plays checks and the defender, always in check, every
+// evasion. A defender reply that escapes ends the line at once, there are no scores to compare.
+
+template <Color Us, bool Attacker>
+bool mateSearch(int pliesLeft, int ply)
+{
+	constexpr Color Them = (Us == white) ? black : white;
+
+	nodeCount++;
+	pvLength[ply] = 0;
+
+	checkSearchLimits();
+	if (searchAborted || ply >= MAX_DEPTH - 1) return false;
+
+	AttackInfo& info = nodeAttackInfo(Us, ply);
+	std::array<Move, MAX_MOVES>& moves = moveStack[ply];
+	int& moveCount = moveCountStack[ply];
+
+	if constexpr (Attacker)
+	{
+		U64 failure = mateFailures[positionKey % MATE_FAILURE_SIZE];
+		if (((failure ^ positionKey) >> 16) == 0 && (int)(failure & 0xFFFF) >= pliesLeft) return false;
+
+		if (info.checkers != 0) generateMoves<Us, gen_evasions>(info, moves, moveCount);
+		else generateMoves<Us, gen_checks>(info, moves, moveCount);
+		sortMoves(Us, moves, moveCount);
+
+		for (int i = 0; i < moveCount; i++)
+		{
+			if (!isLegal(moves[i], info)) continue;
+
+			makeMove<Us>(moves[i], ply);
+			bool mate = isKingInCheck(Them) && mateSearch<Them, false>(pliesLeft - 1, ply + 1);
+			unmakeMove<Us>(moves[i], ply);
+
+			if (mate)
+			{
+				updatePV(ply, moves[i]);
+				return true;
+			}
+		}
+
+		if (!searchAborted && pliesLeft >= 3) mateFailures[positionKey % MATE_FAILURE_SIZE] = (positionKey & ~0xFFFFULL) | (U64)pliesLeft; // the last plies are cheaper than the lookup
+		return false;
+	}
+	else
+	{
+		generateMoves<Us, gen_evasions>(info, moves, moveCount);
+
+		for (int i = 0; i < moveCount; i++)
+		{
+			if (!isLegal(moves[i], info)) continue;
+			if (pliesLeft == 0) return false; // not mated
+
+			makeMove<Us>(moves[i], ply);
+			bool mated = mateSearch<Them, true>(pliesLeft - 1, ply + 1);
+			unmakeMove<Us>(moves[i], ply);
+
+			if (!mated) return false;
+			updatePV(ply, moves[i]);
+		}
+		return true; // every evasion is mated, or there is none
+	}
+}
+
+// Shortest mate of c in at most mateMoves moves, { 0, 0 } if there is none (or the node limit was hit).
+// Prints an info line for the mate found.
+SearchResult searchMate(Color c, int mateMoves, bool printInfo)
+{
+	auto start = std::chrono::steady_clock::now();
+	mateFailures.fill(0);
+	searchAborted = false;
+
+	for (int moves = 1; moves <= mateMoves && 2 * moves - 1 < MAX_DEPTH - 1; moves++)
+	{
+		int plies = 2 * moves - 1;
+		bool found = (c == white) ? mateSearch<white, true>(plies, 0) : mateSearch<black, true>(plies, 0);
+		if (searchAborted) break;
+		if (!found) continue;
+
+		int score = -checkmateScore - plies;
+		if (printInfo)
+		{
+			auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "info depth " << plies << " score " << uciScore(score) << " nodes " << nodeCount
+				<< " nps " << ((elapsed > 0) ? nodeCount * 1000 / elapsed : nodeCount) << " time " << elapsed << " pv";
+			for (int i = 0; i < pvLength[0]; i++) std::cout << " " << moveToString(pvTable[0][i]);
+			std::cout << "\n";
+		}
+		return { pvTable[0][0], score };
+	}
+	return { 0, 0 };
+}
+
+/* --- Root search --- */
+
+int multiPV{ 1 }; // UCI MultiPV, number of best lines to report
+
+// Root moves keep their score, nodes and line between iterations and are searched best first
+struct RootMove {
+	Move move{ 0 };
+	int score{ minScore }; // minScore if it didn't raise alpha in the last pass
+	int previousScore{ minScore }; // score of the previous iteration, orders moves with equal score
+	U64 nodes{ 0 };
+	std::vector<Move> pv;
+};
+
+// Iterative deepening up to searchDepth. For every line (MultiPV) the root moves that weren't picked
+// by an earlier line are searched and the best becomes that line. Prints info lines after every depth
+// if printInfo is set. rootMoves is left sorted, best line first.
+SearchResult searchRoot(Color c, int searchDepth, std::vector<RootMove>& rootMoves, bool printInfo)
+{
+	auto start = std::chrono::steady_clock::now();
+	Color opp = (c == white) ? black : white;
+	std::vector<Move> moveLog = (c == white) ? whiteMoveLog : blackMoveLog;
+	searchAborted = false;
+
+	rootMoves.clear();
+	std::vector<RootMove> repeatingMoves;
+	getPseudoLegalMoves(c, moveStack[0], moveCountStack[0]);
+	sortMoves(c, moveStack[0], moveCountStack[0]);
+
+	for (int i = 0; i < moveCountStack[0]; i++)
+	{
+		Move m = moveStack[0][i];
+		bool repeating = moveLog.size() > 4 && (m == moveLog[moveLog.size() - 2] || m == moveLog[moveLog.size() - 4]); // Avoid 3 fold, like negaMax
+
+		makeMove(m, c, 0);
+		if (!isKingInCheck(c))
+		{
+			RootMove rootMove;
+			rootMove.move = m;
+			(repeating ? repeatingMoves : rootMoves).push_back(rootMove);
+		}
+		unmakeMove(m, c, 0);
+	}
+	if (rootMoves.empty()) rootMoves = repeatingMoves; // A repetition is still better than no move
+
+	if (rootMoves.empty())
+	{
+		SearchResult result = negaMax(c, minScore, maxScore, searchDepth, 0); // Mate or stalemate
+		if (printInfo) std::cout << "info depth " << searchDepth << " score " << uciScore(result.score) << " nodes " << nodeCount << "\n";
+		return result;
+	}
+
+	int lines = std::min((int)rootMoves.size(), std::max(1, multiPV));
+	U64 limit = nodeLimit;
+	bool deadline = hasDeadline;
+
+	for (int currentDepth = 1; currentDepth <= searchDepth; currentDepth++)
+	{
+		// An iteration stopped by the node or time limit is thrown away, depth 1 always completes
+		std::vector<RootMove> completed;
+		if (limit != 0 || deadline) completed = rootMoves;
+		nodeLimit = (currentDepth == 1) ? 0 : limit;
+		hasDeadline = (currentDepth == 1) ? false : deadline;
+
+		for (RootMove& rootMove : rootMoves)
+		{
+			rootMove.previousScore = rootMove.score;
+		}
+
+		for (int line = 0; line < lines; line++)
+		{
+			int alpha = minScore;
+
+			for (size_t i = line; i < rootMoves.size(); i++)
+			{
+				RootMove& rootMove = rootMoves[i];
+				U64 nodesBefore = nodeCount;
+
+				makeMove(rootMove.move, c, 0);
+				int score = -negaMax(opp, -maxScore, -alpha, currentDepth - 1, 1).score;
+				unmakeMove(rootMove.move, c, 0);
+				if (searchAborted) break;
+
+				rootMove.nodes += nodeCount - nodesBefore;
+				rootMove.score = minScore;
+				if (score > alpha)
+				{
+					alpha = score;
+					rootMove.score = score;
+					rootMove.pv.assign(1, rootMove.move);
+					rootMove.pv.insert(rootMove.pv.end(), pvTable[1].begin(), pvTable[1].begin() + pvLength[1]);
+				}
+			}
+
+			if (searchAborted) break;
+
+			// Best of the pass first, the rest in the order of their last scores
+			std::stable_sort(rootMoves.begin() + line, rootMoves.end(), [](const RootMove& a, const RootMove& b)
+			{
+				return (a.score != b.score) ? a.score > b.score : a.previousScore > b.previousScore;
+			});
+
+			if (line == 0)
+			{
+				int staticEval = calculateEvaluation(c);
+				if (c == black) staticEval = -staticEval;
+				ttStore(positionKey, rootMoves[0].score, currentDepth, rootMoves[0].move, TT_EXACT, (int16_t)staticEval);
+			}
+		}
+
+		if (searchAborted)
+		{
+			rootMoves = completed;
+			break;
+		}
+		if (!printInfo) continue;
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		for (int line = 0; line < lines; line++)
+		{
+			std::cout << "info depth " << currentDepth << " multipv " << line + 1 << " score " << uciScore(rootMoves[line].score)
+				<< " nodes " << nodeCount << " nps " << ((elapsed > 0) ? nodeCount * 1000 / elapsed : nodeCount)
+				<< " tbhits " << tbHits << " time " << elapsed << " pv";
+			for (Move m : rootMoves[line].pv) std::cout << " " << moveToString(m);
+			std::cout << "\n";
+		}
+	}
+
+	nodeLimit = limit;
+	hasDeadline = deadline;
+
+	if (printInfo && debugMode)
+	{
+		for (const RootMove& rootMove : rootMoves)
+		{
+			std::cout << "info string root " << moveToString(rootMove.move) << " nodes " << rootMove.nodes << "\n";
+		}
+	}
+
+	return { rootMoves[0].move, rootMoves[0].score };
+}
+
+/*
+--------------------
+
+PERFT
+
+--------------------
+*/
+
+// Counts the leaf nodes of the legal move tree, used to verify move generation
+U64 perft(Color c, int depthLeft, int ply)
+{
+	if (depthLeft == 0) return 1ULL;
+
+	getPseudoLegalMoves(c, moveStack[ply], moveCountStack[ply]);
+
+	U64 nodes{ 0 };
+	for (int i = 0; i < moveCountStack[ply]; i++)
+	{
+		makeMove(moveStack[ply][i], c, ply);
+		if (!isKingInCheck(c)) nodes += perft((c == white) ? black : white, depthLeft - 1, ply + 1);
+		unmakeMove(moveStack[ply][i], c, ply);
+	}
+
+	return nodes;
+}
+
+// Perft of the current position, printing the count of every root move
+U64 perftDivide(int perftDepth)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	Color c = currentSideToMove;
+	std::array<Move, MAX_MOVES> moveList;
+	int moveCount;
+	getPseudoLegalMoves(c, moveList, moveCount);
+
+	U64 nodes{ 0 };
+	for (int i = 0; i < moveCount; i++)
+	{
+		makeMove(moveList[i], c, 0);
+		if (!isKingInCheck(c))
+		{
+			U64 moveNodes = (perftDepth > 1) ? perft((c == white) ? black : white, perftDepth - 1, 1) : 1ULL;
+			std::cout << moveToString(moveList[i]) << ": " << moveNodes << "\n";
+			nodes += moveNodes;
+		}
+		unmakeMove(moveList[i], c, 0);
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "\nNodes searched: " << nodes << "\n";
+	std::cout << "Time (ms): " << elapsed << "\n";
+	std::cout << "Nodes/second: " << ((elapsed > 0) ? nodes * 1000 / elapsed : nodes) << "\n";
+
+	return nodes;
+}
+
+/*
+--------------------
+
+BENCH
+
+--------------------
+*/
+
+// Fixed search workload for comparing builds and training PGO. With one thread the total node count is
+// a signature of the search: it only changes when search behaviour changes. The search itself is single
+// threaded, more threads search different positions at the same time (sharing the table).
+const std::vector<std::string> benchPositions = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+	"4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+	"rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+	"r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+	"r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+	"r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+	"r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+	"4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+	"2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+	"r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+	"3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+	"r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+	"4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+	"3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+	"6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+	"3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+	"2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+	"8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+	"7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+	"8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+	"8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+	"8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+	"8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+	"5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+	"6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+	"1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+	"6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+	"8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+	"5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+	"4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+	"r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+	"3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+	"4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+
+	// Few pieces
+	"8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+	"8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+	"8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+	"8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+	"8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+	"8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+	"8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+
+	// Mating attacks, stalemates
+	"6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+	"r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+	"8/8/8/8/8/6k1/6p1/6K1 w - - 0 1",
+	"7k/7P/6K1/8/3B4/8/8/8 b - - 0 1"
+};
+
+// bench [depth] [threads] [hash MB] [json] [iid|iir|noiid]
+U64 runBench(int benchDepth, int threadCount, int hashMegabytes, bool json)
+{
+	if (threadCount < 1) threadCount = 1;
+
+	U64 previousTTSize = ttSize;
+	setHashSize(hashMegabytes);
+
+	std::vector<U64> positionNodes(benchPositions.size(), 0);
+#ifdef SEARCH_STATS
+	std::vector<SearchStats> threadStats(threadCount);
+#endif
+
+	auto start = std::chrono::steady_clock::now();
+
+	// All positions are searched on new threads, even with one thread: the board and the search tables
+	// are thread_local, so the caller keeps its position (UCI bench) and every run starts from the same state
+	auto benchThread = [&](int thread)
+	{
+#ifdef SEARCH_STATS
+		searchStats = SearchStats{};
+#endif
+		for (size_t i = thread; i < benchPositions.size(); i += threadCount)
+		{
+			setPositionFromFen(benchPositions[i]);
+			nodeCount = 0;
+			negaMax(currentSideToMove, minScore, maxScore, benchDepth, 0);
+			positionNodes[i] = nodeCount;
+		}
+#ifdef SEARCH_STATS
+		threadStats[thread] = searchStats;
+#endif
+	};
+	std::vector<std::thread> workers;
+	for (int thread = 0; thread < threadCount; thread++) workers.emplace_back(benchThread, thread);
+	for (std::thread& worker : workers) worker.join();
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef SEARCH_STATS
+	lastSearchStats = SearchStats{};
+	for (const SearchStats& stats : threadStats) lastSearchStats.add(stats);
+	lastSearchTime = elapsed * threadCount; // the time split is over all threads
+#endif
+
+	U64 totalNodes{ 0 };
+	for (U64 nodes : positionNodes) totalNodes += nodes;
+	U64 nps = (elapsed > 0) ? totalNodes * 1000 / elapsed : totalNodes;
+
+	if (json)
+	{
+		std::cout << "{\"depth\": " << benchDepth << ", \"threads\": " << threadCount << ", \"hash\": " << hashMegabytes
+			<< ", \"positions\": " << benchPositions.size() << ", \"nodes\": " << totalNodes << ", \"time_ms\": " << elapsed
+			<< ", \"nps\": " << nps << ", \"iid\": \"" << iidModeName(iidMode) << "\", \"position_nodes\": [";
+		for (size_t i = 0; i < positionNodes.size(); i++) std::cout << ((i > 0) ? ", " : "") << positionNodes[i];
+		std::cout << "]}" << "\n";
+	}
+	else
+	{
+		for (size_t i = 0; i < positionNodes.size(); i++)
+		{
+			std::cout << "Position " << i + 1 << "/" << benchPositions.size() << ": " << positionNodes[i] << "\n";
+		}
+		std::cout << "\n";
+		std::cout << "Nodes searched: " << totalNodes << "\n";
+		std::cout << "Time (ms): " << elapsed << "\n";
+		std::cout << "Nodes/second: " << nps << "\n";
+		std::cout << "Hash: " << hashMegabytes << " MB, " << ttPages << "\n";
+		std::cout << "Slider attacks: " << sliderFillKernel() << "\n";
+		std::cout << "Internal iterative: " << iidModeName(iidMode) << "\n";
+	}
+
+#ifdef SEARCH_STATS
+	if (json) printSearchStatsJson(lastSearchStats, lastSearchTime);
+	else printSearchStats(lastSearchStats, lastSearchTime);
+#endif
+
+	// Restore the UCI hash size
+	if (ttSize != previousTTSize) allocateTranspositionTable(previousTTSize);
+	else clearTranspositionTable();
+
+	return totalNodes;
+}
+
+// Parses "bench [depth] [threads] [hash] [json] [iid|iir|noiid]" arguments, the IID mode only applies to this run
+U64 runBench(const std::vector<std::string>& args)
+{
+	IIDMode previousIIDMode = iidMode;
+
+	int benchDepth{ 3 };
+	int threadCount{ 1 };
+	int hashMegabytes{ 16 };
+	bool json{ false };
+
+	int position{ 0 };
+	for (const std::string& arg : args)
+	{
+		if (arg == "json") json = true;
+		else if (arg == "iid") iidMode = iid_deepening;
+		else if (arg == "iir") iidMode = iid_reduction;
+		else if (arg == "noiid") iidMode = iid_off;
+		else if (position == 0) { benchDepth = std::atoi(arg.c_str()); position++; }
+		else if (position == 1) { threadCount = std::atoi(arg.c_str()); position++; }
+		else if (position == 2) { hashMegabytes = std::atoi(arg.c_str()); position++; }
+	}
+
+	U64 nodes = runBench(benchDepth, threadCount, hashMegabytes, json);
+	iidMode = previousIIDMode;
+	return nodes;
+}
+
+/*
+--------------------
+
+BATCH ANALYSIS
+
+--------------------
+*/
+
+// Escapes a string for a JSON value
+std::string jsonEscape(const std::string& text)
+{
+	std::string escaped;
+	for (char ch : text)
+	{
+		if (ch == '"' || ch == '\\') escaped += '\\';
+		if ((unsigned char)ch >= 0x20) escaped += ch;
+	}
+	return escaped;
+}
+
+// analyse --epd <file> [--depth N] [--threads T] [--hash MB] [--out <file>]
+// Searches every EPD (or FEN) line of the file to a fixed depth and writes one JSON object per line
+// in input order: id, fen, best move, score, PV and nodes. Every worker thread searches its own
+// positions single threaded, the transposition table is shared.
+int runAnalyse(const std::vector<std::string>& args)
+{
+	std::string epdName, outName;
+	int analyseDepth{ depth };
+	int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	int hashMegabytes{ 256 };
+
+	for (size_t i = 0; i + 1 < args.size(); i += 2)
+	{
+		if (args[i] == "--epd") epdName = args[i + 1];
+		else if (args[i] == "--out") outName = args[i + 1];
+		else if (args[i] == "--depth") analyseDepth = std::atoi(args[i + 1].c_str());
+		else if (args[i] == "--threads") threadCount = std::atoi(args[i + 1].c_str());
+		else if (args[i] == "--hash") hashMegabytes = std::atoi(args[i + 1].c_str());
+	}
+
+	std::ifstream epd(epdName);
+	if (epdName.empty() || !epd)
+	{
+		std::cout << "usage: analyse --epd <file> [--depth N] [--threads T] [--hash MB] [--out <file>]" << "\n";
+		return 1;
+	}
+	std::ofstream outFile;
+	if (!outName.empty()) outFile.open(outName);
+	std::ostream& out = outName.empty() ? std::cout : outFile;
+
+	analyseDepth = std::clamp(analyseDepth, 1, MAX_DEPTH / 2);
+	threadCount = std::max(1, threadCount);
+	setHashSize(std::max(1, hashMegabytes));
+
+	std::mutex inputMutex, outputMutex;
+	U64 nextIndex{ 0 };
+	U64 nextOutput{ 0 };
+	std::map<U64, std::string> pendingOutput; // Finished out of order
+	U64 totalNodes{ 0 };
+
+	auto start = std::chrono::steady_clock::now();
+
+	runOnThreads(threadCount, [&](int)
+	{
+		std::string line;
+		while (true)
+		{
+			U64 index;
+			{
+				std::lock_guard<std::mutex> lock(inputMutex);
+				if (!std::getline(epd, line)) break;
+				index = nextIndex++;
+			}
+
+			// The first four fields are the position, EPD operations follow
+			std::istringstream fields(line);
+			std::string placement, side, castling, enPassant;
+			fields >> placement >> side >> castling >> enPassant;
+			std::string fen = placement + " " + side + " " + castling + " " + enPassant;
+
+			std::string id;
+			size_t idPosition = line.find("id \"");
+			if (idPosition != std::string::npos) id = line.substr(idPosition + 4, line.find('"', idPosition + 4) - idPosition - 4);
+
+			std::ostringstream json;
+			json << "{\"index\": " << index << ", \"id\": \"" << jsonEscape(id) << "\", \"fen\": \"" << jsonEscape(fen) << "\"";
+
+			U64 nodes{ 0 };
+			if (placement.empty() || !setPositionFromFen(fen))
+			{
+				json << ", \"error\": \"bad position\"}";
+			}
+			else
+			{
+				nodeCount = 0;
+				std::vector<RootMove> rootMoves;
+				SearchResult result = searchRoot(currentSideToMove, analyseDepth, rootMoves, false);
+				nodes = nodeCount;
+
+				json << ", \"depth\": " << analyseDepth << ", \"bestmove\": \"" << ((result.move != 0) ? moveToString(result.move) : "(none)")
+					<< "\", \"score\": " << result.score << ", \"pv\": [";
+				if (!rootMoves.empty())
+				{
+					for (size_t i = 0; i < rootMoves[0].pv.size(); i++) json << ((i > 0) ? ", " : "") << "\"" << moveToString(rootMoves[0].pv[i]) << "\"";
+				}
+				json << "], \"nodes\": " << nodes << "}";
+			}
+
+			// Write in input order
+			std::lock_guard<std::mutex> lock(outputMutex);
+			totalNodes += nodes;
+			pendingOutput[index] = json.str();
+			while (!pendingOutput.empty() && pendingOutput.begin()->first == nextOutput)
+			{
+				out << pendingOutput.begin()->second << "\n";
+				pendingOutput.erase(pendingOutput.begin());
+				nextOutput++;
+			}
+		}
+	});
+	out.flush();
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::ostream& report = outName.empty() ? std::cerr : std::cout;
+	report << "Positions: " << nextIndex << "\n";
+	report << "Threads: " << threadCount << "\n";
+	report << "Time (ms): " << elapsed << "\n";
+	report << "Positions/second: " << std::fixed << std::setprecision(1) << ((elapsed > 0) ? nextIndex * 1000.0 / elapsed : (double)nextIndex) << "\n";
+	report << "Nodes/second: " << ((elapsed > 0) ? totalNodes * 1000 / elapsed : totalNodes) << "\n";
+	return 0;
+}
+
+/*
+--------------------
+
+MATE SOLVER
+
+--------------------
+*/
+
+// Proof-number search for forced mates (Allis). The tree is grown best first: every node has a proof
+// number (leaves still to prove for a mate) and a disproof number (leaves to refute it), and the leaf
+// below the smallest numbers is expanded next. The attacker needs one mating move, the defender has to
+// be mated after every reply, so a narrow forced line is proven long before full width search reaches
+// its depth. Nodes live in a fixed size pool, a table of proven and disproven positions joins
+// transpositions and the solve depth is bounded by a number of plies.
+
+constexpr uint32_t PN_INFINITY = 1u << 30;
+
+struct PNNode {
+	uint32_t proof;
+	uint32_t disproof;
+	uint32_t firstChild; // index in the pool, children are contiguous
+	uint16_t childCount; // 0 until expanded
+	Move move; // from the parent
+	uint8_t matePlies; // plies to mate once proven
+};
+
+struct PNTableEntry {
+	U64 key;
+	uint8_t provenPlies; // mate found in this many plies, 255 if none
+	int8_t disprovenPlies; // no mate within this many plies, -1 if unknown
+};
+
+struct PNSolver {
+	std::vector<PNNode> pool; // reserved to capacity, never reallocates
+	size_t capacity{ 0 };
+	std::vector<PNTableEntry> table;
+	int maxPlies{ 0 };
+	bool checksOnly{ false }; // attacker only plays checks
+	Color attacker{ white };
+};
+
+// Legal moves of c, with checksOnly only those that give check
+int pnLegalMoves(Color c, int ply, bool checksOnly, std::array<Move, MAX_MOVES>& legal)
+{
+	Color opp = (c == white) ? black : white;
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount{ 0 };
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	int legalCount{ 0 };
+	for (int i = 0; i < moveCount; i++)
+	{
+		makeMove(moves[i], c, ply);
+		if (!isKingInCheck(c) && (!checksOnly || isKingInCheck(opp))) legal[legalCount++] = moves[i];
+		unmakeMove(moves[i], c, ply);
+	}
+	return legalCount;
+}
+
+// Sets the numbers of a new node for the side c to move, pliesLeft after this position
+void pnInitialize(PNSolver& solver, PNNode& node, Color c, int pliesLeft, int ply)
+{
+	bool attackerToMove = (c == solver.attacker);
+	node.childCount = 0;
+	node.matePlies = 0;
+
+	PNTableEntry& entry = solver.table[positionKey % solver.table.size()];
+	if (entry.key == positionKey && entry.provenPlies <= pliesLeft)
+	{
+		node.proof = 0;
+		node.disproof = PN_INFINITY;
+		node.matePlies = entry.provenPlies;
+		return;
+	}
+	if (entry.key == positionKey && entry.disprovenPlies >= pliesLeft)
+	{
+		node.proof = PN_INFINITY;
+		node.disproof = 0;
+		return;
+	}
+
+	std::array<Move, MAX_MOVES> legal;
+	int legalCount = pnLegalMoves(c, ply, attackerToMove && solver.checksOnly, legal);
+	bool mated = !attackerToMove && legalCount == 0 && isKingInCheck(c);
+
+	if (mated)
+	{
+		node.proof = 0;
+		node.disproof = PN_INFINITY;
+	}
+	else if (legalCount == 0 || pliesLeft == 0)
+	{
+		node.proof = PN_INFINITY; // stalemate, attacker out of moves or out of plies
+		node.disproof = 0;
+	}
+	else if (attackerToMove)
+	{
+		node.proof = 1;
+		node.disproof = legalCount;
+	}
+	else
+	{
+		node.proof = legalCount; // every reply has to be mated
+		node.disproof = 1;
+	}
+}
+
+// Children of the unexpanded node at the current position, false if the pool is full
+bool pnExpand(PNSolver& solver, uint32_t index, Color c, int ply)
+{
+	Color opp = (c == white) ? black : white;
+	bool attackerToMove = (c == solver.attacker);
+
+	std::array<Move, MAX_MOVES> legal;
+	int legalCount = pnLegalMoves(c, ply, attackerToMove && solver.checksOnly, legal);
+	if (solver.pool.size() + legalCount > solver.capacity) return false;
+
+	uint32_t firstChild = (uint32_t)solver.pool.size();
+	for (int i = 0; i < legalCount; i++)
+	{
+		PNNode child{};
+		child.move = legal[i];
+		makeMove(legal[i], c, ply);
+		pnInitialize(solver, child, opp, solver.maxPlies - ply - 1, ply + 1);
+		unmakeMove(legal[i], c, ply);
+		solver.pool.push_back(child);
+	}
+	solver.pool[index].firstChild = firstChild;
+	solver.pool[index].childCount = (uint16_t)legalCount;
+	return true;
+}
+
+// Numbers of an expanded node from its children. Resolved nodes are stored in the table.
+void pnUpdate(PNSolver& solver, uint32_t index, bool attackerToMove, int pliesLeft)
+{
+	PNNode& node = solver.pool[index];
+	uint32_t proof = attackerToMove ? PN_INFINITY : 0;
+	uint32_t disproof = attackerToMove ? 0 : PN_INFINITY;
+	int matePlies = attackerToMove ? 255 : 0;
+
+	for (uint32_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+	{
+		const PNNode& child = solver.pool[i];
+		if (attackerToMove)
+		{
+			proof = std::min(proof, child.proof);
+			disproof = std::min(disproof + child.disproof, PN_INFINITY);
+			if (child.proof == 0) matePlies = std::min(matePlies, child.matePlies + 1);
+		}
+		else
+		{
+			proof = std::min(proof + child.proof, PN_INFINITY);
+			disproof = std::min(disproof, child.disproof);
+			matePlies = std::max(matePlies, child.matePlies + 1);
+		}
+	}
+	node.proof = proof;
+	node.disproof = disproof;
+
+	PNTableEntry& entry = solver.table[positionKey % solver.table.size()];
+	if (proof != 0 && disproof != 0) return;
+	if (entry.key != positionKey) entry = { positionKey, 255, -1 };
+	if (proof == 0)
+	{
+		node.matePlies = (uint8_t)matePlies;
+		entry.provenPlies = std::min<uint8_t>(entry.provenPlies, node.matePlies);
+	}
+	else entry.disprovenPlies = std::max<int8_t>(entry.disprovenPlies, (int8_t)pliesLeft);
+}
+
+enum PNResult {
+	pn_mate,
+	pn_no_mate,
+	pn_unknown // node limit or pool full
+};
+
+// Solves the current position for its side to move. maxNodes 0 is no limit.
+PNResult pnSearch(PNSolver& solver, U64 maxNodes)
+{
+	solver.pool.clear();
+	solver.attacker = currentSideToMove;
+	solver.pool.push_back(PNNode{});
+	pnInitialize(solver, solver.pool[0], currentSideToMove, solver.maxPlies, 0);
+
+	std::vector<uint32_t> path;
+	while (solver.pool[0].proof != 0 && solver.pool[0].disproof != 0)
+	{
+		if (maxNodes != 0 && solver.pool.size() >= maxNodes) return pn_unknown;
+
+		// Most proving node: smallest proof number below the attacker, smallest disproof number below the defender
+		path.assign(1, 0);
+		Color c = currentSideToMove;
+		while (solver.pool[path.back()].childCount != 0)
+		{
+			const PNNode& node = solver.pool[path.back()];
+			bool attackerToMove = (c == solver.attacker);
+			uint32_t best = node.firstChild;
+			for (uint32_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+			{
+				if (attackerToMove ? solver.pool[i].proof < solver.pool[best].proof : solver.pool[i].disproof < solver.pool[best].disproof) best = i;
+			}
+			makeMove(solver.pool[best].move, c, (int)path.size() - 1);
+			c = (c == white) ? black : white;
+			path.push_back(best);
+		}
+
+		bool expanded = pnExpand(solver, path.back(), c, (int)path.size() - 1);
+
+		// Back up to the root
+		for (int ply = (int)path.size() - 1; ply >= 0; ply--)
+		{
+			if (solver.pool[path[ply]].childCount != 0) pnUpdate(solver, path[ply], c == solver.attacker, solver.maxPlies - ply);
+			if (ply == 0) break;
+			c = (c == white) ? black : white;
+			unmakeMove(solver.pool[path[ply]].move, c, ply - 1);
+		}
+		if (!expanded) return pn_unknown;
+	}
+	return (solver.pool[0].proof == 0) ? pn_mate : pn_no_mate;
+}
+
+// Mating line of a proven root: the fastest mate for the attacker, the longest defence for the defender
+std::vector<Move> pnMateLine(const PNSolver& solver)
+{
+	std::vector<Move> line;
+	uint32_t index = 0;
+	bool attackerToMove = true;
+	while (solver.pool[index].childCount != 0)
+	{
+		const PNNode& node = solver.pool[index];
+		uint32_t best = node.firstChild;
+		for (uint32_t i = node.firstChild; i < node.firstChild + node.childCount; i++)
+		{
+			const PNNode& child = solver.pool[i];
+			if (attackerToMove ? (child.proof == 0 && (solver.pool[best].proof != 0 || child.matePlies < solver.pool[best].matePlies))
+				: child.matePlies > solver.pool[best].matePlies) best = i;
+		}
+		line.push_back(solver.pool[best].move);
+		index = best;
+		attackerToMove = !attackerToMove;
+	}
+	return line;
+}
+
+// solve --epd <file> [--mate N] [--checks] [--nodes N] [--memory MB] [--hash MB] [--out <file>]
+// Proves or refutes a mate for the side to move of every EPD (or FEN) line and writes one JSON object
+// per line: id, fen, result (mate, no mate or unknown), mate in moves, best move, line and nodes.
+// The mate is looked for in at most N moves, an EPD "dm" operation overrides --mate for its position.
+// The bound grows a move at a time, so the first mate proven is the shortest. --nodes bounds the nodes
+// of all of them. --checks limits the attacker to checking moves, --memory is the size of the node pool.
+int runSolve(const std::vector<std::string>& args)
+{
+	std::string epdName, outName;
+	int mateMoves{ 5 };
+	bool checksOnly{ false };
+	U64 maxNodes{ 0 };
+	int memoryMegabytes{ 256 };
+	int hashMegabytes{ 64 };
+
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		if (args[i] == "--checks") checksOnly = true;
+		else if (i + 1 >= args.size()) break;
+		else if (args[i] == "--epd") epdName = args[++i];
+		else if (args[i] == "--out") outName = args[++i];
+		else if (args[i] == "--mate") mateMoves = std::atoi(args[++i].c_str());
+		else if (args[i] == "--nodes") maxNodes = std::strtoull(args[++i].c_str(), nullptr, 10);
+		else if (args[i] == "--memory") memoryMegabytes = std::atoi(args[++i].c_str());
+		else if (args[i] == "--hash") hashMegabytes = std::atoi(args[++i].c_str());
+	}
+
+	std::ifstream epd(epdName);
+	if (epdName.empty() || !epd)
+	{
+		std::cout << "usage: solve --epd <file> [--mate N] [--checks] [--nodes N] [--memory MB] [--hash MB] [--out <file>]" << "\n";
+		return 1;
+	}
+	std::ofstream outFile;
+	if (!outName.empty()) outFile.open(outName);
+	std::ostream& out = outName.empty() ? std::cout : outFile;
+
+	PNSolver solver;
+	solver.checksOnly = checksOnly;
+	solver.capacity = std::max<size_t>(1024, (size_t)std::max(1, memoryMegabytes) * 1024 * 1024 / sizeof(PNNode));
+	solver.pool.reserve(solver.capacity);
+	solver.table.resize(std::max<size_t>(1024, (size_t)std::max(1, hashMegabytes) * 1024 * 1024 / sizeof(PNTableEntry)));
+
+	U64 positions{ 0 }, mates{ 0 }, totalNodes{ 0 };
+	auto start = std::chrono::steady_clock::now();
+
+	std::string line;
+	for (U64 index = 0; std::getline(epd, line); index++)
+	{
+		std::istringstream fields(line);
+		std::string placement, side, castling, enPassant;
+		fields >> placement >> side >> castling >> enPassant;
+		std::string fen = placement + " " + side + " " + castling + " " + enPassant;
+
+		std::string id;
+		size_t idPosition = line.find("id \"");
+		if (idPosition != std::string::npos) id = line.substr(idPosition + 4, line.find('"', idPosition + 4) - idPosition - 4);
+
+		int positionMate = mateMoves;
+		size_t dmPosition = line.find(" dm ");
+		if (dmPosition != std::string::npos) positionMate = std::atoi(line.c_str() + dmPosition + 4);
+
+		std::ostringstream json;
+		json << "{\"index\": " << index << ", \"id\": \"" << jsonEscape(id) << "\", \"fen\": \"" << jsonEscape(fen) << "\"";
+		positions++;
+
+		if (placement.empty() || !setPositionFromFen(fen))
+		{
+			out << json.str() << ", \"error\": \"bad position\"}" << "\n";
+			continue;
+		}
+
+		// The node stack needs a ply for the legality test below the deepest node
+		int maxPlies = std::clamp(2 * positionMate - 1, 1, MAX_DEPTH - 3);
+		std::fill(solver.table.begin(), solver.table.end(), PNTableEntry{ 0, 255, -1 });
+
+		// Mate in 1, 2, ... moves until one is proven. The table keeps the bound of every entry, so the
+		// positions refuted by a shorter bound carry over.
+		auto positionStart = std::chrono::steady_clock::now();
+		PNResult result{ pn_no_mate };
+		U64 positionNodes{ 0 };
+		for (solver.maxPlies = 1; solver.maxPlies <= maxPlies && result == pn_no_mate; solver.maxPlies += 2)
+		{
+			if (maxNodes != 0 && positionNodes >= maxNodes)
+			{
+				result = pn_unknown;
+				break;
+			}
+			result = pnSearch(solver, (maxNodes != 0) ? maxNodes - positionNodes : 0);
+			positionNodes += solver.pool.size();
+		}
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - positionStart).count();
+		totalNodes += positionNodes;
+
+		json << ", \"result\": \"" << ((result == pn_mate) ? "mate" : (result == pn_no_mate) ? "no mate" : "unknown") << "\"";
+		if (result == pn_mate)
+		{
+			mates++;
+			std::vector<Move> mateLine = pnMateLine(solver);
+			json << ", \"mate\": " << (solver.pool[0].matePlies + 1) / 2 << ", \"bestmove\": \"" << moveToString(mateLine[0]) << "\", \"pv\": [";
+			for (size_t i = 0; i < mateLine.size(); i++) json << ((i > 0) ? ", " : "") << "\"" << moveToString(mateLine[i]) << "\"";
+			json << "]";
+		}
+		json << ", \"nodes\": " << positionNodes << ", \"time_ms\": " << elapsed << "}";
+		out << json.str() << "\n";
+	}
+	out.flush();
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::ostream& report = outName.empty() ? std::cerr : std::cout;
+	report << "Positions: " << positions << "\n";
+	report << "Mates: " << mates << "\n";
+	report << "Time (ms): " << elapsed << "\n";
+	report << "Nodes: " << totalNodes << "\n";
+	return 0;
+}
+
+/*
+--------------------
+
+OPENING BOOK
+
+--------------------
+*/
+
+// Polyglot books: 16 byte big endian entries (key, move, weight, learn) sorted by key. Keys are the
+// standard Polyglot keys, so books built by other Polyglot tools can be used as well.
+
+// Polyglot Random64: 64 * kind + 8 * row + file for the pieces (row 0 is rank 1), then 4 castling
+// rights, 8 en passant files and white to move
+constexpr int BOOK_RANDOM_COUNT = 781;
+constexpr std::array<U64, BOOK_RANDOM_COUNT> bookRandom = {
+	0x9D39247E33776D41, 0x2AF7398005AAA5C7, 0x44DB015024623547, 0x9C15F73E62A76AE2,
+	0x75834465489C0C89, 0x3290AC3A203001BF, 0x0FBBAD1F61042279, 0xE83A908FF2FB60CA,
+	0x0D7E765D58755C10, 0x1A083822CEAFE02D, 0x9605D5F0E25EC3B0, 0xD021FF5CD13A2ED5,
+	0x40BDF15D4A672E32, 0x011355146FD56395, 0x5DB4832046F3D9E5, 0x239F8B2D7FF719CC,
+	0x05D1A1AE85B49AA1, 0x679F848F6E8FC971, 0x7449BBFF801FED0B, 0x7D11CDB1C3B7ADF0,
+	0x82C7709E781EB7CC, 0xF3218F1C9510786C, 0x331478F3AF51BBE6, 0x4BB38DE5E7219443,
+	0xAA649C6EBCFD50FC, 0x8DBD98A352AFD40B, 0x87D2074B81D79217, 0x19F3C751D3E92AE1,
+	0xB4AB30F062B19ABF, 0x7B0500AC42047AC4, 0xC9452CA81A09D85D, 0x24AA6C514DA27500,
+	0x4C9F34427501B447, 0x14A68FD73C910841, 0xA71B9B83461CBD93, 0x03488B95B0F1850F,
+	0x637B2B34FF93C040, 0x09D1BC9A3DD90A94, 0x3575668334A1DD3B, 0x735E2B97A4C45A23,
+	0x18727070F1BD400B, 0x1FCBACD259BF02E7, 0xD310A7C2CE9B6555, 0xBF983FE0FE5D8244,
+	0x9F74D14F7454A824, 0x51EBDC4AB9BA3035, 0x5C82C505DB9AB0FA, 0xFCF7FE8A3430B241,
+	0x3253A729B9BA3DDE, 0x8C74C368081B3075, 0xB9BC6C87167C33E7, 0x7EF48F2B83024E20,
+	0x11D505D4C351BD7F, 0x6568FCA92C76A243, 0x4DE0B0F40F32A7B8, 0x96D693460CC37E5D,
+	0x42E240CB63689F2F, 0x6D2BDCDAE2919661, 0x42880B0236E4D951, 0x5F0F4A5898171BB6,
+	0x39F890F579F92F88, 0x93C5B5F47356388B, 0x63DC359D8D231B78, 0xEC16CA8AEA98AD76,
+	0x5355F900C2A82DC7, 0x07FB9F855A997142, 0x5093417AA8A7ED5E, 0x7BCBC38DA25A7F3C,
+	0x19FC8A768CF4B6D4, 0x637A7780DECFC0D9, 0x8249A47AEE0E41F7, 0x79AD695501E7D1E8,
+	0x14ACBAF4777D5776, 0xF145B6BECCDEA195, 0xDABF2AC8201752FC, 0x24C3C94DF9C8D3F6,
+	0xBB6E2924F03912EA, 0x0CE26C0B95C980D9, 0xA49CD132BFBF7CC4, 0xE99D662AF4243939,
+	0x27E6AD7891165C3F, 0x8535F040B9744FF1, 0x54B3F4FA5F40D873, 0x72B12C32127FED2B,
+	0xEE954D3C7B411F47, 0x9A85AC909A24EAA1, 0x70AC4CD9F04F21F5, 0xF9B89D3E99A075C2,
+	0x87B3E2B2B5C907B1, 0xA366E5B8C54F48B8, 0xAE4A9346CC3F7CF2, 0x1920C04D47267BBD,
+	0x87BF02C6B49E2AE9, 0x092237AC237F3859, 0xFF07F64EF8ED14D0, 0x8DE8DCA9F03CC54E,
+	0x9C1633264DB49C89, 0xB3F22C3D0B0B38ED, 0x390E5FB44D01144B, 0x5BFEA5B4712768E9,
+	0x1E1032911FA78984, 0x9A74ACB964E78CB3, 0x4F80F7A035DAFB04, 0x6304D09A0B3738C4,
+	0x2171E64683023A08, 0x5B9B63EB9CEFF80C, 0x506AACF489889342, 0x1881AFC9A3A701D6,
+	0x6503080440750644, 0xDFD395339CDBF4A7, 0xEF927DBCF00C20F2, 0x7B32F7D1E03680EC,
+	0xB9FD7620E7316243, 0x05A7E8A57DB91B77, 0xB5889C6E15630A75, 0x4A750A09CE9573F7,
+	0xCF464CEC899A2F8A, 0xF538639CE705B824, 0x3C79A0FF5580EF7F, 0xEDE6C87F8477609D,
+	0x799E81F05BC93F31, 0x86536B8CF3428A8C, 0x97D7374C60087B73, 0xA246637CFF328532,
+	0x043FCAE60CC0EBA0, 0x920E449535DD359E, 0x70EB093B15B290CC, 0x73A1921916591CBD,
+	0x56436C9FE1A1AA8D, 0xEFAC4B70633B8F81, 0xBB215798D45DF7AF, 0x45F20042F24F1768,
+	0x930F80F4E8EB7462, 0xFF6712FFCFD75EA1, 0xAE623FD67468AA70, 0xDD2C5BC84BC8D8FC,
+	0x7EED120D54CF2DD9, 0x22FE545401165F1C, 0xC91800E98FB99929, 0x808BD68E6AC10365,
+	0xDEC468145B7605F6, 0x1BEDE3A3AEF53302, 0x43539603D6C55602, 0xAA969B5C691CCB7A,
+	0xA87832D392EFEE56, 0x65942C7B3C7E11AE, 0xDED2D633CAD004F6, 0x21F08570F420E565,
+	0xB415938D7DA94E3C, 0x91B859E59ECB6350, 0x10CFF333E0ED804A, 0x28AED140BE0BB7DD,
+	0xC5CC1D89724FA456, 0x5648F680F11A2741, 0x2D255069F0B7DAB3, 0x9BC5A38EF729ABD4,
+	0xEF2F054308F6A2BC, 0xAF2042F5CC5C2858, 0x480412BAB7F5BE2A, 0xAEF3AF4A563DFE43,
+	0x19AFE59AE451497F, 0x52593803DFF1E840, 0xF4F076E65F2CE6F0, 0x11379625747D5AF3,
+	0xBCE5D2248682C115, 0x9DA4243DE836994F, 0x066F70B33FE09017, 0x4DC4DE189B671A1C,
+	0x51039AB7712457C3, 0xC07A3F80C31FB4B4, 0xB46EE9C5E64A6E7C, 0xB3819A42ABE61C87,
+	0x21A007933A522A20, 0x2DF16F761598AA4F, 0x763C4A1371B368FD, 0xF793C46702E086A0,
+	0xD7288E012AEB8D31, 0xDE336A2A4BC1C44B, 0x0BF692B38D079F23, 0x2C604A7A177326B3,
+	0x4850E73E03EB6064, 0xCFC447F1E53C8E1B, 0xB05CA3F564268D99, 0x9AE182C8BC9474E8,
+	0xA4FC4BD4FC5558CA, 0xE755178D58FC4E76, 0x69B97DB1A4C03DFE, 0xF9B5B7C4ACC67C96,
+	0xFC6A82D64B8655FB, 0x9C684CB6C4D24417, 0x8EC97D2917456ED0, 0x6703DF9D2924E97E,
+	0xC547F57E42A7444E, 0x78E37644E7CAD29E, 0xFE9A44E9362F05FA, 0x08BD35CC38336615,
+	0x9315E5EB3A129ACE, 0x94061B871E04DF75, 0xDF1D9F9D784BA010, 0x3BBA57B68871B59D,
+	0xD2B7ADEEDED1F73F, 0xF7A255D83BC373F8, 0xD7F4F2448C0CEB81, 0xD95BE88CD210FFA7,
+	0x336F52F8FF4728E7, 0xA74049DAC312AC71, 0xA2F61BB6E437FDB5, 0x4F2A5CB07F6A35B3,
+	0x87D380BDA5BF7859, 0x16B9F7E06C453A21, 0x7BA2484C8A0FD54E, 0xF3A678CAD9A2E38C,
+	0x39B0BF7DDE437BA2, 0xFCAF55C1BF8A4424, 0x18FCF680573FA594, 0x4C0563B89F495AC3,
+	0x40E087931A00930D, 0x8CFFA9412EB642C1, 0x68CA39053261169F, 0x7A1EE967D27579E2,
+	0x9D1D60E5076F5B6F, 0x3810E399B6F65BA2, 0x32095B6D4AB5F9B1, 0x35CAB62109DD038A,
+	0xA90B24499FCFAFB1, 0x77A225A07CC2C6BD, 0x513E5E634C70E331, 0x4361C0CA3F692F12,
+	0xD941ACA44B20A45B, 0x528F7C8602C5807B, 0x52AB92BEB9613989, 0x9D1DFA2EFC557F73,
+	0x722FF175F572C348, 0x1D1260A51107FE97, 0x7A249A57EC0C9BA2, 0x04208FE9E8F7F2D6,
+	0x5A110C6058B920A0, 0x0CD9A497658A5698, 0x56FD23C8F9715A4C, 0x284C847B9D887AAE,
+	0x04FEABFBBDB619CB, 0x742E1E651C60BA83, 0x9A9632E65904AD3C, 0x881B82A13B51B9E2,
+	0x506E6744CD974924, 0xB0183DB56FFC6A79, 0x0ED9B915C66ED37E, 0x5E11E86D5873D484,
+	0xF678647E3519AC6E, 0x1B85D488D0F20CC5, 0xDAB9FE6525D89021, 0x0D151D86ADB73615,
+	0xA865A54EDCC0F019, 0x93C42566AEF98FFB, 0x99E7AFEABE000731, 0x48CBFF086DDF285A,
+	0x7F9B6AF1EBF78BAF, 0x58627E1A149BBA21, 0x2CD16E2ABD791E33, 0xD363EFF5F0977996,
+	0x0CE2A38C344A6EED, 0x1A804AADB9CFA741, 0x907F30421D78C5DE, 0x501F65EDB3034D07,
+	0x37624AE5A48FA6E9, 0x957BAF61700CFF4E, 0x3A6C27934E31188A, 0xD49503536ABCA345,
+	0x088E049589C432E0, 0xF943AEE7FEBF21B8, 0x6C3B8E3E336139D3, 0x364F6FFA464EE52E,
+	0xD60F6DCEDC314222, 0x56963B0DCA418FC0, 0x16F50EDF91E513AF, 0xEF1955914B609F93,
+	0x565601C0364E3228, 0xECB53939887E8175, 0xBAC7A9A18531294B, 0xB344C470397BBA52,
+	0x65D34954DAF3CEBD, 0xB4B81B3FA97511E2, 0xB422061193D6F6A7, 0x071582401C38434D,
+	0x7A13F18BBEDC4FF5, 0xBC4097B116C524D2, 0x59B97885E2F2EA28, 0x99170A5DC3115544,
+	0x6F423357E7C6A9F9, 0x325928EE6E6F8794, 0xD0E4366228B03343, 0x565C31F7DE89EA27,
+	0x30F5611484119414, 0xD873DB391292ED4F, 0x7BD94E1D8E17DEBC, 0xC7D9F16864A76E94,
+	0x947AE053EE56E63C, 0xC8C93882F9475F5F, 0x3A9BF55BA91F81CA, 0xD9A11FBB3D9808E4,
+	0x0FD22063EDC29FCA, 0xB3F256D8ACA0B0B9, 0xB03031A8B4516E84, 0x35DD37D5871448AF,
+	0xE9F6082B05542E4E, 0xEBFAFA33D7254B59, 0x9255ABB50D532280, 0xB9AB4CE57F2D34F3,
+	0x693501D628297551, 0xC62C58F97DD949BF, 0xCD454F8F19C5126A, 0xBBE83F4ECC2BDECB,
+	0xDC842B7E2819E230, 0xBA89142E007503B8, 0xA3BC941D0A5061CB, 0xE9F6760E32CD8021,
+	0x09C7E552BC76492F, 0x852F54934DA55CC9, 0x8107FCCF064FCF56, 0x098954D51FFF6580,
+	0x23B70EDB1955C4BF, 0xC330DE426430F69D, 0x4715ED43E8A45C0A, 0xA8D7E4DAB780A08D,
+	0x0572B974F03CE0BB, 0xB57D2E985E1419C7, 0xE8D9ECBE2CF3D73F, 0x2FE4B17170E59750,
+	0x11317BA87905E790, 0x7FBF21EC8A1F45EC, 0x1725CABFCB045B00, 0x964E915CD5E2B207,
+	0x3E2B8BCBF016D66D, 0xBE7444E39328A0AC, 0xF85B2B4FBCDE44B7, 0x49353FEA39BA63B1,
+	0x1DD01AAFCD53486A, 0x1FCA8A92FD719F85, 0xFC7C95D827357AFA, 0x18A6A990C8B35EBD,
+	0xCCCB7005C6B9C28D, 0x3BDBB92C43B17F26, 0xAA70B5B4F89695A2, 0xE94C39A54A98307F,
+	0xB7A0B174CFF6F36E, 0xD4DBA84729AF48AD, 0x2E18BC1AD9704A68, 0x2DE0966DAF2F8B1C,
+	0xB9C11D5B1E43A07E, 0x64972D68DEE33360, 0x94628D38D0C20584, 0xDBC0D2B6AB90A559,
+	0xD2733C4335C6A72F, 0x7E75D99D94A70F4D, 0x6CED1983376FA72B, 0x97FCAACBF030BC24,
+	0x7B77497B32503B12, 0x8547EDDFB81CCB94, 0x79999CDFF70902CB, 0xCFFE1939438E9B24,
+	0x829626E3892D95D7, 0x92FAE24291F2B3F1, 0x63E22C147B9C3403, 0xC678B6D860284A1C,
+	0x5873888850659AE7, 0x0981DCD296A8736D, 0x9F65789A6509A440, 0x9FF38FED72E9052F,
+	0xE479EE5B9930578C, 0xE7F28ECD2D49EECD, 0x56C074A581EA17FE, 0x5544F7D774B14AEF,
+	0x7B3F0195FC6F290F, 0x12153635B2C0CF57, 0x7F5126DBBA5E0CA7, 0x7A76956C3EAFB413,
+	0x3D5774A11D31AB39, 0x8A1B083821F40CB4, 0x7B4A38E32537DF62, 0x950113646D1D6E03,
+	0x4DA8979A0041E8A9, 0x3BC36E078F7515D7, 0x5D0A12F27AD310D1, 0x7F9D1A2E1EBE1327,
+	0xDA3A361B1C5157B1, 0xDCDD7D20903D0C25, 0x36833336D068F707, 0xCE68341F79893389,
+	0xAB9090168DD05F34, 0x43954B3252DC25E5, 0xB438C2B67F98E5E9, 0x10DCD78E3851A492,
+	0xDBC27AB5447822BF, 0x9B3CDB65F82CA382, 0xB67B7896167B4C84, 0xBFCED1B0048EAC50,
+	0xA9119B60369FFEBD, 0x1FFF7AC80904BF45, 0xAC12FB171817EEE7, 0xAF08DA9177DDA93D,
+	0x1B0CAB936E65C744, 0xB559EB1D04E5E932, 0xC37B45B3F8D6F2BA, 0xC3A9DC228CAAC9E9,
+	0xF3B8B6675A6507FF, 0x9FC477DE4ED681DA, 0x67378D8ECCEF96CB, 0x6DD856D94D259236,
+	0xA319CE15B0B4DB31, 0x073973751F12DD5E, 0x8A8E849EB32781A5, 0xE1925C71285279F5,
+	0x74C04BF1790C0EFE, 0x4DDA48153C94938A, 0x9D266D6A1CC0542C, 0x7440FB816508C4FE,
+	0x13328503DF48229F, 0xD6BF7BAEE43CAC40, 0x4838D65F6EF6748F, 0x1E152328F3318DEA,
+	0x8F8419A348F296BF, 0x72C8834A5957B511, 0xD7A023A73260B45C, 0x94EBC8ABCFB56DAE,
+	0x9FC10D0F989993E0, 0xDE68A2355B93CAE6, 0xA44CFE79AE538BBE, 0x9D1D84FCCE371425,
+	0x51D2B1AB2DDFB636, 0x2FD7E4B9E72CD38C, 0x65CA5B96B7552210, 0xDD69A0D8AB3B546D,
+	0x604D51B25FBF70E2, 0x73AA8A564FB7AC9E, 0x1A8C1E992B941148, 0xAAC40A2703D9BEA0,
+	0x764DBEAE7FA4F3A6, 0x1E99B96E70A9BE8B, 0x2C5E9DEB57EF4743, 0x3A938FEE32D29981,
+	0x26E6DB8FFDF5ADFE, 0x469356C504EC9F9D, 0xC8763C5B08D1908C, 0x3F6C6AF859D80055,
+	0x7F7CC39420A3A545, 0x9BFB227EBDF4C5CE, 0x89039D79D6FC5C5C, 0x8FE88B57305E2AB6,
+	0xA09E8C8C35AB96DE, 0xFA7E393983325753, 0xD6B6D0ECC617C699, 0xDFEA21EA9E7557E3,
+	0xB67C1FA481680AF8, 0xCA1E3785A9E724E5, 0x1CFC8BED0D681639, 0xD18D8549D140CAEA,
+	0x4ED0FE7E9DC91335, 0xE4DBF0634473F5D2, 0x1761F93A44D5AEFE, 0x53898E4C3910DA55,
+	0x734DE8181F6EC39A, 0x2680B122BAA28D97, 0x298AF231C85BAFAB, 0x7983EED3740847D5,
+	0x66C1A2A1A60CD889, 0x9E17E49642A3E4C1, 0xEDB454E7BADC0805, 0x50B704CAB602C329,
+	0x4CC317FB9CDDD023, 0x66B4835D9EAFEA22, 0x219B97E26FFC81BD, 0x261E4E4C0A333A9D,
+	0x1FE2CCA76517DB90, 0xD7504DFA8816EDBB, 0xB9571FA04DC089C8, 0x1DDC0325259B27DE,
+	0xCF3F4688801EB9AA, 0xF4F5D05C10CAB243, 0x38B6525C21A42B0E, 0x36F60E2BA4FA6800,
+	0xEB3593803173E0CE, 0x9C4CD6257C5A3603, 0xAF0C317D32ADAA8A, 0x258E5A80C7204C4B,
+	0x8B889D624D44885D, 0xF4D14597E660F855, 0xD4347F66EC8941C3, 0xE699ED85B0DFB40D,
+	0x2472F6207C2D0484, 0xC2A1E7B5B459AEB5, 0xAB4F6451CC1D45EC, 0x63767572AE3D6174,
+	0xA59E0BD101731A28, 0x116D0016CB948F09, 0x2CF9C8CA052F6E9F, 0x0B090A7560A968E3,
+	0xABEEDDB2DDE06FF1, 0x58EFC10B06A2068D, 0xC6E57A78FBD986E0, 0x2EAB8CA63CE802D7,
+	0x14A195640116F336, 0x7C0828DD624EC390, 0xD74BBE77E6116AC7, 0x804456AF10F5FB53,
+	0xEBE9EA2ADF4321C7, 0x03219A39EE587A30, 0x49787FEF17AF9924, 0xA1E9300CD8520548,
+	0x5B45E522E4B1B4EF, 0xB49C3B3995091A36, 0xD4490AD526F14431, 0x12A8F216AF9418C2,
+	0x001F837CC7350524, 0x1877B51E57A764D5, 0xA2853B80F17F58EE, 0x993E1DE72D36D310,
+	0xB3598080CE64A656, 0x252F59CF0D9F04BB, 0xD23C8E176D113600, 0x1BDA0492E7E4586E,
+	0x21E0BD5026C619BF, 0x3B097ADAF088F94E, 0x8D14DEDB30BE846E, 0xF95CFFA23AF5F6F4,
+	0x3871700761B3F743, 0xCA672B91E9E4FA16, 0x64C8E531BFF53B55, 0x241260ED4AD1E87D,
+	0x106C09B972D2E822, 0x7FBA195410E5CA30, 0x7884D9BC6CB569D8, 0x0647DFEDCD894A29,
+	0x63573FF03E224774, 0x4FC8E9560F91B123, 0x1DB956E450275779, 0xB8D91274B9E9D4FB,
+	0xA2EBEE47E2FBFCE1, 0xD9F1F30CCD97FB09, 0xEFED53D75FD64E6B, 0x2E6D02C36017F67F,
+	0xA9AA4D20DB084E9B, 0xB64BE8D8B25396C1, 0x70CB6AF7C2D5BCF0, 0x98F076A4F7A2322E,
+	0xBF84470805E69B5F, 0x94C3251F06F90CF3, 0x3E003E616A6591E9, 0xB925A6CD0421AFF3,
+	0x61BDD1307C66E300, 0xBF8D5108E27E0D48, 0x240AB57A8B888B20, 0xFC87614BAF287E07,
+	0xEF02CDD06FFDB432, 0xA1082C0466DF6C0A, 0x8215E577001332C8, 0xD39BB9C3A48DB6CF,
+	0x2738259634305C14, 0x61CF4F94C97DF93D, 0x1B6BACA2AE4E125B, 0x758F450C88572E0B,
+	0x959F587D507A8359, 0xB063E962E045F54D, 0x60E8ED72C0DFF5D1, 0x7B64978555326F9F,
+	0xFD080D236DA814BA, 0x8C90FD9B083F4558, 0x106F72FE81E2C590, 0x7976033A39F7D952,
+	0xA4EC0132764CA04B, 0x733EA705FAE4FA77, 0xB4D8F77BC3E56167, 0x9E21F4F903B33FD9,
+	0x9D765E419FB69F6D, 0xD30C088BA61EA5EF, 0x5D94337FBFAF7F5B, 0x1A4E4822EB4D7A59,
+	0x6FFE73E81B637FB3, 0xDDF957BC36D8B9CA, 0x64D0E29EEA8838B3, 0x08DD9BDFD96B9F63,
+	0x087E79E5A57D1D13, 0xE328E230E3E2B3FB, 0x1C2559E30F0946BE, 0x720BF5F26F4D2EAA,
+	0xB0774D261CC609DB, 0x443F64EC5A371195, 0x4112CF68649A260E, 0xD813F2FAB7F5C5CA,
+	0x660D3257380841EE, 0x59AC2C7873F910A3, 0xE846963877671A17, 0x93B633ABFA3469F8,
+	0xC0C0F5A60EF4CDCF, 0xCAF21ECD4377B28C, 0x57277707199B8175, 0x506C11B9D90E8B1D,
+	0xD83CC2687A19255F, 0x4A29C6465A314CD1, 0xED2DF21216235097, 0xB5635C95FF7296E2,
+	0x22AF003AB672E811, 0x52E762596BF68235, 0x9AEBA33AC6ECC6B0, 0x944F6DE09134DFB6,
+	0x6C47BEC883A7DE39, 0x6AD047C430A12104, 0xA5B1CFDBA0AB4067, 0x7C45D833AFF07862,
+	0x5092EF950A16DA0B, 0x9338E69C052B8E7B, 0x455A4B4CFE30E3F5, 0x6B02E63195AD0CF8,
+	0x6B17B224BAD6BF27, 0xD1E0CCD25BB9C169, 0xDE0C89A556B9AE70, 0x50065E535A213CF6,
+	0x9C1169FA2777B874, 0x78EDEFD694AF1EED, 0x6DC93D9526A50E68, 0xEE97F453F06791ED,
+	0x32AB0EDB696703D3, 0x3A6853C7E70757A7, 0x31865CED6120F37D, 0x67FEF95D92607890,
+	0x1F2B1D1F15F6DC9C, 0xB69E38A8965C6B65, 0xAA9119FF184CCCF4, 0xF43C732873F24C13,
+	0xFB4A3D794A9A80D2, 0x3550C2321FD6109C, 0x371F77E76BB8417E, 0x6BFA9AAE5EC05779,
+	0xCD04F3FF001A4778, 0xE3273522064480CA, 0x9F91508BFFCFC14A, 0x049A7F41061A9E60,
+	0xFCB6BE43A9F2FE9B, 0x08DE8A1C7797DA9B, 0x8F9887E6078735A1, 0xB5B4071DBFC73A66,
+	0x230E343DFBA08D33, 0x43ED7F5A0FAE657D, 0x3A88A0FBBCB05C63, 0x21874B8B4D2DBC4F,
+	0x1BDEA12E35F6A8C9, 0x53C065C6C8E63528, 0xE34A1D250E7A8D6B, 0xD6B04D3B7651DD7E,
+	0x5E90277E7CB39E2D, 0x2C046F22062DC67D, 0xB10BB459132D0A26, 0x3FA9DDFB67E2F199,
+	0x0E09B88E1914F7AF, 0x10E8B35AF3EEAB37, 0x9EEDECA8E272B933, 0xD4C718BC4AE8AE5F,
+	0x81536D601170FC20, 0x91B534F885818A06, 0xEC8177F83F900978, 0x190E714FADA5156E,
+	0xB592BF39B0364963, 0x89C350C893AE7DC1, 0xAC042E70F8B383F2, 0xB49B52E587A1EE60,
+	0xFB152FE3FF26DA89, 0x3E666E6F69AE2C15, 0x3B544EBE544C19F9, 0xE805A1E290CF2456,
+	0x24B33C9D7ED25117, 0xE74733427B72F0C1, 0x0A804D18B7097475, 0x57E3306D881EDB4F,
+	0x4AE7D6A36EB5DBCB, 0x2D8D5432157064C8, 0xD1E649DE1E7F268B, 0x8A328A1CEDFE552C,
+	0x07A3AEC79624C7DA, 0x84547DDC3E203C94, 0x990A98FD5071D263, 0x1A4FF12616EEFC89,
+	0xF6F7FD1431714200, 0x30C05B1BA332F41C, 0x8D2636B81555A786, 0x46C9FEB55D120902,
+	0xCCEC0A73B49C9921, 0x4E9D2827355FC492, 0x19EBB029435DCB0F, 0x4659D2B743848A2C,
+	0x963EF2C96B33BE31, 0x74F85198B05A2E7D, 0x5A0F544DD2B1FB18, 0x03727073C2E134B1,
+	0xC7F6AA2DE59AEA61, 0x352787BAA0D7C22F, 0x9853EAB63B5E0B35, 0xABBDCDD7ED5C0860,
+	0xCF05DAF5AC8D77B0, 0x49CAD48CEBF4A71E, 0x7A4C10EC2158C4A6, 0xD9E92AA246BF719E,
+	0x13AE978D09FE5557, 0x730499AF921549FF, 0x4E4B705B92903BA4, 0xFF577222C14F0A3A,
+	0x55B6344CF97AAFAE, 0xB862225B055B6960, 0xCAC09AFBDDD2CDB4, 0xDAF8E9829FE96B5F,
+	0xB5FDFC5D3132C498, 0x310CB380DB6F7503, 0xE87FBB46217A360E, 0x2102AE466EBB1148,
+	0xF8549E1A3AA5E00D, 0x07A69AFDCC42261A, 0xC4C118BFE78FEAAE, 0xF9F4892ED96BD438,
+	0x1AF3DBE25D8F45DA, 0xF5B4B0B0D2DEEEB4, 0x962ACEEFA82E1C84, 0x046E3ECAAF453CE9,
+	0xF05D129681949A4C, 0x964781CE734B3C84, 0x9C2ED44081CE5FBD, 0x522E23F3925E319E,
+	0x177E00F9FC32F791, 0x2BC60A63A6F3B3F2, 0x222BBFAE61725606, 0x486289DDCC3D6780,
+	0x7DC7785B8EFDFC80, 0x8AF38731C02BA980, 0x1FAB64EA29A2DDF7, 0xE4D9429322CD065A,
+	0x9DA058C67844F20C, 0x24C0E332B70019B0, 0x233003B5A6CFE6AD, 0xD586BD01C5C217F6,
+	0x5E5637885F29BC2B, 0x7EBA726D8C94094B, 0x0A56A5F0BFE39272, 0xD79476A84EE20D06,
+	0x9E4C1269BAA4BF37, 0x17EFEE45B0DEE640, 0x1D95B0A5FCF90BC6, 0x93CBE0B699C2585D,
+	0x65FA4F227A2B6D79, 0xD5F9E858292504D5, 0xC2B5A03F71471A6F, 0x59300222B4561E00,
+	0xCE2F8642CA0712DC, 0x7CA9723FBB2E8988, 0x2785338347F2BA08, 0xC61BB3A141E50E8C,
+	0x150F361DAB9DEC26, 0x9F6A419D382595F4, 0x64A53DC924FE7AC9, 0x142DE49FFF7A7C3D,
+	0x0C335248857FA9E7, 0x0A9C32D5EAE45305, 0xE6C42178C4BBB92E, 0x71F1CE2490D20B07,
+	0xF1BCC3D275AFE51A, 0xE728E8C83C334074, 0x96FBF83A12884624, 0x81A1549FD6573DA5,
+	0x5FA7867CAF35E149, 0x56986E2EF3ED091B, 0x917F1DD5F8886C61, 0xD20D8C88C8FFE65F,
+	0x31D71DCE64B2C310, 0xF165B587DF898190, 0xA57E6339DD2CF3A0, 0x1EF6E6DBB1961EC9,
+	0x70CC73D90BC26E24, 0xE21A6B35DF0C3AD7, 0x003A93D8B2806962, 0x1C99DED33CB890A1,
+	0xCF3145DE0ADD4289, 0xD0E4427A5514FB72, 0x77C621CC9FB3A483, 0x67A34DAC4356550B,
+	0xF8D626AAAF278509
+};
+
+MappedFile bookFile;
+bool ownBook{ false }; // UCI OwnBook
+bool bookBestMove{ false }; // UCI BookBestMove, otherwise a random move weighted by the entries
+std::mt19937_64 bookMoveRandom{ std::random_device{}() };
+
+// Polyglot key of the current position, c to move
+U64 bookKey(Color c)
+{
+	// Polyglot piece kinds are black pawn 0, white pawn 1, black knight 2 .. white king 11
+	static const int pieceKind[12] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10 };
+
+	U64 key{ 0 };
+	for (int index = bb_wpawn; index <= bb_bking; index++)
+	{
+		for (int square = a8; square <= h1; square++)
+		{
+			if (get_bit(bitboardPieces[index], square)) key ^= bookRandom[64 * pieceKind[index] + 8 * (getRank(square) - 1) + getFile(square) - 1];
+		}
+	}
+
+	if (whiteKingSideCastlingRights) key ^= bookRandom[768];
+	if (whiteQueenSideCastlingRights) key ^= bookRandom[769];
+	if (blackKingSideCastlingRights) key ^= bookRandom[770];
+	if (blackQueenSideCastlingRights) key ^= bookRandom[771];
+
+	// En passant file, only when a pawn can take
+	const std::vector<Move>& oppMoveLog = (c == white) ? blackMoveLog : whiteMoveLog;
+	if (!oppMoveLog.empty() && getFlag(oppMoveLog.back()) == double_pawn_push)
+	{
+		int to = getTo(oppMoveLog.back());
+		EPieceCode pawn = (c == white) ? epc_wpawn : epc_bpawn;
+		if ((getFile(to) > 1 && mainBoard[to - 1] == pawn) || (getFile(to) < 8 && mainBoard[to + 1] == pawn)) key ^= bookRandom[772 + getFile(to) - 1];
+	}
+
+	if (c == white) key ^= bookRandom[780];
+
+	return key;
+}
+
+// Polyglot move: to file, to row, from file, from row (3 bits each) and promotion piece, castling as king takes rook
+uint16_t toBookMove(Move m)
+{
+	int from = getFrom(m);
+	int to = getTo(m);
+	int flag = getFlag(m);
+
+	if (flag == king_side_castle) to = from + 3;
+	else if (flag == queen_side_castle) to = from - 4;
+
+	int promotion = (flag >= knight_promotion) ? (flag - knight_promotion) % 4 + 1 : 0;
+
+	return uint16_t((promotion << 12) | ((getRank(from) - 1) << 9) | ((getFile(from) - 1) << 6) | ((getRank(to) - 1) << 3) | (getFile(to) - 1));
+}
+
+// Polyglot move in UCI notation
+std::string bookMoveToString(uint16_t bookMove)
+{
+	int to = (7 - ((bookMove >> 3) & 7)) * 8 + (bookMove & 7);
+	int from = (7 - ((bookMove >> 9) & 7)) * 8 + ((bookMove >> 6) & 7);
+	int promotion = (bookMove >> 12) & 7;
+
+	// King takes own rook is castling
+	if ((mainBoard[from] == epc_wking && from == e1 && to == h1) || (mainBoard[from] == epc_bking && from == e8 && to == h8)) to = from + 2;
+	if ((mainBoard[from] == epc_wking && from == e1 && to == a1) || (mainBoard[from] == epc_bking && from == e8 && to == a8)) to = from - 2;
+
+	std::string moveStr = squareToString(from) + squareToString(to);
+	if (promotion >= 1 && promotion <= 4) moveStr += "nbrq"[promotion - 1];
+	return moveStr;
+}
+
+// Legal move of the current position in UCI notation, 0 if there is none
+Move findLegalMove(Color c, const std::string& moveStr, int ply)
+{
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount;
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	for (int i = 0; i < moveCount; i++)
+	{
+		if (moveToString(moves[i]) != moveStr) continue;
+
+		makeMove(moves[i], c, ply);
+		bool legal = !isKingInCheck(c);
+		unmakeMove(moves[i], c, ply);
+		if (legal) return moves[i];
+	}
+	return 0;
+}
+
+// UCI BookFile, an empty name or <empty> closes the book
+void openBook(const std::string& fileName)
+{
+	unmapFile(bookFile);
+	if (fileName.empty() || fileName == "<empty>") return;
+
+	if (!mapFile(fileName, bookFile) || bookFile.size % 16 != 0)
+	{
+		std::cout << "info string Can't open book " << fileName << "\n";
+		unmapFile(bookFile);
+		return;
+	}
+	std::cout << "info string Book " << fileName << " with " << bookFile.size / 16 << " entries" << "\n";
+}
+
+// Book move of the current position, 0 if the position isn't in the book
+Move probeBook(Color c)
+{
+	if (bookFile.data == nullptr) return 0;
+
+	U64 key = bookKey(c);
+	U64 entryCount = bookFile.size / 16;
+
+	// Binary search for the first entry of the key
+	U64 low{ 0 };
+	U64 high = entryCount;
+	while (low < high)
+	{
+		U64 middle = (low + high) / 2;
+		if (readBE64(bookFile.data + 16 * middle) < key) low = middle + 1;
+		else high = middle;
+	}
+
+	Move bookMove{ 0 };
+	U64 totalWeight{ 0 };
+	int bestWeight{ -1 };
+	for (U64 i = low; i < entryCount && readBE64(bookFile.data + 16 * i) == key; i++)
+	{
+		const uint8_t* entry = bookFile.data + 16 * i;
+		int weight = readBE16(entry + 10);
+
+		Move m = findLegalMove(c, bookMoveToString(readBE16(entry + 8)), 0);
+		if (m == 0) continue; // Key collision
+
+		if (bookBestMove)
+		{
+			if (weight > bestWeight)
+			{
+				bestWeight = weight;
+				bookMove = m;
+			}
+		}
+		else if (weight > 0)
+		{
+			// Keeps every move with probability weight / total weight
+			totalWeight += weight;
+			if (std::uniform_int_distribution<U64>(0, totalWeight - 1)(bookMoveRandom) < (U64)weight) bookMove = m;
+		}
+	}
+
+	return bookMove;
+}
+
+/* --- Book building --- */
+
+// Legal move of the current position in SAN (e4, Nbd7, exd8=Q+, O-O), 0 if there is none
+Move parseSan(Color c, std::string san, int ply)
+{
+	while (!san.empty() && std::string("+#!?").find(san.back()) != std::string::npos) san.pop_back();
+
+	bool kingSide = (san == "O-O" || san == "0-0");
+	bool queenSide = (san == "O-O-O" || san == "0-0-0");
+	char piece{ 'P' };
+	char promotion{ 0 };
+	int to{ -1 };
+	std::string disambiguation;
+
+	if (!kingSide && !queenSide)
+	{
+		size_t equals = san.find('=');
+		if (equals != std::string::npos && equals + 1 < san.size())
+		{
+			promotion = (char)std::tolower(san[equals + 1]);
+			san.erase(equals);
+		}
+		else if (san.size() > 2 && std::islower(san[0]) && std::string("NBRQ").find(san.back()) != std::string::npos)
+		{
+			promotion = (char)std::tolower(san.back());
+			san.pop_back();
+		}
+
+		if (!san.empty() && std::string("NBRQK").find(san[0]) != std::string::npos)
+		{
+			piece = san[0];
+			san.erase(0, 1);
+		}
+		if (san.size() < 2) return 0;
+
+		to = stringToSquare(san.substr(san.size() - 2));
+		if (to == -1) return 0;
+		for (char ch : san.substr(0, san.size() - 2))
+		{
+			if (ch != 'x') disambiguation += ch;
+		}
+	}
+
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount;
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	for (int i = 0; i < moveCount; i++)
+	{
+		int flag = getFlag(moves[i]);
+		if (kingSide || queenSide)
+		{
+			if (flag != (kingSide ? king_side_castle : queen_side_castle)) continue;
+		}
+		else
+		{
+			if (getTo(moves[i]) != to) continue;
+
+			int type = mainBoard[getFrom(moves[i])] & 7;
+			char moved = (type == ept_wpawn || type == ept_bpawn) ? 'P' : "NBRQK"[type - ept_knight];
+			if (moved != piece) continue;
+
+			std::string from = squareToString(getFrom(moves[i]));
+			bool matches{ true };
+			for (char ch : disambiguation)
+			{
+				if (ch != from[0] && ch != from[1]) matches = false;
+			}
+			if (!matches) continue;
+
+			char movePromotion = (flag >= knight_promotion) ? "nbrq"[(flag - knight_promotion) % 4] : 0;
+			if (movePromotion != promotion) continue;
+		}
+
+		makeMove(moves[i], c, ply);
+		bool legal = !isKingInCheck(c);
+		unmakeMove(moves[i], c, ply);
+		if (legal) return moves[i];
+	}
+	return 0;
+}
+
+struct PgnGame {
+	std::string fen;
+	std::string result;
+	std::vector<std::string> moves; // SAN, main line only
+};
+
+// Streams the games of a PGN file to onGame, skipping comments, variations, NAGs and move numbers
+template <typename Function>
+void readPgn(std::istream& in, Function onGame)
+{
+	PgnGame game;
+	bool inComment{ false };
+	int variationDepth{ 0 };
+	bool inMovetext{ false };
+
+	auto endGame = [&]()
+	{
+		if (!game.moves.empty()) onGame(game);
+		game = PgnGame{};
+		inComment = false;
+		variationDepth = 0;
+		inMovetext = false;
+	};
+
+	auto addToken = [&](std::string& token)
+	{
+		if (token.empty()) return;
+		if (variationDepth == 0)
+		{
+			if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*")
+			{
+				if (game.result.empty()) game.result = token;
+				endGame();
+			}
+			else if (token[0] != '$')
+			{
+				// Strip move numbers, "12." or "12..." with or without a space before the move
+				size_t start = token.find_first_not_of("0123456789.");
+				if (token.rfind("0-0", 0) == 0) game.moves.push_back(token); // Castling written with zeros
+				else if (start != std::string::npos && (start == 0 || token[start - 1] == '.')) game.moves.push_back(token.substr(start));
+			}
+		}
+		token.clear();
+	};
+
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (!inComment && !line.empty() && line[0] == '%') continue; // Escaped line
+
+		// Tag pair, a tag after movetext starts the next game
+		if (!inComment && !line.empty() && line[0] == '[')
+		{
+			if (inMovetext) endGame();
+
+			std::string name = line.substr(1, line.find(' ') - 1);
+			size_t open = line.find('"');
+			size_t close = line.rfind('"');
+			std::string value = (open != std::string::npos && close > open) ? line.substr(open + 1, close - open - 1) : "";
+
+			if (name == "FEN") game.fen = value;
+			else if (name == "Result") game.result = value;
+			continue;
+		}
+
+		std::string token;
+		for (char ch : line)
+		{
+			if (inComment)
+			{
+				if (ch == '}') inComment = false;
+				continue;
+			}
+
+			if (ch == '{') { addToken(token); inComment = true; }
+			else if (ch == ';') break; // Rest of line comment
+			else if (ch == '(') { addToken(token); variationDepth++; }
+			else if (ch == ')') { addToken(token); variationDepth = std::max(0, variationDepth - 1); }
+			else if (std::isspace((unsigned char)ch)) addToken(token);
+			else
+			{
+				token += ch;
+				inMovetext = true;
+			}
+		}
+		addToken(token);
+	}
+	endGame();
+}
+
+struct BookRecord {
+	U64 key;
+	uint16_t move;
+	uint32_t weight;
+};
+
+bool operator<(const BookRecord& a, const BookRecord& b)
+{
+	return (a.key != b.key) ? a.key < b.key : a.move < b.move;
+}
+
+// Sorts records and sums the weights of equal key and move
+void compactBookRecords(std::vector<BookRecord>& records)
+{
+	std::sort(records.begin(), records.end());
+
+	size_t count{ 0 };
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		if (count > 0 && records[count - 1].key == records[i].key && records[count - 1].move == records[i].move) records[count - 1].weight += records[i].weight;
+		else records[count++] = records[i];
+	}
+	records.resize(count);
+}
+
+// Merges the sorted run files, calling onRecord once per key and move with the summed weight
+template <typename Function>
+void mergeBookRuns(const std::vector<std::string>& runNames, Function onRecord)
+{
+	std::vector<std::ifstream> runs;
+	std::vector<BookRecord> heads(runNames.size());
+	std::vector<bool> hasHead(runNames.size());
+
+	for (size_t i = 0; i < runNames.size(); i++)
+	{
+		runs.emplace_back(runNames[i], std::ios::binary);
+		hasHead[i] = (bool)runs[i].read((char*)&heads[i], sizeof(BookRecord));
+	}
+
+	bool hasCurrent{ false };
+	BookRecord current{};
+	while (true)
+	{
+		// Smallest head, the runs are few so a linear scan is enough
+		int smallest{ -1 };
+		for (size_t i = 0; i < runs.size(); i++)
+		{
+			if (hasHead[i] && (smallest == -1 || heads[i] < heads[smallest])) smallest = (int)i;
+		}
+		if (smallest == -1) break;
+
+		BookRecord record = heads[smallest];
+		hasHead[smallest] = (bool)runs[smallest].read((char*)&heads[smallest], sizeof(BookRecord));
+
+		if (hasCurrent && current.key == record.key && current.move == record.move) current.weight += record.weight;
+		else
+		{
+			if (hasCurrent) onRecord(current);
+			current = record;
+			hasCurrent = true;
+		}
+	}
+	if (hasCurrent) onRecord(current);
+}
+
+void writeBigEndian(std::ostream& out, U64 value, int bytes)
+{
+	for (int i = bytes - 1; i >= 0; i--) out.put((char)((value >> (8 * i)) & 0xFF));
+}
+
+// book build <pgn> <book> [max ply] [memory MB]: every position of the first max ply moves of every game
+// with a result, weighted 2 for a win and 1 for a draw of the side that moved. Records are collected in
+// memory up to the memory limit, then written as sorted runs that are merged into the book.
+bool buildBook(const std::string& pgnName, const std::string& bookName, int maxPly, int memoryMegabytes)
+{
+	std::ifstream pgn(pgnName);
+	if (!pgn)
+	{
+		std::cout << "Can't open " << pgnName << "\n";
+		return false;
+	}
+
+	const size_t capacity = std::max<size_t>(1024, (size_t)memoryMegabytes * 1024 * 1024 / sizeof(BookRecord));
+	std::vector<BookRecord> records;
+	records.reserve(capacity);
+	std::vector<std::string> runNames;
+	U64 games{ 0 };
+	U64 positions{ 0 };
+
+	auto writeRun = [&]()
+	{
+		compactBookRecords(records);
+		runNames.push_back(bookName + ".run" + std::to_string(runNames.size()));
+		std::ofstream run(runNames.back(), std::ios::binary);
+		run.write((const char*)records.data(), records.size() * sizeof(BookRecord));
+		records.clear();
+	};
+
+	readPgn(pgn, [&](const PgnGame& game)
+	{
+		int whiteWeight = (game.result == "1-0") ? 2 : (game.result == "1/2-1/2") ? 1 : (game.result == "0-1") ? 0 : -1;
+		if (whiteWeight == -1) return; // Unknown result
+		if (!setPositionFromFen(game.fen.empty() ? "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" : game.fen)) return;
+		games++;
+
+		Color c = currentSideToMove;
+		for (int ply = 0; ply < maxPly && ply < (int)game.moves.size(); ply++)
+		{
+			Move m = parseSan(c, game.moves[ply], 1);
+			if (m == 0) break; // Illegal or unreadable, keep the moves before it
+
+			uint32_t weight = (c == white) ? whiteWeight : 2 - whiteWeight;
+			records.push_back({ bookKey(c), toBookMove(m), weight });
+			positions++;
+
+			makeMove(m, c, 0);
+			c = (c == white) ? black : white;
+
+			// Full: merge duplicates, spill to a run if that didn't free half of it
+			if (records.size() == capacity)
+			{
+				compactBookRecords(records);
+				if (records.size() > capacity / 2) writeRun();
+			}
+		}
+	});
+	writeRun();
+
+	// Weights are 16 bits in the book, scale them down if needed
+	U64 maxWeight{ 0 };
+	mergeBookRuns(runNames, [&](const BookRecord& record) { maxWeight = std::max<U64>(maxWeight, record.weight); });
+
+	std::ofstream book(bookName, std::ios::binary);
+	U64 entries{ 0 };
+	mergeBookRuns(runNames, [&](const BookRecord& record)
+	{
+		U64 weight = (maxWeight > 65535) ? record.weight * 65535ULL / maxWeight : record.weight;
+		if (weight == 0) return; // Only lost with this move
+
+		writeBigEndian(book, record.key, 8);
+		writeBigEndian(book, record.move, 2);
+		writeBigEndian(book, weight, 2);
+		writeBigEndian(book, 0, 4); // learn
+		entries++;
+	});
+	book.close();
+
+	for (const std::string& runName : runNames) std::remove(runName.c_str());
+
+	std::cout << "Games: " << games << "\n";
+	std::cout << "Positions: " << positions << "\n";
+	std::cout << "Book entries: " << entries << " (" << runNames.size() << " runs)" << "\n";
+	return true;
+}
+
+// book build <pgn> <book> [max ply] [memory MB], book key
+void runBookCommand(const std::vector<std::string>& args)
+{
+	if (args.size() == 1 && args[0] == "key")
+	{
+		std::cout << "Book key: 0x" << std::hex << std::setw(16) << std::setfill('0') << bookKey(currentSideToMove) << std::dec << std::setfill(' ') << "\n";
+		return;
+	}
+
+	if (args.size() < 3 || args[0] != "build")
+	{
+		std::cout << "usage: book build <pgn> <book> [max ply] [memory MB] | book key" << "\n";
+		return;
+	}
+
+	int maxPly = (args.size() > 3) ? std::atoi(args[3].c_str()) : 30;
+	int memoryMegabytes = (args.size() > 4) ? std::atoi(args[4].c_str()) : 64;
+	buildBook(args[1], args[2], std::max(1, maxPly), std::max(1, memoryMegabytes));
+}
+
+/*
+--------------------
+
+MATCH
+
+--------------------
+*/
+
+// Self-play between two UCI engines, by default two copies of this executable with different option
+// sets. Every worker thread plays whole games on its own board and drives its own pair of engine
+// processes over pipes, so with one worker per core all cores are searching.
+
+/* --- Engine processes --- */
+
+struct EngineProcess {
+#ifdef _WIN32
+	HANDLE process{ nullptr };
+	HANDLE input{ nullptr }; // engine stdin
+	HANDLE output{ nullptr }; // engine stdout
+#else
+	pid_t pid{ -1 };
+	int input{ -1 };
+	int output{ -1 };
+#endif
+	std::string buffer; // read, not yet returned
+	std::string name;
+};
+
+// Runs the command line with its stdin and stdout connected to the engine, false if it can't start
+bool startEngine(const std::string& command, EngineProcess& engine)
+{
+#ifdef _WIN32
+	SECURITY_ATTRIBUTES security{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+	HANDLE childInput, childOutput;
+	if (!CreatePipe(&childInput, &engine.input, &security, 0)) return false;
+	if (!CreatePipe(&engine.output, &childOutput, &security, 0))
+	{
+		CloseHandle(childInput);
+		CloseHandle(engine.input);
+		return false;
+	}
+	SetHandleInformation(engine.input, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(engine.output, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOA startup{};
+	startup.cb = sizeof(startup);
+	startup.dwFlags = STARTF_USESTDHANDLES;
+	startup.hStdInput = childInput;
+	startup.hStdOutput = childOutput;
+	startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION info{};
+	std::string commandLine = command;
+	BOOL started = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &info);
+	CloseHandle(childInput);
+	CloseHandle(childOutput);
+	if (!started) return false;
+
+	CloseHandle(info.hThread);
+	engine.process = info.hProcess;
+#else
+	int toEngine[2], fromEngine[2];
+	if (pipe(toEngine) != 0) return false;
+	if (pipe(fromEngine) != 0)
+	{
+		close(toEngine[0]);
+		close(toEngine[1]);
+		return false;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		dup2(toEngine[0], STDIN_FILENO);
+		dup2(fromEngine[1], STDOUT_FILENO);
+		close(toEngine[0]);
+		close(toEngine[1]);
+		close(fromEngine[0]);
+		close(fromEngine[1]);
+		execl("/bin/sh", "sh", "-c", ("exec " + command).c_str(), (char*)nullptr);
+		_exit(127);
+	}
+	close(toEngine[0]);
+	close(fromEngine[1]);
+	engine.input = toEngine[1];
+	engine.output = fromEngine[0];
+	if (pid == -1)
+	{
+		close(engine.input);
+		close(engine.output);
+		return false;
+	}
+	engine.pid = pid;
+#endif
+	return true;
+}
+
+void sendToEngine(EngineProcess& engine, const std::string& line)
+{
+	std::string text = line + "\n";
+#ifdef _WIN32
+	DWORD written;
+	WriteFile(engine.input, text.data(), (DWORD)text.size(), &written, nullptr);
+#else
+	size_t offset{ 0 };
+	while (offset < text.size())
+	{
+		ssize_t written = write(engine.input, text.data() + offset, text.size() - offset);
+		if (written <= 0) return; // Engine gone, the next read fails
+		offset += written;
+	}
+#endif
+}
+
+// Next output line of the engine, false if it exited or stayed silent for timeoutMs
+bool readFromEngine(EngineProcess& engine, std::string& line, int timeoutMs)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (true)
+	{
+		size_t end = engine.buffer.find('\n');
+		if (end != std::string::npos)
+		{
+			line = engine.buffer.substr(0, end);
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			engine.buffer.erase(0, end + 1);
+			return true;
+		}
+
+		int remaining = timeoutMs - (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		if (remaining <= 0) return false;
+
+		char chunk[4096];
+#ifdef _WIN32
+		DWORD available{ 0 };
+		if (!PeekNamedPipe(engine.output, nullptr, 0, nullptr, &available, nullptr)) return false;
+		if (available == 0)
+		{
+			Sleep(1);
+			continue;
+		}
+		DWORD bytes;
+		if (!ReadFile(engine.output, chunk, std::min<DWORD>(available, sizeof(chunk)), &bytes, nullptr) || bytes == 0) return false;
+#else
+		pollfd descriptor{ engine.output, POLLIN, 0 };
+		if (poll(&descriptor, 1, remaining) <= 0) continue; // Timeout is checked above
+		ssize_t bytes = read(engine.output, chunk, sizeof(chunk));
+		if (bytes <= 0) return false;
+#endif
+		engine.buffer.append(chunk, bytes);
+	}
+}
+
+// Reads until a line starting with the token, false if the engine failed first
+bool waitForEngine(EngineProcess& engine, const std::string& token, int timeoutMs)
+{
+	std::string line;
+	while (readFromEngine(engine, line, timeoutMs))
+	{
+		if (line.compare(0, token.size(), token) == 0) return true;
+	}
+	return false;
+}
+
+void stopEngine(EngineProcess& engine)
+{
+	sendToEngine(engine, "quit");
+#ifdef _WIN32
+	if (engine.process == nullptr) return;
+	if (WaitForSingleObject(engine.process, 1000) != WAIT_OBJECT_0) TerminateProcess(engine.process, 1);
+	CloseHandle(engine.input);
+	CloseHandle(engine.output);
+	CloseHandle(engine.process);
+	engine.process = nullptr;
+#else
+	if (engine.pid == -1) return;
+	close(engine.input);
+	close(engine.output);
+	kill(engine.pid, SIGTERM); // Not listening to quit after a timeout
+	waitpid(engine.pid, nullptr, 0);
+	engine.pid = -1;
+#endif
+}
+
+/* --- Games --- */
+
+struct MatchConfig {
+	std::string commands[2];
+	std::vector<std::pair<std::string, std::string>> options[2]; // setoption name/value
+	std::vector<std::string> openings; // FEN
+	std::string goCommand;
+	int games{ 100 };
+	int concurrency{ 1 };
+	int timeoutMs{ 60000 }; // per move
+	int maxPlies{ 400 };
+	int resignScore{ 1000 }; // both engines agree for resignMoves moves each, 0 moves disables
+	int resignMoves{ 3 };
+	int drawScore{ 10 }; // both engines within drawScore for drawMoves moves each, after drawAfter plies
+	int drawMoves{ 8 };
+	int drawAfter{ 80 };
+	int report{ 10 }; // games between Elo lines
+	double elo0{ 0.0 };
+	double elo1{ 5.0 };
+	double alpha{ 0.05 };
+	double beta{ 0.05 };
+};
+
+struct GameResult {
+	int whitePoints; // 2 win, 1 draw, 0 loss, -1 unplayable opening
+	std::string reason;
+};
+
+// Kings with at most one minor piece, no side can mate
+bool insufficientMaterial()
+{
+	U64 pawnsAndMajors = bitboardPieces[bb_wpawn] | bitboardPieces[bb_bpawn] | bitboardPieces[bb_wrook] | bitboardPieces[bb_brook]
+		| bitboardPieces[bb_wqueen] | bitboardPieces[bb_bqueen];
+	return pawnsAndMajors == 0 && countBits(allPiecesOccupancy) <= 3;
+}
+
+bool startMatchEngine(const MatchConfig& config, int index, EngineProcess& engine)
+{
+	if (!startEngine(config.commands[index], engine)) return false;
+
+	sendToEngine(engine, "uci");
+	std::string line;
+	while (true)
+	{
+		if (!readFromEngine(engine, line, config.timeoutMs)) return false;
+		if (line.compare(0, 8, "id name ") == 0) engine.name = line.substr(8);
+		if (line == "uciok") break;
+	}
+	for (const auto& option : config.options[index]) sendToEngine(engine, "setoption name " + option.first + " value " + option.second);
+	sendToEngine(engine, "isready");
+	return waitForEngine(engine, "readyok", config.timeoutMs);
+}
+
+// One game from the opening, engines[whiteEngine] plays white. The game is played on the board of
+// the calling thread, which checks the moves and ends the game by the rules or by adjudication.
+GameResult playMatchGame(const MatchConfig& config, EngineProcess engines[2], int whiteEngine, const std::string& opening)
+{
+	if (!setPositionFromFen(opening)) return { -1, "bad opening" };
+
+	std::istringstream fields(opening);
+	std::string field;
+	int halfmoveClock{ 0 };
+	for (int i = 0; i < 5 && fields >> field; i++)
+	{
+		if (i == 4) halfmoveClock = std::atoi(field.c_str());
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		sendToEngine(engines[i], "ucinewgame");
+		sendToEngine(engines[i], "isready");
+		if (!waitForEngine(engines[i], "readyok", config.timeoutMs)) return { (i == whiteEngine) ? 0 : 2, "engine failure" };
+	}
+
+	Color c = currentSideToMove;
+	std::vector<U64> keys{ bookKey(c) };
+	std::string moves;
+	int winningMoves[2]{ 0, 0 };
+	int losingMoves[2]{ 0, 0 };
+	int drawnMoves[2]{ 0, 0 };
+
+	for (int ply = 0; ; ply++)
+	{
+		int mover = (c == white) ? whiteEngine : 1 - whiteEngine;
+		int moverWins = (c == white) ? 2 : 0;
+		int moverLoses = 2 - moverWins;
+
+		// Rules
+		if (!tbHasLegalMove(c, 1)) return isKingInCheck(c) ? GameResult{ moverLoses, "checkmate" } : GameResult{ 1, "stalemate" };
+		if (halfmoveClock >= 100) return { 1, "fifty moves" };
+		if (std::count(keys.begin(), keys.end(), keys.back()) >= 3) return { 1, "repetition" };
+		if (insufficientMaterial()) return { 1, "insufficient material" };
+		if (ply >= config.maxPlies) return { 1, "move limit" };
+
+		// Adjudication, tablebases first
+		if (canProbeTablebases())
+		{
+			TBProbeState state{ tb_ok };
+			int wdl = probeWDL(c, 1, state);
+			if (state != tb_fail) return { (wdl == tb_win) ? moverWins : (wdl == tb_loss) ? moverLoses : 1, "tablebase" };
+		}
+
+		sendToEngine(engines[mover], "position fen " + opening + (moves.empty() ? "" : " moves" + moves));
+		sendToEngine(engines[mover], config.goCommand);
+
+		std::string line, bestMove;
+		int score{ 0 };
+		while (bestMove.empty())
+		{
+			if (!readFromEngine(engines[mover], line, config.timeoutMs)) return { moverLoses, "timeout or crash" };
+
+			std::istringstream tokens(line);
+			std::string token;
+			tokens >> token;
+			if (token == "bestmove") tokens >> bestMove;
+			else if (token == "info")
+			{
+				while (tokens >> token)
+				{
+					if (token != "score") continue;
+					std::string type;
+					int value{ 0 };
+					tokens >> type >> value;
+					if (type == "cp") score = value;
+					else if (type == "mate") score = (value > 0) ? -checkmateScore : checkmateScore;
+				}
+			}
+		}
+
+		Move m = findLegalMove(c, bestMove, 1);
+		if (m == 0) return { moverLoses, "illegal move " + bestMove };
+
+		// Scores are from the mover's side, both engines have to agree
+		winningMoves[mover] = (score >= config.resignScore) ? winningMoves[mover] + 1 : 0;
+		losingMoves[mover] = (score <= -config.resignScore) ? losingMoves[mover] + 1 : 0;
+		drawnMoves[mover] = (ply >= config.drawAfter && std::abs(score) <= config.drawScore) ? drawnMoves[mover] + 1 : 0;
+		if (config.resignMoves > 0 && losingMoves[mover] >= config.resignMoves && winningMoves[1 - mover] >= config.resignMoves)
+		{
+			return { moverLoses, "adjudication" };
+		}
+		if (config.drawMoves > 0 && drawnMoves[0] >= config.drawMoves && drawnMoves[1] >= config.drawMoves) return { 1, "adjudication" };
+
+		halfmoveClock = tbIsZeroing(m) ? 0 : halfmoveClock + 1;
+		makeMove(m, c, 0);
+		moves += " " + bestMove;
+		c = (c == white) ? black : white;
+		keys.push_back(bookKey(c));
+	}
+}
+
+/* --- Statistics --- */
+
+// Wins, losses and draws are those of engine 1
+struct MatchScore {
+	int wins{ 0 };
+	int losses{ 0 };
+	int draws{ 0 };
+
+	int games() const { return wins + losses + draws; }
+	double score() const { return (wins + 0.5 * draws) / games(); }
+	// Variance of the result of one game
+	double variance() const
+	{
+		double s = score();
+		return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+	}
+};
+
+double scoreToElo(double score)
+{
+	score = std::clamp(score, 1e-6, 1 - 1e-6);
+	return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+double eloToScore(double elo)
+{
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// Likelihood of engine 1 being stronger, draws carry no information
+double likelihoodOfSuperiority(const MatchScore& score)
+{
+	if (score.wins + score.losses == 0) return 0.5;
+	return 0.5 * (1.0 + std::erf((score.wins - score.losses) / std::sqrt(2.0 * (score.wins + score.losses))));
+}
+
+// Log likelihood ratio of H1 (elo1) against H0 (elo0), normal approximation of the trinomial model
+double sprtLLR(const MatchScore& score, double elo0, double elo1)
+{
+	if (score.games() == 0 || score.variance() <= 0) return 0.0;
+	double s0 = eloToScore(elo0);
+	double s1 = eloToScore(elo1);
+	return score.games() * (s1 - s0) * (2 * score.score() - s0 - s1) / (2 * score.variance());
+}
+
+void printMatchScore(const MatchConfig& config, const MatchScore& score)
+{
+	if (score.games() == 0) return;
+
+	// 95% interval of the score, converted to Elo
+	double margin = 1.96 * std::sqrt(score.variance() / score.games());
+	double elo = scoreToElo(score.score());
+	double eloMargin = (scoreToElo(score.score() + margin) - scoreToElo(score.score() - margin)) / 2;
+
+	double lower = std::log(config.beta / (1 - config.alpha));
+	double upper = std::log((1 - config.beta) / config.alpha);
+	double llr = sprtLLR(score, config.elo0, config.elo1);
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Elo: " << elo << " +/- " << eloMargin << ", LOS: " << 100 * likelihoodOfSuperiority(score) << "%, DrawRatio: "
+		<< 100.0 * score.draws / score.games() << "%" << "\n";
+	std::cout << "SPRT: llr " << llr << " (" << 100 * llr / upper << "%), lbound " << lower << ", ubound " << upper << " - "
+		<< ((llr >= upper) ? "H1 was accepted" : (llr <= lower) ? "H0 was accepted" : "continue") << "\n";
+}
+
+/* --- Runner --- */
+
+// match [--engine1 <command>] [--engine2 <command>] [--option1 Name=Value]... [--option2 Name=Value]...
+//       [--option Name=Value]... [--openings <epd>] [--games N] [--concurrency T] [--depth N | --nodes N | --movetime ms]
+//       [--timeout ms] [--max-plies N] [--resign-score cp] [--resign-moves N] [--draw-score cp]
+//       [--draw-moves N] [--draw-after plies] [--syzygy <path>] [--syzygy-probing on] [--elo0 E] [--elo1 E] [--alpha A] [--beta B] [--report N]
+// Games come in pairs on the same opening with the colours reversed. The match stops early when the SPRT
+// of elo0 against elo1 accepts either hypothesis.
+int runMatch(const std::vector<std::string>& args, const std::string& selfCommand)
+{
+	MatchConfig config;
+	config.commands[0] = config.commands[1] = "\"" + selfCommand + "\"";
+	config.concurrency = std::max(1, (int)std::thread::hardware_concurrency());
+	std::string openingsName, goCommand = "go depth " + std::to_string(depth);
+
+	auto parseOption = [](const std::string& text)
+	{
+		size_t equals = text.find('=');
+		return std::make_pair(text.substr(0, equals), (equals == std::string::npos) ? std::string() : text.substr(equals + 1));
+	};
+
+	for (size_t i = 0; i + 1 < args.size(); i += 2)
+	{
+		const std::string& name = args[i];
+		const std::string& value = args[i + 1];
+		if (name == "--engine1") config.commands[0] = value;
+		else if (name == "--engine2") config.commands[1] = value;
+		else if (name == "--option1") config.options[0].push_back(parseOption(value));
+		else if (name == "--option2") config.options[1].push_back(parseOption(value));
+		else if (name == "--option")
+		{
+			config.options[0].push_back(parseOption(value));
+			config.options[1].push_back(parseOption(value));
+		}
+		else if (name == "--openings") openingsName = value;
+		else if (name == "--games") config.games = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--concurrency") config.concurrency = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--depth") goCommand = "go depth " + value;
+		else if (name == "--nodes") goCommand = "go nodes " + value;
+		else if (name == "--movetime") goCommand = "go movetime " + value;
+		else if (name == "--timeout") config.timeoutMs = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--max-plies") config.maxPlies = std::atoi(value.c_str());
+		else if (name == "--resign-score") config.resignScore = std::atoi(value.c_str());
+		else if (name == "--resign-moves") config.resignMoves = std::atoi(value.c_str());
+		else if (name == "--draw-score") config.drawScore = std::atoi(value.c_str());
+		else if (name == "--draw-moves") config.drawMoves = std::atoi(value.c_str());
+		else if (name == "--draw-after") config.drawAfter = std::atoi(value.c_str());
+		else if (name == "--syzygy") initTablebases(value);
+		else if (name == "--syzygy-probing") tbProbing = (value == "on" || value == "true");
+		else if (name == "--elo0") config.elo0 = std::atof(value.c_str());
+		else if (name == "--elo1") config.elo1 = std::atof(value.c_str());
+		else if (name == "--alpha") config.alpha = std::atof(value.c_str());
+		else if (name == "--beta") config.beta = std::atof(value.c_str());
+		else if (name == "--report") config.report = std::max(1, std::atoi(value.c_str()));
+		else
+		{
+			std::cout << "Unknown match argument " << name << "\n";
+			return 1;
+		}
+	}
+	config.goCommand = goCommand;
+
+	// Openings: the position fields of every EPD or FEN line
+	if (!openingsName.empty())
+	{
+		std::ifstream epd(openingsName);
+		if (!epd)
+		{
+			std::cout << "Can't open " << openingsName << "\n";
+			return 1;
+		}
+		std::string line;
+		while (std::getline(epd, line))
+		{
+			std::istringstream fields(line);
+			std::string placement, side, castling, enPassant, halfmove, fullmove;
+			if (!(fields >> placement >> side >> castling >> enPassant)) continue;
+			fields >> halfmove >> fullmove;
+			if (halfmove.empty() || !std::isdigit((unsigned char)halfmove[0])) halfmove = "0";
+			if (fullmove.empty() || !std::isdigit((unsigned char)fullmove[0])) fullmove = "1";
+			config.openings.push_back(placement + " " + side + " " + castling + " " + enPassant + " " + halfmove + " " + fullmove);
+		}
+	}
+	if (config.openings.empty()) config.openings.push_back("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+	config.games += config.games % 2; // Whole pairs
+	config.concurrency = std::min(config.concurrency, config.games);
+
+#ifndef _WIN32
+	signal(SIGPIPE, SIG_IGN); // A crashed engine must not end the match
+#endif
+
+	std::mutex matchMutex;
+	int nextGame{ 0 };
+	bool finished{ false }; // SPRT decided or an engine doesn't start
+	MatchScore score;
+	std::map<std::string, int> reasons;
+	double lower = std::log(config.beta / (1 - config.alpha));
+	double upper = std::log((1 - config.beta) / config.alpha);
+
+	std::cout << "Match: " << config.games << " games, " << config.concurrency << " concurrent, " << config.openings.size() << " openings, " << config.goCommand << "\n";
+	auto start = std::chrono::steady_clock::now();
+
+	runOnThreads(config.concurrency, [&](int)
+	{
+		EngineProcess engines[2];
+		for (int i = 0; i < 2; i++)
+		{
+			if (startMatchEngine(config, i, engines[i])) continue;
+
+			std::lock_guard<std::mutex> lock(matchMutex);
+			if (!finished) std::cout << "Engine " << (i + 1) << " doesn't start: " << config.commands[i] << "\n";
+			finished = true;
+		}
+
+		while (true)
+		{
+			int game;
+			{
+				std::lock_guard<std::mutex> lock(matchMutex);
+				if (finished || nextGame >= config.games) break;
+				game = nextGame++;
+			}
+
+			// Both games of a pair share the opening, engine 1 is white in the first
+			int whiteEngine = game % 2;
+			const std::string& opening = config.openings[(game / 2) % config.openings.size()];
+			GameResult result = playMatchGame(config, engines, whiteEngine, opening);
+
+			std::lock_guard<std::mutex> lock(matchMutex);
+			if (result.whitePoints == -1)
+			{
+				std::cout << "Game " << (game + 1) << ": skipped, bad opening " << opening << "\n";
+				continue;
+			}
+
+			int engine1Points = (whiteEngine == 0) ? result.whitePoints : 2 - result.whitePoints;
+			if (engine1Points == 2) score.wins++;
+			else if (engine1Points == 0) score.losses++;
+			else score.draws++;
+			reasons[result.reason]++;
+
+			std::cout << "Game " << (game + 1) << ": " << engines[whiteEngine].name << " (" << (whiteEngine + 1) << ") vs "
+				<< engines[1 - whiteEngine].name << " (" << (2 - whiteEngine) << ") "
+				<< ((result.whitePoints == 2) ? "1-0" : (result.whitePoints == 0) ? "0-1" : "1/2-1/2") << " {" << result.reason << "}, score "
+				<< score.wins << " - " << score.losses << " - " << score.draws << "\n";
+
+			if (score.games() % config.report == 0) printMatchScore(config, score);
+
+			double llr = sprtLLR(score, config.elo0, config.elo1);
+			if (llr >= upper || llr <= lower) finished = true;
+		}
+
+		for (int i = 0; i < 2; i++) stopEngine(engines[i]);
+	});
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Finished: " << score.games() << " games in " << elapsed / 1000.0 << " s, engine 1 "
+		<< score.wins << " - " << score.losses << " - " << score.draws << "\n";
+	for (const auto& reason : reasons) std::cout << "  " << reason.first << ": " << reason.second << "\n";
+	printMatchScore(config, score);
+	return 0;
+}
+
+/*
+--------------------
+
+TRAINING DATA
+
+--------------------
+*/
+
+// Positions of fixed node self-play games, labelled with the search score and the game result, for
+// training an evaluation. Records are 32 bytes, little endian, written by every thread to its own
+// shard files <out>_<thread>_<shard>.bin.
+
+struct TrainingRecord {
+	uint64_t occupancy; // bit n is engine square n (a8 = 0)
+	uint8_t pieces[16]; // bitboard index of every occupied square in square order, two per byte, low nibble first
+	int16_t score; // search score of the side to move
+	uint16_t ply; // game ply
+	int8_t result; // 1 side to move won, 0 draw, -1 lost
+	uint8_t state; // bit 0 black to move, bits 1 - 4 castling rights KQkq
+	uint8_t enPassant; // square a pawn can capture on, 64 if none
+	uint8_t rule50; // halfmove clock, at most 255
+};
+static_assert(sizeof(TrainingRecord) == 32, "training records are 32 bytes");
+
+TrainingRecord packPosition(Color c, int score, int ply, int halfmoveClock)
+{
+	TrainingRecord record{};
+	record.occupancy = allPiecesOccupancy;
+
+	int count{ 0 };
+	for (int square = a8; square <= h1 && count < 32; square++)
+	{
+		if (!get_bit(allPiecesOccupancy, square)) continue;
+		record.pieces[count / 2] |= getPieceIndex(square) << (4 * (count % 2));
+		count++;
+	}
+
+	record.score = (int16_t)std::clamp(score, -32767, 32767);
+	record.ply = (uint16_t)std::min(ply, 65535);
+	record.state = (c == black) | (whiteKingSideCastlingRights << 1) | (whiteQueenSideCastlingRights << 2)
+		| (blackKingSideCastlingRights << 3) | (blackQueenSideCastlingRights << 4);
+
+	// Same rule as the book keys: only when a pawn can take
+	record.enPassant = 64;
+	const std::vector<Move>& oppMoveLog = (c == white) ? blackMoveLog : whiteMoveLog;
+	if (!oppMoveLog.empty() && getFlag(oppMoveLog.back()) == double_pawn_push)
+	{
+		int to = getTo(oppMoveLog.back());
+		EPieceCode pawn = (c == white) ? epc_wpawn : epc_bpawn;
+		if ((getFile(to) > 1 && mainBoard[to - 1] == pawn) || (getFile(to) < 8 && mainBoard[to + 1] == pawn)) record.enPassant = (uint8_t)((c == white) ? to - oneRank : to + oneRank);
+	}
+	record.rule50 = (uint8_t)std::min(halfmoveClock, 255);
+	return record;
+}
+
+std::string trainingRecordToFen(const TrainingRecord& record)
+{
+	static const char pieceChars[13] = "PpNnBbRrQqKk";
+
+	std::string fen;
+	int count{ 0 };
+	int empty{ 0 };
+	for (int square = a8; square <= h1; square++)
+	{
+		if ((record.occupancy >> square) & 1ULL)
+		{
+			if (empty > 0) fen += (char)('0' + empty);
+			empty = 0;
+			int index = (record.pieces[count / 2] >> (4 * (count % 2))) & 15;
+			fen += (index < 12) ? pieceChars[index] : '?';
+			count++;
+		}
+		else empty++;
+
+		if (getFile(square) == 8)
+		{
+			if (empty > 0) fen += (char)('0' + empty);
+			empty = 0;
+			if (square != h1) fen += '/';
+		}
+	}
+
+	std::string castling;
+	if (record.state & 2) castling += 'K';
+	if (record.state & 4) castling += 'Q';
+	if (record.state & 8) castling += 'k';
+	if (record.state & 16) castling += 'q';
+
+	fen += (record.state & 1) ? " b " : " w ";
+	fen += castling.empty() ? "-" : castling;
+	fen += " " + ((record.enPassant < 64) ? squareToString(record.enPassant) : std::string("-"));
+	fen += " " + std::to_string(record.rule50) + " " + std::to_string(record.ply / 2 + 1);
+	return fen;
+}
+
+// Calls onRecord for every record of a training data file, read through a memory mapping or streamed.
+// False if the file can't be opened.
+template <typename Function>
+bool readTrainingData(const std::string& fileName, bool mapped, Function onRecord)
+{
+	if (mapped)
+	{
+		MappedFile file;
+		if (!mapFile(fileName, file)) return false;
+		for (U64 offset = 0; offset + sizeof(TrainingRecord) <= file.size; offset += sizeof(TrainingRecord))
+		{
+			TrainingRecord record;
+			std::memcpy(&record, file.data + offset, sizeof(TrainingRecord));
+			onRecord(record);
+		}
+		unmapFile(file);
+		return true;
+	}
+
+	std::ifstream in(fileName, std::ios::binary);
+	if (!in) return false;
+	std::vector<TrainingRecord> buffer(4096);
+	while (true)
+	{
+		in.read((char*)buffer.data(), buffer.size() * sizeof(TrainingRecord));
+		size_t count = (size_t)in.gcount() / sizeof(TrainingRecord);
+		for (size_t i = 0; i < count; i++) onRecord(buffer[i]);
+		if (count < buffer.size()) return true;
+	}
+}
+
+// Buffered writer of one thread, starts a new shard file every shardSize records
+struct TrainingWriter {
+	std::string prefix;
+	int thread{ 0 };
+	U64 shardSize{ 0 };
+	int shard{ 0 };
+	U64 inShard{ 0 };
+	std::ofstream file;
+	std::vector<TrainingRecord> buffer;
+
+	void flush()
+	{
+		size_t written{ 0 };
+		while (written < buffer.size())
+		{
+			if (!file.is_open() || inShard == shardSize)
+			{
+				file.close();
+				file.open(prefix + "_" + std::to_string(thread) + "_" + std::to_string(shard++) + ".bin", std::ios::binary);
+				inShard = 0;
+			}
+			size_t count = (size_t)std::min<U64>(buffer.size() - written, shardSize - inShard);
+			file.write((const char*)(buffer.data() + written), count * sizeof(TrainingRecord));
+			written += count;
+			inShard += count;
+		}
+		buffer.clear();
+	}
+
+	void write(const TrainingRecord& record)
+	{
+		buffer.push_back(record);
+		if (buffer.size() == 4096) flush();
+	}
+};
+
+// Legal moves of the current position
+void getLegalMoves(Color c, std::vector<Move>& legalMoves)
+{
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount;
+	getPseudoLegalMoves(c, moves, moveCount);
+
+	legalMoves.clear();
+	for (int i = 0; i < moveCount; i++)
+	{
+		makeMove(moves[i], c, 1);
+		if (!isKingInCheck(c)) legalMoves.push_back(moves[i]);
+		unmakeMove(moves[i], c, 1);
+	}
+}
+
+// gensfen [--positions N] [--nodes N] [--threads T] [--out <prefix>] [--random-plies N] [--max-plies N]
+//         [--eval-limit cp] [--shard N] [--hash MB] [--seed S]
+// Every thread plays games from the start position, the first random plies uniformly random, the rest
+// with a node limited search. Positions in check, with a capture or promotion as the best move, or
+// where a capture changes the static evaluation are left out. The game ends by the rules, by the
+// tablebases, or when a score reaches the eval limit.
+int runGensfen(const std::vector<std::string>& args)
+{
+	U64 targetPositions{ 1000000 };
+	U64 searchNodes{ 5000 };
+	int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	std::string prefix{ "sfen" };
+	int randomPlies{ 8 };
+	int maxPlies{ 400 };
+	int evalLimit{ 3000 };
+	U64 shardSize{ 1000000 };
+	int hashMegabytes{ 64 };
+	U64 seed{ 20240101 };
+
+	for (size_t i = 0; i + 1 < args.size(); i += 2)
+	{
+		const std::string& name = args[i];
+		const std::string& value = args[i + 1];
+		if (name == "--positions") targetPositions = std::strtoull(value.c_str(), nullptr, 10);
+		else if (name == "--nodes") searchNodes = std::max(1ULL, std::strtoull(value.c_str(), nullptr, 10));
+		else if (name == "--threads") threadCount = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--out") prefix = value;
+		else if (name == "--random-plies") randomPlies = std::max(0, std::atoi(value.c_str()));
+		else if (name == "--max-plies") maxPlies = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--eval-limit") evalLimit = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--shard") shardSize = std::max(1ULL, std::strtoull(value.c_str(), nullptr, 10));
+		else if (name == "--hash") hashMegabytes = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--seed") seed = std::strtoull(value.c_str(), nullptr, 10);
+		else
+		{
+			std::cout << "Unknown gensfen argument " << name << "\n";
+			return 1;
+		}
+	}
+	setHashSize(hashMegabytes);
+
+	std::mutex progressMutex;
+	U64 totalPositions{ 0 };
+	U64 totalGames{ 0 };
+	std::vector<U64> threadPositions(threadCount, 0);
+	auto start = std::chrono::steady_clock::now();
+
+	std::cout << "gensfen: " << targetPositions << " positions, " << threadCount << " threads, " << searchNodes << " nodes per move, " << prefix << "_<thread>_<shard>.bin" << "\n";
+
+	runOnThreads(threadCount, [&](int threadIndex)
+	{
+		std::mt19937_64 random(seed + threadIndex);
+		TrainingWriter writer;
+		writer.prefix = prefix;
+		writer.thread = threadIndex;
+		writer.shardSize = shardSize;
+
+		std::vector<TrainingRecord> gameRecords;
+		std::vector<Move> legalMoves;
+		std::vector<RootMove> rootMoves;
+		std::vector<U64> keys;
+
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(progressMutex);
+				if (totalPositions >= targetPositions) break;
+			}
+
+			setPositionFromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+			Color c = white;
+			int halfmoveClock{ 0 };
+			int ply{ 0 };
+			keys.assign(1, bookKey(c));
+			gameRecords.clear();
+
+			// Random opening
+			for (; ply < randomPlies; ply++)
+			{
+				getLegalMoves(c, legalMoves);
+				if (legalMoves.empty()) break;
+				Move m = legalMoves[random() % legalMoves.size()];
+				halfmoveClock = tbIsZeroing(m) ? 0 : halfmoveClock + 1;
+				makeMove(m, c, 0);
+				c = (c == white) ? black : white;
+				keys.push_back(bookKey(c));
+			}
+			if (ply < randomPlies) continue; // Ended during the opening
+
+			int whiteResult{ 0 }; // 1 white won, 0 draw, -1 black won
+			for (; ; ply++)
+			{
+				int moverWins = (c == white) ? 1 : -1;
+
+				getLegalMoves(c, legalMoves);
+				if (legalMoves.empty())
+				{
+					whiteResult = isKingInCheck(c) ? -moverWins : 0;
+					break;
+				}
+				if (halfmoveClock >= 100 || std::count(keys.begin(), keys.end(), keys.back()) >= 3 || insufficientMaterial() || ply >= maxPlies) break;
+
+				if (canProbeTablebases())
+				{
+					TBProbeState state{ tb_ok };
+					int wdl = probeWDL(c, 1, state);
+					if (state != tb_fail)
+					{
+						whiteResult = (wdl == tb_win) ? moverWins : (wdl == tb_loss) ? -moverWins : 0;
+						break;
+					}
+				}
+
+				nodeCount = 0;
+				nodeLimit = searchNodes;
+				SearchResult result = searchRoot(c, MAX_DEPTH / 2, rootMoves, false);
+				nodeLimit = 0;
+				if (result.move == 0) break;
+
+				if (std::abs(result.score) >= evalLimit)
+				{
+					whiteResult = (result.score > 0) ? moverWins : -moverWins;
+					break;
+				}
+
+				// Quiet positions only
+				int flag = getFlag(result.move);
+				if (!isKingInCheck(c) && !tbIsCapture(result.move) && flag < knight_promotion)
+				{
+					int staticEval = calculateEvaluation(c);
+					if (c == black) staticEval = -staticEval;
+					if (quiescence(c, minScore, maxScore, 1, false) == staticEval) gameRecords.push_back(packPosition(c, result.score, ply, halfmoveClock));
+				}
+
+				halfmoveClock = tbIsZeroing(result.move) ? 0 : halfmoveClock + 1;
+				makeMove(result.move, c, 0);
+				c = (c == white) ? black : white;
+				keys.push_back(bookKey(c));
+			}
+
+			for (TrainingRecord& record : gameRecords)
+			{
+				record.result = (int8_t)((record.state & 1) ? -whiteResult : whiteResult);
+				writer.write(record);
+			}
+
+			std::lock_guard<std::mutex> lock(progressMutex);
+			U64 before = totalPositions;
+			totalPositions += gameRecords.size();
+			threadPositions[threadIndex] += gameRecords.size();
+			totalGames++;
+
+			// Progress every 100000 positions
+			if (totalPositions / 100000 != before / 100000)
+			{
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				std::cout << totalPositions << " positions, " << totalGames << " games, " << std::fixed << std::setprecision(0)
+					<< totalPositions / seconds / threadCount << " positions/second/core" << "\n";
+			}
+		}
+		writer.flush();
+	});
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Positions: " << totalPositions << "\n";
+	std::cout << "Games: " << totalGames << "\n";
+	std::cout << "Time (s): " << std::fixed << std::setprecision(1) << seconds << "\n";
+	std::cout << "Positions/second: " << std::setprecision(0) << totalPositions / seconds << "\n";
+	for (int i = 0; i < threadCount; i++)
+	{
+		std::cout << "Thread " << i << " positions/second: " << threadPositions[i] / seconds << "\n";
+	}
+	return 0;
+}
+
+// readsfen <file> [--count N] [--mmap]: prints the records of a training data file as FEN, score, result and ply
+int runReadsfen(const std::vector<std::string>& args)
+{
+	if (args.empty())
+	{
+		std::cout << "usage: readsfen <file> [--count N] [--mmap]" << "\n";
+		return 1;
+	}
+
+	U64 count = ~0ULL;
+	bool mapped{ false };
+	for (size_t i = 1; i < args.size(); i++)
+	{
+		if (args[i] == "--mmap") mapped = true;
+		else if (args[i] == "--count" && i + 1 < args.size()) count = std::strtoull(args[++i].c_str(), nullptr, 10);
+	}
+
+	U64 printed{ 0 };
+	bool opened = readTrainingData(args[0], mapped, [&](const TrainingRecord& record)
+	{
+		if (printed++ >= count) return;
+		std::cout << trainingRecordToFen(record) << " score " << record.score << " result " << (int)record.result << " ply " << record.ply << "\n";
+	});
+	if (!opened)
+	{
+		std::cout << "Can't open " << args[0] << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+bool isGameOver(Color sideToMove)
+{
+	std::array<Move, MAX_MOVES> moveList;
+	int moveCount;
+	getPseudoLegalMoves(sideToMove, moveList, moveCount);
+
+	bool hasLegalMove = false;
+
+	for (int i = 0; i < moveCount; i++)
+	{
+		makeMove(moveList[i], sideToMove, 0);
+
+		if (!isKingInCheck(sideToMove))
+		{
+			// Found a legal move
+			hasLegalMove = true;
+			unmakeMove(moveList[i], sideToMove, 0);
+			break;  // no need to check more
+		}
+
+		unmakeMove(moveList[i], sideToMove, 0);
+	}
+
+
+	if (!hasLegalMove)
+	{
+		if (isKingInCheck(sideToMove))
+		{
+			std::cout << "Checkmate. " << ((sideToMove == white) ? "Black" : "White") << " wins." << '\n';
+		}
+		else
+		{
+			std::cout << "Stalemate. Game is a draw." << '\n';
+		}
+		return true;  // Game over
+	}
+
+	return false;  // Game continues
+}
+
+void gameLoop()
+{
+	// THIS LOOP DOESNT WORK
+
+	initializeAllBoards();
+	positionKey = computePositionKey();
+	materialKey = computeMaterialKey();
+	printMainboard();
+
+	while (true)
+	{
+		if (isGameOver(white)) break;
+		if (isGameOver(black)) break;
+
+		/*int from{ 0 };
+		int to{ 0 };
+		int flag{ 0 };
+
+		std::string fromString{ "" };
+		std::string toString{ "" };
+		std::string flagString{ "" };*/
+
+		std::cout << "White's turn" << '\n';
+		SearchResult resultWhite = negaMax(white, minScore, maxScore, depth, 0);
+		makeMove(resultWhite.move, white, 0);
+		printMainboard();
+		std::cout << "Evaluation: " << std::fixed << std::setprecision(1) << (resultWhite.score / 100.0) << '\n';
+
+
+		/*std::cout << "Enter the square of the piece you want to move (lowercase)" << '\n';
+		std::cin >> fromString;
+		from = stringToSquare(fromString);
+
+		std::cout << "Enter the desired destination (lowercase, must be legal move)" << '\n';
+		std::cin >> toString;
+		to = stringToSquare(toString);
+
+		std::cout << "Enter the INDEX (1-14) of the move type" << '\n';
+		std::cout << "Flag list: " << "quiet_move, double_pawn_push, king_side_castle, queen_side_castle, capture, en_passant_capture, " << '\n' << "knight_promotion, bishop_promotion, rook_promotion, queen_promotion, knight_promo_capture, bishop_promo_capture, rook_promo_capture, queen_promo_capture";
+		std::cout << '\n';
+		std::cin >> flag;
+		flag--;*/
+
+		/*makeMove(encodeMove(from, to, flag), black, 0);
+		printMainboard();*/
+
+		std::cout << "Black's turn" << '\n';
+		SearchResult resultBlack = negaMax(black, minScore, maxScore, depth, 0);
+		makeMove(resultBlack.move, black, 0);
+		printMainboard();
+		std::cout << "Evaluation: " << std::fixed << std::setprecision(1) << (-resultBlack.score / 100.0) << '\n'; // negate score
+	}
+}
+
+void uciLoop()
+{
+	std::string line;
+
+	while (std::getline(std::cin, line))
+	{
+		std::istringstream iss(line);
+		std::string token;
+		iss >> token;
+
+		// UCI initialization
+		if (token == "uci")
+		{
+			std::cout << "id name ChessEngineTP" << "\n";
+			std::cout << "id author ThanasisPantelakis" << "\n";
+			std::cout << "option name Hash type spin default 24 min 1 max 65536" << "\n";
+			std::cout << "option name SyzygyPath type string default <empty>" << "\n";
+			std::cout << "option name SyzygyProbeLimit type spin default 7 min 0 max 7" << "\n";
+			std::cout << "option name SyzygyProbing type check default false" << "\n";
+			std::cout << "option name OwnBook type check default false" << "\n";
+			std::cout << "option name BookFile type string default <empty>" << "\n";
+			std::cout << "option name BookBestMove type check default false" << "\n";
+			std::cout << "option name MultiPV type spin default 1 min 1 max 256" << "\n";
+			std::cout << "option name IIDMode type combo default Off var Off var IID var IIR" << "\n";
+			std::cout << "option name RazorMargin type spin default 200 min 0 max 2000" << "\n";
+			std::cout << "option name ProbCutMargin type spin default 200 min 0 max 2000" << "\n";
+			std::cout << "uciok" << "\n";
+		}
+
+		// Ready check
+		else if (token == "isready")
+		{
+			std::cout << "readyok" << "\n";
+		}
+
+		// New game
+		else if (token == "ucinewgame")
+		{
+			clearTranspositionTable();
+			initializeAllBoards();
+			positionKey = computePositionKey();
+			materialKey = computeMaterialKey();
+			currentSideToMove = white;
+			whiteMoveLog.clear();
+			blackMoveLog.clear();
+			whiteKingSideCastlingRights = true;
+			whiteQueenSideCastlingRights = true;
+			blackKingSideCastlingRights = true;
+			blackQueenSideCastlingRights = true;
+			plyCounter = 0;
+		}
+
+		// Set position
+		else if (token == "position")
+		{
+			std::string posType;
+			iss >> posType;
+
+			std::string movesToken;
+
+			if (posType == "startpos")
+			{
+				initializeAllBoards();
+				positionKey = computePositionKey();
+				materialKey = computeMaterialKey();
+				currentSideToMove = white;
+				whiteMoveLog.clear();
+				blackMoveLog.clear();
+				whiteKingSideCastlingRights = true;
+				whiteQueenSideCastlingRights = true;
+				blackKingSideCastlingRights = true;
+				blackQueenSideCastlingRights = true;
+				plyCounter = 0;
+
+				iss >> movesToken;
+			}
+			else if (posType == "fen")
+			{
+				// FEN fields up to the optional "moves" token
+				std::string fen;
+				while (iss >> movesToken && movesToken != "moves") fen += movesToken + " ";
+
+				if (!setPositionFromFen(fen)) continue;
+			}
+
+			// Check for moves
+			if (movesToken == "moves")
+			{
+				std::string moveStr;
+				while (iss >> moveStr)
+				{
+					// Parse move
+					int from = stringToSquare(moveStr.substr(0, 2));
+					int to = stringToSquare(moveStr.substr(2, 2));
+
+					// Generate moves and find the matching one
+					std::array<Move, MAX_MOVES> moveList;
+					int moveCount;
+					getPseudoLegalMoves(currentSideToMove, moveList, moveCount);
+
+					for (int i = 0; i < moveCount; i++)
+					{
+						if (getFrom(moveList[i]) == from && getTo(moveList[i]) == to)
+						{
+							// Check for promotion
+							if (moveStr.length() == 5)
+							{
+								char promoChar = moveStr[4];
+								int flag = getFlag(moveList[i]);
+
+								// Match promotion type
+								if (promoChar == 'q' && (flag != queen_promotion && flag != queen_promo_capture)) continue;
+								if (promoChar == 'r' && (flag != rook_promotion && flag != rook_promo_capture)) continue;
+								if (promoChar == 'b' && (flag != bishop_promotion && flag != bishop_promo_capture)) continue;
+								if (promoChar == 'n' && (flag != knight_promotion && flag != knight_promo_capture)) continue;
+							}
+
+							makeMove(moveList[i], currentSideToMove, plyCounter);
+							currentSideToMove = (currentSideToMove == white) ? black : white;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		// Options
+		else if (token == "setoption")
+		{
+			// setoption name <id> [value <x>]
+			std::string name, value, word;
+			iss >> word; // "name"
+			while (iss >> word && word != "value") name += (name.empty() ? "" : " ") + word;
+			std::getline(iss >> std::ws, value);
+
+			if (name == "Hash")
+			{
+				int megabytes = std::max(1, std::atoi(value.c_str()));
+				setHashSize(megabytes);
+				std::cout << "info string Hash " << megabytes << " MB, " << ttPages << "\n";
+			}
+			else if (name == "SyzygyPath") initTablebases(value);
+			else if (name == "SyzygyProbeLimit") tbProbeLimit = std::clamp(std::atoi(value.c_str()), 0, TB_PIECES);
+			else if (name == "SyzygyProbing") tbProbing = (value == "true");
+			else if (name == "OwnBook") ownBook = (value == "true");
+			else if (name == "BookFile") openBook(value);
+			else if (name == "BookBestMove") bookBestMove = (value == "true");
+			else if (name == "MultiPV") multiPV = std::clamp(std::atoi(value.c_str()), 1, 256);
+			else if (name == "RazorMargin") razorMargin = std::clamp(std::atoi(value.c_str()), 0, 2000);
+			else if (name == "ProbCutMargin") probCutMargin = std::clamp(std::atoi(value.c_str()), 0, 2000);
+			else if (name == "IIDMode") iidMode = (value == "IID") ? iid_deepening : (value == "Off") ? iid_off : iid_reduction;
+		}
+
+		// Fixed search workload, bench [depth] [threads] [hash] [json] [iid|iir|noiid]
+		else if (token == "bench")
+		{
+			std::vector<std::string> args;
+			std::string arg;
+			while (iss >> arg) args.push_back(arg);
+			runBench(args);
+		}
+
+		// Opening book tools, book build <pgn> <book> [max ply] [memory MB], book key prints the key of the current position
+		else if (token == "book")
+		{
+			std::vector<std::string> args;
+			std::string arg;
+			while (iss >> arg) args.push_back(arg);
+			runBookCommand(args);
+		}
+
+		// Move generation test, counts leaf nodes of the current position
+		else if (token == "perft")
+		{
+			int perftDepth{ 1 };
+			iss >> perftDepth;
+			perftDivide(perftDepth);
+		}
+
+		// Statistics of the last search, stats [json]
+		else if (token == "stats")
+		{
+#ifdef SEARCH_STATS
+			std::string format;
+			iss >> format;
+			if (format == "json") printSearchStatsJson(lastSearchStats, lastSearchTime);
+			else printSearchStats(lastSearchStats, lastSearchTime);
+#else
+			std::cout << "info string search statistics are not compiled in (build with SEARCH_STATS)" << "\n";
+#endif
+		}
+
+		// Debug mode
+		else if (token == "debug")
+		{
+			std::string mode;
+			iss >> mode;
+			debugMode = (mode == "on");
+		}
+
+		// Search for best move
+		else if (token == "go")
+		{
+			evalCacheProbes = 0;
+			evalCacheHits = 0;
+			nodeCount = 0;
+			tbHits = 0;
+
+			// Book move without searching
+			Move bookMove = ownBook ? probeBook(currentSideToMove) : 0;
+			if (bookMove != 0)
+			{
+				std::cout << "info string book move" << "\n";
+				std::cout << "bestmove " << moveToString(bookMove) << "\n";
+				continue;
+			}
+
+			// Tablebase position: play the DTZ move without searching
+			SearchResult tbResult = probeRoot(currentSideToMove);
+			if (tbResult.move != 0)
+			{
+				std::cout << "info depth 0 score " << uciScore(tbResult.score) << " nodes 0 tbhits " << tbHits << " pv " << moveToString(tbResult.move) << "\n";
+				std::cout << "bestmove " << moveToString(tbResult.move) << "\n";
+				continue;
+			}
+#ifdef SEARCH_STATS
+			searchStats = SearchStats{};
+			auto start = std::chrono::steady_clock::now();
+#endif
+
+			// go [depth N] [nodes N] [movetime ms] [mate N], other limits are ignored. With movetime and
+			// no depth the search deepens until the time is up.
+			int searchDepth{ 0 };
+			int mateMoves{ 0 };
+			int moveTime{ 0 };
+			nodeLimit = 0;
+			std::string limit;
+			while (iss >> limit)
+			{
+				if (limit == "depth") iss >> searchDepth;
+				else if (limit == "nodes") iss >> nodeLimit;
+				else if (limit == "movetime") iss >> moveTime;
+				else if (limit == "mate") iss >> mateMoves;
+			}
+			if (searchDepth == 0) searchDepth = (moveTime > 0) ? MAX_DEPTH / 2 : depth;
+			searchDepth = std::clamp(searchDepth, 1, MAX_DEPTH / 2);
+			hasDeadline = moveTime > 0;
+			searchDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(moveTime);
+
+			// Mate search first, the normal search still finds a move if there is no mate
+			SearchResult result{ 0, 0 };
+			if (mateMoves > 0)
+			{
+				result = searchMate(currentSideToMove, mateMoves, true);
+				if (result.move == 0) std::cout << "info string no mate in " << mateMoves << " found" << "\n";
+			}
+
+			std::vector<RootMove> rootMoves;
+			if (result.move == 0) result = searchRoot(currentSideToMove, searchDepth, rootMoves, true);
+			hasDeadline = false;
+
+#ifdef SEARCH_STATS
+			lastSearchStats = searchStats;
+			lastSearchTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			printSearchStats(lastSearchStats, lastSearchTime);
+#endif
+
+			if (debugMode)
+			{
+				std::cout << "info string evalcache hits " << evalCacheHits << " probes " << evalCacheProbes
+					<< " hitrate " << std::fixed << std::setprecision(1)
+					<< ((evalCacheProbes != 0) ? 100.0 * evalCacheHits / evalCacheProbes : 0.0) << "%" << "\n";
+			}
+
+			if (result.move == 0)
+			{
+				std::cout << "bestmove (none)" << "\n";
+				continue;
+			}
+
+			std::cout << "bestmove " << moveToString(result.move) << "\n";
+		}
+
+		// Quit
+		else if (token == "quit")
+		{
+			break;
+		}
+	}
+}
+
+#ifdef TUNE
+/*
+--------------------
+
+TUNER
+
+--------------------
+*/
+
+// Texel tuning: minimise the squared error between game results and sigmoid(K * eval / 400)
+// over quiet positions. The evaluation is linear in evalParams, so every position is reduced
+// once to a sparse list of coefficients and the epochs never touch the board again.
+
+struct TuneTerm {
+	uint16_t index; // into evalParams
+	int16_t coefficient; // white occurrences - black occurrences
+};
+
+struct TunePosition {
+	uint64_t firstTerm; // offset into tuneTerms
+	uint16_t termCount;
+	float result; // 1 white wins, 0.5 draw, 0 black wins
+};
+
+std::vector<TuneTerm> tuneTerms;
+std::vector<TunePosition> tunePositions;
+
+thread_local std::array<std::array<Move, MAX_DEPTH>, MAX_DEPTH> tunePV;
+thread_local std::array<int, MAX_DEPTH> tunePVLength;
+
+// Quiescence search that also keeps the principal variation, so the position at the end of it
+// can be evaluated (the traced evaluation must belong to a quiet position)
+int resolveQuiet(Color c, int alpha, int beta, int ply)
+{
+	tunePVLength[ply] = 0;
+
+	int static_eval = calculateEvaluation(c);
+	if (c == black) static_eval = -static_eval;
+
+	if (ply >= MAX_DEPTH - 1) return static_eval;
+
+	// Stand Pat
+	int best_value = static_eval;
+	if (best_value >= beta) return best_value;
+	if (best_value + 1000 < alpha) return alpha; // Skip hopeless captures
+	if (best_value > alpha) alpha = best_value;
+
+	std::array<Move, MAX_MOVES> moves;
+	int moveCount = 0;
+	generateMoves<gen_captures>(c, moves, moveCount);
+
+	for (int i = 0; i < moveCount; i++)
+	{
+		int flag = getFlag(moves[i]);
+		if (flag != capture && flag != en_passant_capture && flag < knight_promo_capture) continue;
+
+		makeMove(moves[i], c, ply);
+
+		if (!isKingInCheck(c))
+		{
+			int score = -resolveQuiet((c == white) ? black : white, -beta, -alpha, ply + 1);
+
+			unmakeMove(moves[i], c, ply);
+
+			if (score > best_value) best_value = score;
+			if (score > alpha)
+			{
+				alpha = score;
+
+				tunePV[ply][0] = moves[i];
+				for (int j = 0; j < tunePVLength[ply + 1]; j++) tunePV[ply][j + 1] = tunePV[ply + 1][j];
+				tunePVLength[ply] = tunePVLength[ply + 1] + 1;
+			}
+			if (score >= beta) break;
+		}
+		else unmakeMove(moves[i], c, ply);
+	}
+
+	return best_value;
+}
+
+// Game result from an EPD line, "1-0"/"0-1"/"1/2-1/2" or "[1.0]"/"[0.0]"/"[0.5]"
+bool parseTuneResult(const std::string& line, float& result)
+{
+	if (line.find("1/2-1/2") != std::string::npos || line.find("[0.5]") != std::string::npos) result = 0.5f;
+	else if (line.find("1-0") != std::string::npos || line.find("[1.0]") != std::string::npos) result = 1.0f;
+	else if (line.find("0-1") != std::string::npos || line.find("[0.0]") != std::string::npos) result = 0.0f;
+	else return false;
+
+	return true;
+}
+
+// Resolves one EPD line and appends its coefficients
+bool traceTunePosition(const std::string& line, std::vector<TuneTerm>& terms, std::vector<TunePosition>& positions)
+{
+	float result;
+	if (!parseTuneResult(line, result) || !setPositionFromFen(line)) return false;
+	if (findKing(white) == -1 || findKing(black) == -1) return false;
+
+	Color c = currentSideToMove;
+	resolveQuiet(c, minScore, maxScore, 0);
+	for (int ply = 0; ply < tunePVLength[0]; ply++)
+	{
+		makeMove(tunePV[0][ply], c, ply);
+		c = (c == white) ? black : white;
+	}
+
+	evalTrace.fill(0);
+	int evaluation = pieceEvaluation();
+
+	TunePosition position{ terms.size(), 0, result };
+	int tracedEvaluation{ 0 };
+	for (int index = 0; index < NUM_EVAL_PARAMS; index++)
+	{
+		if (evalTrace[index] == 0) continue;
+
+		terms.push_back({ (uint16_t)index, (int16_t)evalTrace[index] });
+		position.termCount++;
+		tracedEvaluation += evalTrace[index] * evalParams[index];
+	}
+	assert(tracedEvaluation == evaluation);
+	(void)evaluation;
+	(void)tracedEvaluation;
+
+	positions.push_back(position);
+	return true;
+}
+
+// Streams the EPD file in chunks, every chunk is split between the threads
+bool loadTunePositions(const std::string& fileName, int threadCount)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open()) return false;
+
+	constexpr size_t CHUNK_SIZE = 1 << 20;
+	std::vector<std::string> lines;
+	lines.reserve(CHUNK_SIZE);
+
+	std::vector<std::vector<TuneTerm>> threadTerms(threadCount);
+	std::vector<std::vector<TunePosition>> threadPositions(threadCount);
+
+	std::string line;
+	bool endOfFile{ false };
+	while (!endOfFile)
+	{
+		lines.clear();
+		while (lines.size() < CHUNK_SIZE)
+		{
+			if (!std::getline(file, line))
+			{
+				endOfFile = true;
+				break;
+			}
+			lines.push_back(line);
+		}
+
+		runOnThreads(threadCount, [&](int thread)
+		{
+			threadTerms[thread].clear();
+			threadPositions[thread].clear();
+
+			size_t begin = lines.size() * thread / threadCount;
+			size_t end = lines.size() * (thread + 1) / threadCount;
+			for (size_t i = begin; i < end; i++)
+			{
+				traceTunePosition(lines[i], threadTerms[thread], threadPositions[thread]);
+			}
+		});
+
+		// Merge, term offsets are relative to each thread's own term list
+		for (int thread = 0; thread < threadCount; thread++)
+		{
+			uint64_t offset = tuneTerms.size();
+			for (TunePosition position : threadPositions[thread])
+			{
+				position.firstTerm += offset;
+				tunePositions.push_back(position);
+			}
+			tuneTerms.insert(tuneTerms.end(), threadTerms[thread].begin(), threadTerms[thread].end());
+		}
+
+		std::cout << "Loaded " << tunePositions.size() << " positions" << "\n";
+	}
+
+	return true;
+}
+
+double tuneSigmoid(double K, double evaluation)
+{
+	return 1.0 / (1.0 + std::exp(-K * evaluation / 400.0));
+}
+
+double tuneEvaluation(const TunePosition& position, const std::vector<double>& weights)
+{
+	double evaluation{ 0.0 };
+	for (uint64_t i = position.firstTerm; i < position.firstTerm + position.termCount; i++)
+	{
+		evaluation += tuneTerms[i].coefficient * weights[tuneTerms[i].index];
+	}
+	return evaluation;
+}
+
+// Mean squared error over all positions
+double tuneError(double K, const std::vector<double>& weights, int threadCount)
+{
+	std::vector<double> threadError(threadCount, 0.0);
+
+	runOnThreads(threadCount, [&](int thread)
+	{
+		size_t begin = tunePositions.size() * thread / threadCount;
+		size_t end = tunePositions.size() * (thread + 1) / threadCount;
+		for (size_t i = begin; i < end; i++)
+		{
+			double error = tunePositions[i].result - tuneSigmoid(K, tuneEvaluation(tunePositions[i], weights));
+			threadError[thread] += error * error;
+		}
+	});
+
+	double error{ 0.0 };
+	for (double e : threadError) error += e;
+	return error / tunePositions.size();
+}
+
+// Gradient of the mean squared error with respect to every weight
+void tuneGradient(double K, const std::vector<double>& weights, std::vector<double>& gradient, int threadCount)
+{
+	std::vector<std::vector<double>> threadGradient(threadCount, std::vector<double>(NUM_EVAL_PARAMS, 0.0));
+
+	runOnThreads(threadCount, [&](int thread)
+	{
+		std::vector<double>& local = threadGradient[thread];
+
+		size_t begin = tunePositions.size() * thread / threadCount;
+		size_t end = tunePositions.size() * (thread + 1) / threadCount;
+		for (size_t i = begin; i < end; i++)
+		{
+			const TunePosition& position = tunePositions[i];
+			double sigmoid = tuneSigmoid(K, tuneEvaluation(position, weights));
+			double factor = (position.result - sigmoid) * sigmoid * (1.0 - sigmoid);
+
+			for (uint64_t j = position.firstTerm; j < position.firstTerm + position.termCount; j++)
+			{
+				local[tuneTerms[j].index] += factor * tuneTerms[j].coefficient;
+			}
+		}
+	});
+
+	double scale = -2.0 * K / 400.0 / tunePositions.size();
+	for (int index = 0; index < NUM_EVAL_PARAMS; index++)
+	{
+		gradient[index] = 0.0;
+		for (int thread = 0; thread < threadCount; thread++) gradient[index] += threadGradient[thread][index];
+		gradient[index] *= scale;
+	}
+}
+
+// Scaling constant that fits the current weights best, refined one decimal at a time
+double tuneFindK(const std::vector<double>& weights, int threadCount)
+{
+	double bestK{ 1.0 };
+	double bestError = tuneError(bestK, weights, threadCount);
+
+	for (double step = 0.1; step >= 0.001; step /= 10)
+	{
+		double center = bestK;
+		for (int i = -10; i <= 10; i++)
+		{
+			double K = center + i * step;
+			if (K <= 0.0) continue;
+
+			double error = tuneError(K, weights, threadCount);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestK = K;
+			}
+		}
+	}
+
+	return bestK;
+}
+
+// Writes the weights in the layout of the evalParams initializer
+void writeTunedParams(const std::string& fileName, const std::vector<double>& weights)
+{
+	std::ofstream out(fileName);
+
+	auto value = [&](int index) { return (int)std::lround(weights[index]); };
+	auto writeTable = [&](const char* name, int first)
+	{
+		out << "\n\t// " << name << "\n";
+		for (int rank = 0; rank < 8; rank++)
+		{
+			out << "\t";
+			for (int file = 0; file < 8; file++)
+			{
+				out << std::setw(4) << value(first + rank * 8 + file) << ((rank == 7 && file == 7 && first == ep_king_table) ? "" : ",");
+			}
+			out << "\n";
+		}
+	};
+
+	out << "std::array<int, NUM_EVAL_PARAMS> evalParams = {\n";
+	out << "\t// Piece values\n\t";
+	for (int index = ep_pawn_value; index <= ep_queen_value; index++) out << value(index) << ((index < ep_queen_value) ? ", " : ",");
+	out << "\n\n\t// Pawn structure, mobility, king safety, development, imbalance\n\t";
+	for (int index = ep_doubled_pawn; index < ep_pawn_table; index++) out << value(index) << ((index < ep_pawn_table - 1) ? ", " : ",");
+	out << "\n";
+	writeTable("Pawn square table", ep_pawn_table);
+	writeTable("Knight square table", ep_knight_table);
+	writeTable("King square table", ep_king_table);
+	out << "};\n";
+}
+
+// tune <positions.epd> [epochs] [threads] [output file]
+int runTuner(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: tune <positions.epd> [epochs] [threads] [output file]" << "\n";
+		return 1;
+	}
+
+	std::string fileName = argv[1];
+	int epochs = (argc > 2) ? std::atoi(argv[2]) : 1000;
+	int threadCount = (argc > 3) ? std::atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+	std::string outputName = (argc > 4) ? argv[4] : "tuned_params.txt";
+	if (threadCount < 1) threadCount = 1;
+
+	auto start = std::chrono::steady_clock::now();
+	if (!loadTunePositions(fileName, threadCount) || tunePositions.empty())
+	{
+		std::cout << "No positions loaded from " << fileName << "\n";
+		return 1;
+	}
+	double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << tunePositions.size() << " positions, " << tuneTerms.size() << " terms, loaded in "
+		<< std::fixed << std::setprecision(1) << loadSeconds << "s" << "\n";
+
+	std::vector<double> weights(evalParams.begin(), evalParams.end());
+
+	double K = tuneFindK(weights, threadCount);
+	std::cout << "K = " << std::setprecision(3) << K << ", error " << std::setprecision(6) << tuneError(K, weights, threadCount) << "\n";
+
+	// Adam
+	const double learningRate{ 1.0 };
+	const double beta1{ 0.9 };
+	const double beta2{ 0.999 };
+	const double epsilon{ 1e-8 };
+
+	std::vector<double> gradient(NUM_EVAL_PARAMS, 0.0);
+	std::vector<double> momentum(NUM_EVAL_PARAMS, 0.0);
+	std::vector<double> velocity(NUM_EVAL_PARAMS, 0.0);
+
+	for (int epoch = 1; epoch <= epochs; epoch++)
+	{
+		tuneGradient(K, weights, gradient, threadCount);
+
+		double correction1 = 1.0 - std::pow(beta1, epoch);
+		double correction2 = 1.0 - std::pow(beta2, epoch);
+		for (int index = 0; index < NUM_EVAL_PARAMS; index++)
+		{
+			momentum[index] = beta1 * momentum[index] + (1.0 - beta1) * gradient[index];
+			velocity[index] = beta2 * velocity[index] + (1.0 - beta2) * gradient[index] * gradient[index];
+			weights[index] -= learningRate * (momentum[index] / correction1) / (std::sqrt(velocity[index] / correction2) + epsilon);
+		}
+
+		if (epoch % 10 == 0 || epoch == epochs)
+		{
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "Epoch " << epoch << " error " << std::setprecision(6) << tuneError(K, weights, threadCount)
+				<< " (" << std::setprecision(1) << seconds << "s)" << "\n";
+		}
+		if (epoch % 100 == 0 || epoch == epochs)
+		{
+			writeTunedParams(outputName, weights);
+		}
+	}
+
+	std::cout << "Tuned parameters written to " << outputName << "\n";
+	return 0;
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+	allocateTranspositionTable(1048576); // 2^20 entries, 24 MB
+	initTablebaseIndexing();
+
+#ifdef TUNE
+	return runTuner(argc, argv);
+#endif
+
+	// Command line tools: bench [depth] [threads] [hash] [json] [iid|iir|noiid], perft <depth> [fen], tbcheck <syzygy path> <epd>, book build <pgn> <book> [max ply] [memory MB],
+	// analyse --epd <file> [--depth N] [--threads T] [--hash MB] [--out <file>], match [options] (see runMatch),
+	// solve --epd <file> [options] (see runSolve), gensfen [options] (see runGensfen), readsfen <file> [--count N] [--mmap]
+	if (argc > 1)
+	{
+		std::string command = argv[1];
+		if (command == "bench")
+		{
+			runBench(std::vector<std::string>(argv + 2, argv + argc));
+			return 0;
+		}
+		if (command == "analyse")
+		{
+			return runAnalyse(std::vector<std::string>(argv + 2, argv + argc));
+		}
+		if (command == "solve")
+		{
+			return runSolve(std::vector<std::string>(argv + 2, argv + argc));
+		}
+		if (command == "match")
+		{
+			return runMatch(std::vector<std::string>(argv + 2, argv + argc), argv[0]);
+		}
+		if (command == "gensfen")
+		{
+			return runGensfen(std::vector<std::string>(argv + 2, argv + argc));
+		}
+		if (command == "readsfen")
+		{
+			return runReadsfen(std::vector<std::string>(argv + 2, argv + argc));
+		}
+		if (command == "book")
+		{
+			runBookCommand(std::vector<std::string>(argv + 2, argv + argc));
+			return 0;
+		}
+		if (command == "tbcheck")
+		{
+			return runTablebaseCheck(std::vector<std::string>(argv + 2, argv + argc));
+		}
+		if (command == "perft" && argc > 2)
+		{
+			if (argc > 3) setPositionFromFen(argv[3]);
+			else setPositionFromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+			perftDivide(std::atoi(argv[2]));
+			return 0;
+		}
+	}
+
+	uciLoop();
+	//gameLoop();
+
+	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+# Profile guided optimisation of ChessEngine, run by the pgo target:
+#   1. configure BINARY_DIR with CHESSENGINE_PGO=GENERATE and build ChessEngine
+#   2. run "ChessEngine bench" to write the profile
+#   3. reconfigure the same tree with CHESSENGINE_PGO=USE and rebuild ChessEngine
+
+set(profile_dir "${BINARY_DIR}/profile")
+
+function(run_step)
+	execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+	if(NOT result EQUAL 0)
+		message(FATAL_ERROR "PGO step failed: ${ARGN}")
+	endif()
+endfunction()
+
+set(configure_args
+	-S ${SOURCE_DIR}
+	-B ${BINARY_DIR}
+	-G ${GENERATOR}
+	-DCMAKE_BUILD_TYPE=Release
+	-DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+	-DCHESSENGINE_ARCH=${ARCH}
+	-DCHESSENGINE_LTO=${LTO}
+	-DCHESSENGINE_PGO_DIR=${profile_dir}
+)
+
+message(STATUS "PGO: instrumented build")
+file(REMOVE_RECURSE ${profile_dir})
+run_step(${CMAKE_COMMAND} ${configure_args} -DCHESSENGINE_PGO=GENERATE)
+run_step(${CMAKE_COMMAND} --build ${BINARY_DIR} --target ChessEngine --clean-first)
+
+message(STATUS "PGO: training run")
+run_step(${BINARY_DIR}/ChessEngine bench)
+
+if(CXX_COMPILER_ID MATCHES "Clang")
+	get_filename_component(compiler_dir ${CXX_COMPILER} DIRECTORY)
+	find_program(LLVM_PROFDATA NAMES llvm-profdata HINTS ${compiler_dir})
+	if(NOT LLVM_PROFDATA)
+		message(FATAL_ERROR "PGO: llvm-profdata not found")
+	endif()
+	file(GLOB raw_profiles ${profile_dir}/*.profraw)
+	run_step(${LLVM_PROFDATA} merge -output=${profile_dir}/default.profdata ${raw_profiles})
+endif()
+
+message(STATUS "PGO: optimised build")
+run_step(${CMAKE_COMMAND} ${configure_args} -DCHESSENGINE_PGO=USE)
+run_step(${CMAKE_COMMAND} --build ${BINARY_DIR} --target ChessEngine --clean-first)
+
+message(STATUS "PGO: done, ${BINARY_DIR}/ChessEngine")
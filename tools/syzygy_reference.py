@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Writes random positions of the Syzygy tables in a directory as EPD, with the WDL and DTZ that
+python-chess (pip install chess) probes for them as "wdl" and "dtz" opcodes.
+
+"ChessEngine tbcheck <path> <epd>" then probes the same positions with the engine and reports any
+difference:
+
+    python3 tools/syzygy_reference.py <syzygy path> tbcheck.epd [--positions N] [--max-pieces N] [--seed S]
+    ChessEngine tbcheck <syzygy path> tbcheck.epd
+"""
+
+import argparse
+import os
+import random
+import sys
+
+import chess
+import chess.syzygy
+
+
+# Random legal position with the given white and black pieces ("KRP", "KN"), no castling and no
+# en passant, the side to move not giving check
+def random_position(rng, white, black):
+    while True:
+        board = chess.Board(None)
+        squares = list(chess.SQUARES)
+        rng.shuffle(squares)
+        ok = True
+        for color, pieces in ((chess.WHITE, white), (chess.BLACK, black)):
+            for symbol in pieces:
+                piece_type = chess.PIECE_SYMBOLS.index(symbol.lower())
+                square = squares.pop()
+                if piece_type == chess.PAWN and chess.square_rank(square) in (0, 7):
+                    ok = False
+                board.set_piece_at(square, chess.Piece(piece_type, color))
+        board.turn = rng.choice((chess.WHITE, chess.BLACK))
+        if ok and board.is_valid():
+            return board
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("path", help="directory of the .rtbw and .rtbz files")
+    parser.add_argument("epd", help="output EPD file")
+    parser.add_argument("--positions", type=int, default=200, help="positions per table (default 200)")
+    parser.add_argument("--max-pieces", type=int, default=5, help="largest tables to use (default 5)")
+    parser.add_argument("--seed", type=int, default=1, help="random seed (default 1)")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    names = sorted(name[:-5] for name in os.listdir(args.path) if name.endswith(".rtbw"))
+    names = [name for name in names if len(name) - 1 <= args.max_pieces]
+    if not names:
+        sys.exit("no WDL tables with at most %d pieces in %s" % (args.max_pieces, args.path))
+
+    lines = 0
+    with chess.syzygy.open_tablebase(args.path) as tablebase, open(args.epd, "w") as out:
+        for name in names:
+            white, black = name.split("v")
+            has_dtz = os.path.exists(os.path.join(args.path, name + ".rtbz"))
+            for _ in range(args.positions):
+                board = random_position(rng, white, black)
+                try:
+                    line = board.epd() + " wdl %d;" % tablebase.probe_wdl(board)
+                    if has_dtz:
+                        line += " dtz %d;" % tablebase.probe_dtz(board)
+                except chess.syzygy.MissingTableError:
+                    continue  # a capture leads to a table that isn't there
+                out.write(line + "\n")
+                lines += 1
+
+    print("%d positions of %d tables written to %s" % (lines, len(names), args.epd))
+
+
+if __name__ == "__main__":
+    main()